@@ -0,0 +1,136 @@
+#include "BufferArena.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <sys/mman.h>
+
+namespace {
+
+size_t roundUp(size_t bytes, size_t multiple) {
+    return (bytes + multiple - 1) / multiple * multiple;
+}
+
+// hugetlbfs pool empty or not configured: warn once, then use THP
+std::atomic<bool> hugetlbWarned(false);
+
+} // namespace
+
+BufferArena::BufferArena(HugePages hugePages)
+    : hugePages_(hugePages) {
+}
+
+BufferArena::~BufferArena() {
+    trim();
+}
+
+void BufferArena::setHugePages(HugePages hugePages) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    hugePages_ = hugePages;
+}
+
+void* BufferArena::map(size_t bytes, HugePages hugePages, size_t& capacity) {
+    bool huge = hugePages != HugePages::Off && bytes >= HUGE_PAGE_BYTES;
+    capacity = roundUp(bytes, huge ? HUGE_PAGE_BYTES : PAGE_BYTES);
+
+#ifdef MAP_HUGETLB
+    if (huge && hugePages == HugePages::Explicit) {
+        void* data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED) {
+            return data;
+        }
+        if (!hugetlbWarned.exchange(true)) {
+            std::cerr << "Warning: no explicit huge pages available (vm.nr_hugepages), "
+                      << "using transparent huge pages" << std::endl;
+        }
+    }
+#endif
+    
+    // Over-map by one huge page so that the buffer starts on a huge page
+    // boundary, where the kernel can back it with huge pages
+    size_t mapped = huge ? capacity + HUGE_PAGE_BYTES : capacity;
+    void* mapping = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Error: Failed to allocate " << bytes / (1024 * 1024) << " MB buffer" << std::endl;
+        return nullptr;
+    }
+    if (!huge) {
+        return mapping;
+    }
+    
+    uintptr_t begin = reinterpret_cast<uintptr_t>(mapping);
+    uintptr_t aligned = roundUp(begin, HUGE_PAGE_BYTES);
+    if (aligned > begin) {
+        munmap(mapping, aligned - begin);
+    }
+    if (begin + mapped > aligned + capacity) {
+        munmap(reinterpret_cast<void*>(aligned + capacity), begin + mapped - aligned - capacity);
+    }
+    void* data = reinterpret_cast<void*>(aligned);
+#ifdef MADV_HUGEPAGE
+    madvise(data, capacity, MADV_HUGEPAGE);
+#endif
+    return data;
+}
+
+void BufferArena::unmap(void* data, size_t capacity) {
+    munmap(data, capacity);
+}
+
+void* BufferArena::acquire(size_t bytes, size_t& capacity) {
+    HugePages hugePages;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        
+        // Smallest free buffer that fits, unless it would waste over half of itself
+        auto found = free_.lower_bound(bytes);
+        if (found != free_.end() && found->first / 2 <= roundUp(bytes, PAGE_BYTES)) {
+            capacity = found->first;
+            void* data = found->second;
+            free_.erase(found);
+            return data;
+        }
+        
+        // Free buffers smaller than this request are what a growing run
+        // leaves behind; drop them rather than hold both
+        for (auto it = free_.begin(); it != free_.end() && it->first < bytes;) {
+            unmap(it->second, it->first);
+            reserved_ -= it->first;
+            it = free_.erase(it);
+        }
+        hugePages = hugePages_;
+    }
+    
+    void* data = map(bytes, hugePages, capacity);
+    if (data) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        reserved_ += capacity;
+        peak_ = std::max(peak_, reserved_);
+    }
+    return data;
+}
+
+void BufferArena::release(void* data, size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.emplace(capacity, data);
+}
+
+void BufferArena::trim() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& buffer : free_) {
+        unmap(buffer.second, buffer.first);
+        reserved_ -= buffer.first;
+    }
+    free_.clear();
+}
+
+size_t BufferArena::reservedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return reserved_;
+}
+
+size_t BufferArena::peakBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return peak_;
+}
@@ -0,0 +1,169 @@
+#ifndef BUFFER_ARENA_H
+#define BUFFER_ARENA_H
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <utility>
+#include "ProcessingOptions.h"
+
+/**
+ * BufferArena class
+ * 
+ * Pool of large buffers owned by a DemProcessor and reused across days,
+ * blocks and the jobs of a manifest. Released buffers stay mapped and go
+ * to the next request they fit, so a --jobs run faults in its 765 MB
+ * block buffers once rather than once per department.
+ * 
+ * Buffers come straight from mmap: page-aligned (any SIMD width), not
+ * initialized (fresh pages land on the NUMA node of the first thread
+ * writing them) and, from HUGE_PAGE_BYTES up, optionally backed by
+ * transparent or explicit (hugetlbfs) huge pages.
+ * 
+ * Thread-safe.
+ */
+class BufferArena {
+public:
+    static constexpr size_t PAGE_BYTES = 4096;
+    static constexpr size_t HUGE_PAGE_BYTES = 2 * 1024 * 1024;
+    
+    explicit BufferArena(HugePages hugePages = HugePages::Off);
+    
+    /**
+     * Destructor, unmaps the free buffers; leased buffers must be released first
+     */
+    ~BufferArena();
+    
+    BufferArena(const BufferArena&) = delete;
+    BufferArena& operator=(const BufferArena&) = delete;
+    
+    /**
+     * Huge page backing of the buffers mapped from now on
+     */
+    void setHugePages(HugePages hugePages);
+    
+    /**
+     * Lease a buffer of at least bytes
+     * @param capacity Receives the usable size, to be passed back to release
+     * @return nullptr if the memory cannot be mapped
+     */
+    void* acquire(size_t bytes, size_t& capacity);
+    
+    /**
+     * Return a leased buffer to the pool
+     */
+    void release(void* data, size_t capacity);
+    
+    /**
+     * Unmap the free buffers
+     */
+    void trim();
+    
+    // Bytes mapped (leased and free), and their highest value so far
+    size_t reservedBytes() const;
+    size_t peakBytes() const;
+    
+    /**
+     * Map a buffer outside any pool
+     * @return nullptr if the memory cannot be mapped
+     */
+    static void* map(size_t bytes, HugePages hugePages, size_t& capacity);
+    static void unmap(void* data, size_t capacity);
+
+private:
+    HugePages hugePages_;
+    mutable std::mutex mutex_;
+    std::multimap<size_t, void*> free_;   // Capacity -> buffer
+    size_t reserved_ = 0;
+    size_t peak_ = 0;
+};
+
+/**
+ * Buffer of T leased from a BufferArena (or mapped on its own without one)
+ * 
+ * Stands in for std::vector in the large per-run buffers: elements are
+ * not initialized and the memory returns to the arena on destruction.
+ */
+template <typename T>
+class ArenaBuffer {
+public:
+    ArenaBuffer() = default;
+    ~ArenaBuffer() { reset(); }
+    
+    ArenaBuffer(const ArenaBuffer&) = delete;
+    ArenaBuffer& operator=(const ArenaBuffer&) = delete;
+    
+    ArenaBuffer(ArenaBuffer&& other) noexcept { swap(other); }
+    ArenaBuffer& operator=(ArenaBuffer&& other) noexcept {
+        reset();
+        swap(other);
+        return *this;
+    }
+    
+    /**
+     * Room for count elements, uninitialized; the contents are kept only
+     * if the current buffer is large enough
+     * @param arena Pool to lease from, or nullptr for a private mapping
+     * @return false if the memory cannot be mapped
+     */
+    bool allocate(size_t count, BufferArena* arena = nullptr) {
+        if (count * sizeof(T) <= capacity_ && arena == arena_) {
+            size_ = count;
+            return true;
+        }
+        reset();
+        if (count == 0) {
+            return true;
+        }
+        size_t capacity;
+        void* data = arena ? arena->acquire(count * sizeof(T), capacity)
+                           : BufferArena::map(count * sizeof(T), HugePages::Off, capacity);
+        if (!data) {
+            return false;
+        }
+        data_ = static_cast<T*>(data);
+        size_ = count;
+        capacity_ = capacity;
+        arena_ = arena;
+        return true;
+    }
+    
+    /**
+     * Give the memory back
+     */
+    void reset() {
+        if (data_) {
+            if (arena_) {
+                arena_->release(data_, capacity_);
+            } else {
+                BufferArena::unmap(data_, capacity_);
+            }
+        }
+        data_ = nullptr;
+        size_ = 0;
+        capacity_ = 0;
+        arena_ = nullptr;
+    }
+    
+    void swap(ArenaBuffer& other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(arena_, other.arena_);
+    }
+    
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    T& operator[](size_t i) { return data_[i]; }
+    const T& operator[](size_t i) const { return data_[i]; }
+
+private:
+    T* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;    // Bytes
+    BufferArena* arena_ = nullptr;
+};
+
+#endif // BUFFER_ARENA_H
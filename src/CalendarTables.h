@@ -0,0 +1,94 @@
+#ifndef CALENDAR_TABLES_H
+#define CALENDAR_TABLES_H
+
+/**
+ * Compile-time calendar of common and leap years
+ * 
+ * CALENDAR<Leap> maps a 0-based day index of the year to its month and
+ * day of month, and each month to the index of its first day, so that
+ * day loops index a table instead of walking months. Julian days of a
+ * year are consecutive from julianDayJan1(), which is computed with
+ * integer arithmetic.
+ */
+namespace Calendar {
+
+constexpr bool isLeapYear(int year) {
+    return (year % 4 == 0 && year % 100 != 0) || (year % 400 == 0);
+}
+
+/**
+ * Day table of a common (Leap = false) or leap year
+ */
+template <bool Leap>
+struct CalendarTable {
+    static constexpr int DAYS = Leap ? 366 : 365;
+    
+    int month[DAYS];       // 1-12
+    int day[DAYS];         // 1-31
+    int firstDay[13];      // Day index of the 1st of each month; firstDay[12] = DAYS
+};
+
+template <bool Leap>
+constexpr CalendarTable<Leap> makeCalendarTable() {
+    constexpr int MONTH_DAYS[12] = {31, Leap ? 29 : 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    CalendarTable<Leap> table = {};
+    int index = 0;
+    for (int m = 0; m < 12; ++m) {
+        table.firstDay[m] = index;
+        for (int d = 1; d <= MONTH_DAYS[m]; ++d) {
+            table.month[index] = m + 1;
+            table.day[index] = d;
+            ++index;
+        }
+    }
+    table.firstDay[12] = index;
+    return table;
+}
+
+template <bool Leap>
+inline constexpr CalendarTable<Leap> CALENDAR = makeCalendarTable<Leap>();
+
+static_assert(CALENDAR<false>.firstDay[12] == 365 && CALENDAR<true>.firstDay[12] == 366,
+              "calendar tables must cover the year");
+
+constexpr int daysInYear(int year) {
+    return isLeapYear(year) ? 366 : 365;
+}
+
+constexpr int daysInMonth(int year, int month) {
+    return isLeapYear(year) ? CALENDAR<true>.firstDay[month] - CALENDAR<true>.firstDay[month - 1]
+                            : CALENDAR<false>.firstDay[month] - CALENDAR<false>.firstDay[month - 1];
+}
+
+/**
+ * 0-based index of a date in its year
+ */
+constexpr int dayIndex(int year, int month, int day) {
+    return (isLeapYear(year) ? CALENDAR<true>.firstDay[month - 1] : CALENDAR<false>.firstDay[month - 1]) + day - 1;
+}
+
+/**
+ * Julian day of January 1st, 0h UT (Gregorian calendar, years after 1582)
+ * 
+ * Meeus' formula for month 1, with floor(365.25 * y) = 1461 * y / 4 in
+ * integers for positive y.
+ */
+constexpr double julianDayJan1(int year) {
+    int century = (year - 1) / 100;
+    int gregorian = 2 - century + century / 4;
+    return (1461 * (year + 4715)) / 4 + 428 + 1 + gregorian - 1524.5;
+}
+
+/**
+ * Julian day of a date, 0h UT
+ */
+constexpr double julianDay(int year, int month, int day) {
+    return julianDayJan1(year) + dayIndex(year, month, day);
+}
+
+static_assert(julianDay(2000, 1, 1) == 2451544.5 && julianDay(2024, 3, 1) == 2460370.5,
+              "Julian days must match Meeus");
+
+} // namespace Calendar
+
+#endif // CALENDAR_TABLES_H
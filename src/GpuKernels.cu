@@ -0,0 +1,78 @@
+#include "GpuKernels.h"
+#include <algorithm>
+#include "SolarKernels.h"
+
+namespace GpuKernels {
+
+namespace {
+
+const int BLOCK_THREADS = 256;
+
+// Grid rows per launch; larger rasters loop over rows
+const int MAX_GRID_ROWS = 65535;
+
+// Row terms (SolarGrid::rowTerms) and solar noon (SolarGrid::solarNoonTable)
+// of each day, in double then rounded to the kernel precision
+template <typename Real>
+__global__ void dayTermsKernel(BatchArgs<Real> args) {
+    int index = blockIdx.x * blockDim.x + threadIdx.x;
+    int d = blockIdx.y;
+    const Day& day = args.days[d];
+    
+    if (index < args.height) {
+        double rowScale = 1.0 / (args.cosLat[index] * day.cosDecl);
+        double rowOffset = args.tanLat[index] * day.tanDecl;
+        args.rowScale[d * args.height + index] = static_cast<Real>(rowScale);
+        args.rowOffset[d * args.height + index] = static_cast<Real>(rowOffset);
+    }
+    if (index < args.width) {
+        double noon = (720.0 - 4.0 * args.longitude[index] - day.eqTime) / 60.0;
+        args.solarNoon[d * args.width + index] = static_cast<Real>(noon);
+    }
+}
+
+// One thread per column, rows strided over the grid, one grid layer per day
+template <typename Real>
+__global__ void pixelKernel(BatchArgs<Real> args) {
+    int col = blockIdx.x * blockDim.x + threadIdx.x;
+    int d = blockIdx.z;
+    if (col >= args.width) {
+        return;
+    }
+    
+    size_t pixels = static_cast<size_t>(args.width) * args.height;
+    int16_t* sunrise = args.output + static_cast<size_t>(d) * 2 * pixels;
+    int16_t* sunset = sunrise + pixels;
+    Real noon = args.solarNoon[d * args.width + col];
+    
+    for (int row = blockIdx.y; row < args.height; row += gridDim.y) {
+        size_t i = static_cast<size_t>(row) * args.width + col;
+        SolarKernels::pixelTimes(args.cosZenith[i], noon, args.rowScale[d * args.height + row],
+                                 args.rowOffset[d * args.height + row], args.timezoneOffset,
+                                 args.unitsPerHour, sunrise[i], sunset[i]);
+    }
+}
+
+template <typename Real>
+cudaError_t launch(const BatchArgs<Real>& args, cudaStream_t stream) {
+    int terms = std::max(args.width, args.height);
+    dim3 termsGrid((terms + BLOCK_THREADS - 1) / BLOCK_THREADS, args.numDays);
+    dayTermsKernel<Real><<<termsGrid, BLOCK_THREADS, 0, stream>>>(args);
+    
+    dim3 pixelGrid((args.width + BLOCK_THREADS - 1) / BLOCK_THREADS,
+                   std::min(args.height, MAX_GRID_ROWS), args.numDays);
+    pixelKernel<Real><<<pixelGrid, BLOCK_THREADS, 0, stream>>>(args);
+    return cudaGetLastError();
+}
+
+} // namespace
+
+cudaError_t launchBatch(const BatchArgs<double>& args, cudaStream_t stream) {
+    return launch(args, stream);
+}
+
+cudaError_t launchBatch(const BatchArgs<float>& args, cudaStream_t stream) {
+    return launch(args, stream);
+}
+
+} // namespace GpuKernels
@@ -0,0 +1,60 @@
+#ifndef GPU_KERNELS_H
+#define GPU_KERNELS_H
+
+#include <cstdint>
+#include <cuda_runtime_api.h>
+
+/**
+ * CUDA kernels of GpuSolver (GpuKernels.cu)
+ * 
+ * A batch launch first tabulates the row terms and solar noon of each
+ * day, as SolarGrid does on the host, then evaluates every pixel of
+ * every day with SolarKernels::pixelTimes. Compiled with --fmad=false,
+ * so that the device rounds like the host kernels.
+ */
+namespace GpuKernels {
+
+// Days of one launch (kernel parameter array)
+constexpr int MAX_BATCH_DAYS = 16;
+
+/**
+ * Ephemeris terms of one day used by the separable solver
+ */
+struct Day {
+    double cosDecl;
+    double tanDecl;
+    double eqTime;    // Minutes
+};
+
+/**
+ * Device buffers and days of one batch
+ * @tparam Real Kernel precision (double or float)
+ */
+template <typename Real>
+struct BatchArgs {
+    const Real* cosZenith;     // [height][width], NaN for masked pixels
+    const double* cosLat;      // Per row
+    const double* tanLat;      // Per row
+    const double* longitude;   // Per column (degrees)
+    Real* rowScale;            // [day][height] scratch
+    Real* rowOffset;           // [day][height] scratch
+    Real* solarNoon;           // [day][width] scratch
+    int16_t* output;           // [day][sunrise, sunset][height][width]
+    Day days[MAX_BATCH_DAYS];
+    int numDays;
+    int width;
+    int height;
+    Real timezoneOffset;
+    Real unitsPerHour;
+};
+
+/**
+ * Enqueue the kernels of one batch on a stream
+ * @return Launch error, cudaSuccess if both kernels were queued
+ */
+cudaError_t launchBatch(const BatchArgs<double>& args, cudaStream_t stream);
+cudaError_t launchBatch(const BatchArgs<float>& args, cudaStream_t stream);
+
+} // namespace GpuKernels
+
+#endif // GPU_KERNELS_H
@@ -0,0 +1,262 @@
+#include "GpuSolver.h"
+#include <iostream>
+
+#ifdef SOLAR_HAVE_CUDA
+
+#include <algorithm>
+#include <vector>
+#include <cuda_runtime_api.h>
+#include "GpuKernels.h"
+
+namespace {
+
+bool cudaOk(cudaError_t err, const char* what) {
+    if (err != cudaSuccess) {
+        std::cerr << "Error: CUDA " << what << ": " << cudaGetErrorString(err) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static_assert(GpuSolver::MAX_BATCH_DAYS == GpuKernels::MAX_BATCH_DAYS, "batch sizes must agree");
+
+// Device memory left free for the runtime and other processes
+const size_t DEVICE_RESERVE_BYTES = 256ull * 1024 * 1024;
+
+} // namespace
+
+struct GpuSolver::Impl {
+    /**
+     * Buffers of one batch slot
+     */
+    struct Slot {
+        cudaStream_t stream = nullptr;
+        void* rowScale = nullptr;     // Device scratch of the kernel precision
+        void* rowOffset = nullptr;
+        void* solarNoon = nullptr;
+        int16_t* output = nullptr;    // Device [day][sunrise, sunset][pixel]
+        int16_t* host = nullptr;      // Pinned copy of output
+        int numDays = 0;
+    };
+    
+    bool useFloat = false;
+    int width = 0;
+    int height = 0;
+    size_t pixels = 0;
+    int batchDays = 0;
+    double timezoneOffset = 0.0;
+    double unitsPerHour = 60.0;
+    
+    void* cosZenith = nullptr;
+    double* cosLat = nullptr;
+    double* tanLat = nullptr;
+    double* longitude = nullptr;
+    Slot slots[NUM_SLOTS];
+    
+    ~Impl() { release(); }
+    
+    void release() {
+        for (Slot& slot : slots) {
+            if (slot.stream) cudaStreamSynchronize(slot.stream);
+            cudaFree(slot.rowScale);
+            cudaFree(slot.rowOffset);
+            cudaFree(slot.solarNoon);
+            cudaFree(slot.output);
+            cudaFreeHost(slot.host);
+            if (slot.stream) cudaStreamDestroy(slot.stream);
+            slot = Slot();
+        }
+        cudaFree(cosZenith);
+        cudaFree(cosLat);
+        cudaFree(tanLat);
+        cudaFree(longitude);
+        cosZenith = nullptr;
+        cosLat = tanLat = longitude = nullptr;
+        batchDays = 0;
+    }
+    
+    template <typename Real>
+    bool upload(const SolarGrid& grid, const Real* table, double tz, double units, int maxBatchDays) {
+        release();
+        useFloat = sizeof(Real) == sizeof(float);
+        width = grid.width();
+        height = grid.height();
+        pixels = static_cast<size_t>(width) * height;
+        timezoneOffset = tz;
+        unitsPerHour = units;
+        
+        std::vector<double> cosLatHost(height), tanLatHost(height), longitudeHost(width);
+        for (int row = 0; row < height; ++row) {
+            cosLatHost[row] = grid.cosLatitude(row);
+            tanLatHost[row] = grid.tanLatitude(row);
+        }
+        for (int col = 0; col < width; ++col) {
+            longitudeHost[col] = grid.longitude(col);
+        }
+        
+        if (!cudaOk(cudaMalloc(&cosZenith, pixels * sizeof(Real)), "zenith table allocation") ||
+            !cudaOk(cudaMalloc(reinterpret_cast<void**>(&cosLat), height * sizeof(double)), "allocation") ||
+            !cudaOk(cudaMalloc(reinterpret_cast<void**>(&tanLat), height * sizeof(double)), "allocation") ||
+            !cudaOk(cudaMalloc(reinterpret_cast<void**>(&longitude), width * sizeof(double)), "allocation") ||
+            !cudaOk(cudaMemcpy(cosZenith, table, pixels * sizeof(Real), cudaMemcpyHostToDevice), "upload") ||
+            !cudaOk(cudaMemcpy(cosLat, cosLatHost.data(), height * sizeof(double), cudaMemcpyHostToDevice), "upload") ||
+            !cudaOk(cudaMemcpy(tanLat, tanLatHost.data(), height * sizeof(double), cudaMemcpyHostToDevice), "upload") ||
+            !cudaOk(cudaMemcpy(longitude, longitudeHost.data(), width * sizeof(double), cudaMemcpyHostToDevice), "upload")) {
+            release();
+            return false;
+        }
+        
+        // Days per launch: both slots' outputs must fit the free device memory
+        size_t freeBytes = 0, totalBytes = 0;
+        if (!cudaOk(cudaMemGetInfo(&freeBytes, &totalBytes), "memory query")) {
+            release();
+            return false;
+        }
+        size_t dayBytes = 2 * pixels * sizeof(int16_t) + 2 * (height + width) * sizeof(Real);
+        size_t usable = freeBytes > DEVICE_RESERVE_BYTES ? freeBytes - DEVICE_RESERVE_BYTES : 0;
+        size_t fitDays = usable / (NUM_SLOTS * dayBytes);
+        batchDays = static_cast<int>(std::min<size_t>({fitDays, static_cast<size_t>(std::max(maxBatchDays, 1)),
+                                                      static_cast<size_t>(MAX_BATCH_DAYS)}));
+        if (batchDays < 1) {
+            std::cerr << "Error: GPU memory too small for one day of output ("
+                      << NUM_SLOTS * dayBytes << " bytes)" << std::endl;
+            release();
+            return false;
+        }
+        
+        for (Slot& slot : slots) {
+            size_t outputBytes = static_cast<size_t>(batchDays) * 2 * pixels * sizeof(int16_t);
+            if (!cudaOk(cudaStreamCreateWithFlags(&slot.stream, cudaStreamNonBlocking), "stream creation") ||
+                !cudaOk(cudaMalloc(&slot.rowScale, batchDays * height * sizeof(Real)), "allocation") ||
+                !cudaOk(cudaMalloc(&slot.rowOffset, batchDays * height * sizeof(Real)), "allocation") ||
+                !cudaOk(cudaMalloc(&slot.solarNoon, batchDays * width * sizeof(Real)), "allocation") ||
+                !cudaOk(cudaMalloc(reinterpret_cast<void**>(&slot.output), outputBytes), "output allocation") ||
+                !cudaOk(cudaMallocHost(reinterpret_cast<void**>(&slot.host), outputBytes), "pinned allocation")) {
+                release();
+                return false;
+            }
+        }
+        
+        cudaDeviceProp properties;
+        int device = 0;
+        cudaGetDevice(&device);
+        cudaGetDeviceProperties(&properties, device);
+        std::cerr << "GPU: " << properties.name << ", " << batchDays << " days per launch ("
+                  << (useFloat ? "float" : "double") << ")" << std::endl;
+        return true;
+    }
+    
+    template <typename Real>
+    bool launch(Slot& slot, const DayEphemeris* days, int count) {
+        GpuKernels::BatchArgs<Real> args;
+        args.cosZenith = static_cast<const Real*>(cosZenith);
+        args.cosLat = cosLat;
+        args.tanLat = tanLat;
+        args.longitude = longitude;
+        args.rowScale = static_cast<Real*>(slot.rowScale);
+        args.rowOffset = static_cast<Real*>(slot.rowOffset);
+        args.solarNoon = static_cast<Real*>(slot.solarNoon);
+        args.output = slot.output;
+        for (int d = 0; d < count; ++d) {
+            args.days[d].cosDecl = days[d].cosDecl;
+            args.days[d].tanDecl = days[d].tanDecl;
+            args.days[d].eqTime = days[d].eqTime;
+        }
+        args.numDays = count;
+        args.width = width;
+        args.height = height;
+        args.timezoneOffset = static_cast<Real>(timezoneOffset);
+        args.unitsPerHour = static_cast<Real>(unitsPerHour);
+        
+        size_t bytes = static_cast<size_t>(count) * 2 * pixels * sizeof(int16_t);
+        return cudaOk(GpuKernels::launchBatch(args, slot.stream), "kernel launch") &&
+               cudaOk(cudaMemcpyAsync(slot.host, slot.output, bytes, cudaMemcpyDeviceToHost, slot.stream),
+                      "copy to host");
+    }
+};
+
+GpuSolver::GpuSolver() : impl_(new Impl) {}
+
+GpuSolver::~GpuSolver() = default;
+
+bool GpuSolver::isAvailable() {
+    int count = 0;
+    return cudaGetDeviceCount(&count) == cudaSuccess && count > 0;
+}
+
+bool GpuSolver::upload(const SolarGrid& grid, const double* cosZenith, double timezoneOffset,
+                       double unitsPerHour, int maxBatchDays) {
+    return impl_->upload(grid, cosZenith, timezoneOffset, unitsPerHour, maxBatchDays);
+}
+
+bool GpuSolver::upload(const SolarGrid& grid, const float* cosZenith, double timezoneOffset,
+                       double unitsPerHour, int maxBatchDays) {
+    return impl_->upload(grid, cosZenith, timezoneOffset, unitsPerHour, maxBatchDays);
+}
+
+int GpuSolver::batchDays() const {
+    return impl_->batchDays;
+}
+
+bool GpuSolver::launch(int slot, const DayEphemeris* days, int count) {
+    Impl::Slot& target = impl_->slots[slot];
+    target.numDays = std::min(count, impl_->batchDays);
+    return impl_->useFloat ? impl_->launch<float>(target, days, target.numDays)
+                           : impl_->launch<double>(target, days, target.numDays);
+}
+
+bool GpuSolver::wait(int slot) {
+    return cudaOk(cudaStreamSynchronize(impl_->slots[slot].stream), "batch");
+}
+
+const int16_t* GpuSolver::sunrise(int slot, int day) const {
+    return impl_->slots[slot].host + static_cast<size_t>(day) * 2 * impl_->pixels;
+}
+
+const int16_t* GpuSolver::sunset(int slot, int day) const {
+    return sunrise(slot, day) + impl_->pixels;
+}
+
+#else // !SOLAR_HAVE_CUDA
+
+struct GpuSolver::Impl {};
+
+GpuSolver::GpuSolver() : impl_(new Impl) {}
+
+GpuSolver::~GpuSolver() = default;
+
+bool GpuSolver::isAvailable() {
+    return false;
+}
+
+bool GpuSolver::upload(const SolarGrid&, const double*, double, double, int) {
+    std::cerr << "Error: --device gpu requires a build with -DSOLAR_WITH_CUDA=ON" << std::endl;
+    return false;
+}
+
+bool GpuSolver::upload(const SolarGrid&, const float*, double, double, int) {
+    std::cerr << "Error: --device gpu requires a build with -DSOLAR_WITH_CUDA=ON" << std::endl;
+    return false;
+}
+
+int GpuSolver::batchDays() const {
+    return 0;
+}
+
+bool GpuSolver::launch(int, const DayEphemeris*, int) {
+    return false;
+}
+
+bool GpuSolver::wait(int) {
+    return false;
+}
+
+const int16_t* GpuSolver::sunrise(int, int) const {
+    return nullptr;
+}
+
+const int16_t* GpuSolver::sunset(int, int) const {
+    return nullptr;
+}
+
+#endif // SOLAR_HAVE_CUDA
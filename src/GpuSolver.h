@@ -0,0 +1,79 @@
+#ifndef GPU_SOLVER_H
+#define GPU_SOLVER_H
+
+#include <cstdint>
+#include <memory>
+#include "SolarCalculator.h"
+#include "SolarGrid.h"
+
+/**
+ * GpuSolver class
+ * 
+ * Separable hour-angle solver on a CUDA device, for --stream --device gpu.
+ * The zenith table of the raster and the per-row latitude and per-column
+ * longitude terms are uploaded once; each launch then computes a batch of
+ * days, copied back into pinned host buffers.
+ * 
+ * Two batch slots alternate, each on its own CUDA stream: while the caller
+ * encodes the days of one slot, the device computes and transfers the
+ * next batch into the other. Results are the whole raster, -1 for masked
+ * pixels, and match the CPU kernels of the same precision (see
+ * GpuKernels.h). Only available in builds with SOLAR_WITH_CUDA.
+ */
+class GpuSolver {
+public:
+    static constexpr int NUM_SLOTS = 2;
+    static constexpr int MAX_BATCH_DAYS = 16;
+    
+    GpuSolver();
+    ~GpuSolver();
+    
+    GpuSolver(const GpuSolver&) = delete;
+    GpuSolver& operator=(const GpuSolver&) = delete;
+    
+    /**
+     * True if this build includes the CUDA backend and a device is present
+     */
+    static bool isAvailable();
+    
+    /**
+     * Upload the zenith table of the whole raster and the grid terms, and
+     * allocate the batch buffers
+     * @param cosZenith Per-pixel zenith term, NaN for masked pixels
+     * @param unitsPerHour Output time units per hour (SolarCalculator::timeUnitsPerHour)
+     * @param maxBatchDays Upper bound of days per launch (host memory budget)
+     * @return false if the device or pinned memory cannot be allocated
+     */
+    bool upload(const SolarGrid& grid, const double* cosZenith, double timezoneOffset,
+                double unitsPerHour, int maxBatchDays);
+    bool upload(const SolarGrid& grid, const float* cosZenith, double timezoneOffset,
+                double unitsPerHour, int maxBatchDays);
+    
+    /**
+     * Days computed per launch, set by upload()
+     */
+    int batchDays() const;
+    
+    /**
+     * Start computing count days (at most batchDays()) into a slot; returns
+     * without waiting. The slot's previous results must have been consumed.
+     */
+    bool launch(int slot, const DayEphemeris* days, int count);
+    
+    /**
+     * Wait for the batch of a slot
+     */
+    bool wait(int slot);
+    
+    /**
+     * Results of the day-th day of a waited slot, one value per pixel
+     */
+    const int16_t* sunrise(int slot, int day) const;
+    const int16_t* sunset(int slot, int day) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+#endif // GPU_SOLVER_H
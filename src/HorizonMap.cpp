@@ -0,0 +1,244 @@
+#include "HorizonMap.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Earth radius with the standard refraction coefficient (k = 0.13)
+const double EFFECTIVE_EARTH_RADIUS = 6371000.0 / (1.0 - 0.13);
+
+// Meters per degree of latitude / of longitude at the equator
+const double METERS_PER_DEGREE = 111320.0;
+
+// Bump when the sweep changes results, so that old caches are recomputed
+const uint32_t ALGORITHM_VERSION = 1;
+
+const char CACHE_MAGIC[8] = {'S', 'C', 'H', 'O', 'R', 'I', 'Z', 'N'};
+const size_t CACHE_HEADER_BYTES = 64;
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    int32_t numSectors;
+    uint64_t key;
+};
+
+// 64-bit FNV-1a
+inline uint64_t fnv1a(const void* data, size_t bytes, uint64_t hash) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < bytes; ++i) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+} // namespace
+
+HorizonMap::HorizonMap(int numSectors)
+    : numSectors_(std::max(numSectors, 1)), width_(0), height_(0), data_(nullptr),
+      mapping_(nullptr), mappingBytes_(0) {}
+
+HorizonMap::~HorizonMap() {
+    unmap();
+}
+
+void HorizonMap::unmap() {
+    if (mapping_) {
+        munmap(mapping_, mappingBytes_);
+        mapping_ = nullptr;
+        mappingBytes_ = 0;
+    }
+}
+
+uint64_t HorizonMap::cacheKey(const float* dem, int width, int height, const double* geoTransform,
+                              bool geographic, float nodata) const {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    int32_t params[5] = {width, height, numSectors_, static_cast<int32_t>(ALGORITHM_VERSION),
+                         geographic ? 1 : 0};
+    hash = fnv1a(params, sizeof(params), hash);
+    hash = fnv1a(geoTransform, 6 * sizeof(double), hash);
+    hash = fnv1a(&nodata, sizeof(nodata), hash);
+    
+    // Hash row chunks in parallel, then combine the chunk hashes in order
+    size_t pixels = static_cast<size_t>(width) * height;
+    const size_t CHUNK = 1 << 20;
+    size_t numChunks = (pixels + CHUNK - 1) / CHUNK;
+    std::vector<uint64_t> chunkHashes(numChunks);
+    
+    #pragma omp parallel for schedule(static)
+    for (size_t c = 0; c < numChunks; ++c) {
+        size_t begin = c * CHUNK;
+        size_t count = std::min(CHUNK, pixels - begin);
+        chunkHashes[c] = fnv1a(dem + begin, count * sizeof(float), 0xcbf29ce484222325ull);
+    }
+    return fnv1a(chunkHashes.data(), numChunks * sizeof(uint64_t), hash);
+}
+
+bool HorizonMap::loadCache(const std::string& path, uint64_t key, int width, int height) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    
+    size_t dataBytes = bytesFor(static_cast<size_t>(width) * height, numSectors_);
+    struct stat info;
+    CacheHeader header;
+    bool valid = fstat(fd, &info) == 0 &&
+                 static_cast<size_t>(info.st_size) == CACHE_HEADER_BYTES + dataBytes &&
+                 pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+                 std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+                 header.version == ALGORITHM_VERSION && header.width == width &&
+                 header.height == height && header.numSectors == numSectors_ && header.key == key;
+    if (!valid) {
+        close(fd);
+        return false;
+    }
+    
+    void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    
+    unmap();
+    std::vector<int16_t>().swap(angles_);
+    mapping_ = mapping;
+    mappingBytes_ = info.st_size;
+    width_ = width;
+    height_ = height;
+    data_ = reinterpret_cast<const int16_t*>(static_cast<const char*>(mapping) + CACHE_HEADER_BYTES);
+    return true;
+}
+
+bool HorizonMap::saveCache(const std::string& path, uint64_t key) const {
+    CacheHeader header;
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = ALGORITHM_VERSION;
+    header.width = width_;
+    header.height = height_;
+    header.numSectors = numSectors_;
+    header.key = key;
+    
+    char padded[CACHE_HEADER_BYTES] = {};
+    std::memcpy(padded, &header, sizeof(header));
+    
+    // Concurrent jobs on the same DEM each write their own file; rename is atomic
+    std::string tempPath = path + ".tmp." + std::to_string(getpid());
+    std::ofstream out(tempPath, std::ios::binary);
+    out.write(padded, sizeof(padded));
+    out.write(reinterpret_cast<const char*>(data_),
+              bytesFor(static_cast<size_t>(width_) * height_, numSectors_));
+    out.close();
+    
+    if (!out || std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+void HorizonMap::compute(const float* dem, int width, int height, const double* geoTransform,
+                         bool geographic, float nodata) {
+    unmap();
+    width_ = width;
+    height_ = height;
+    angles_.assign(static_cast<size_t>(width) * height * numSectors_, NO_HORIZON);
+    data_ = angles_.data();
+    
+    // Pixel size on the ground; geographic rasters use the central latitude
+    double metersX = std::abs(geoTransform[1]);
+    double metersY = std::abs(geoTransform[5]);
+    if (geographic) {
+        double centerLat = geoTransform[3] + geoTransform[5] * height * 0.5;
+        metersX *= METERS_PER_DEGREE * std::cos(centerLat * M_PI / 180.0);
+        metersY *= METERS_PER_DEGREE;
+    }
+    
+    for (int sector = 0; sector < numSectors_; ++sector) {
+        sweepSector(sector, dem, nodata, metersX, metersY);
+    }
+}
+
+void HorizonMap::sweepSector(int sector, const float* dem, float nodata,
+                             double metersX, double metersY) {
+    // Direction towards the horizon, in pixels (rows grow southwards)
+    double azimuth = 2.0 * M_PI * sector / numSectors_;
+    double dirCol = std::sin(azimuth) / metersX;
+    double dirRow = -std::cos(azimuth) / metersY;
+    
+    // Lines advance one pixel per step along the major axis and drift
+    // by 'slope' pixels along the minor axis. Every pixel lies on exactly
+    // one line: minor = offset + round(step * slope).
+    bool alongColumns = std::abs(dirCol) >= std::abs(dirRow);
+    int majorSize = alongColumns ? width_ : height_;
+    int minorSize = alongColumns ? height_ : width_;
+    int majorStep = (alongColumns ? dirCol : dirRow) >= 0 ? 1 : -1;
+    double slope = alongColumns ? dirRow / std::abs(dirCol) : dirCol / std::abs(dirRow);
+    double stepMeters = alongColumns ? std::hypot(metersX, slope * metersY)
+                                     : std::hypot(metersY, slope * metersX);
+    
+    int maxDrift = static_cast<int>(std::ceil(std::abs(slope) * majorSize)) + 1;
+    int firstOffset = -maxDrift;
+    int lastOffset = minorSize - 1 + maxDrift;
+    
+    #pragma omp parallel
+    {
+        // Upper hull of the terrain ahead: distance along the line and
+        // curvature-corrected height, nearest point last
+        std::vector<double> hullT, hullH;
+        
+        #pragma omp for schedule(dynamic, 16)
+        for (int offset = firstOffset; offset <= lastOffset; ++offset) {
+            hullT.clear();
+            hullH.clear();
+            
+            // Walk from the far end of the line back towards its start
+            for (int step = majorSize - 1; step >= 0; --step) {
+                int minor = offset + static_cast<int>(std::lround(step * slope));
+                if (minor < 0 || minor >= minorSize) {
+                    continue;
+                }
+                int major = majorStep > 0 ? step : majorSize - 1 - step;
+                int col = alongColumns ? major : minor;
+                int row = alongColumns ? minor : major;
+                size_t index = static_cast<size_t>(row) * width_ + col;
+                
+                float elevation = dem[index];
+                if (std::isnan(elevation) || elevation == nodata) {
+                    continue;
+                }
+                
+                // With H = h - t^2 / 2R, the curved-earth tangent from point i
+                // to point j is (H_j - H_i) / (t_j - t_i) + t_i / R, so the
+                // hull of (t, H) yields the exact horizon
+                double t = step * stepMeters;
+                double h = elevation - t * t / (2.0 * EFFECTIVE_EARTH_RADIUS);
+                
+                size_t n = hullT.size();
+                while (n >= 2 &&
+                       (hullH[n - 1] - h) * (hullT[n - 2] - t) <= (hullH[n - 2] - h) * (hullT[n - 1] - t)) {
+                    hullT.pop_back();
+                    hullH.pop_back();
+                    --n;
+                }
+                if (n > 0) {
+                    double tangent = (hullH[n - 1] - h) / (hullT[n - 1] - t) + t / EFFECTIVE_EARTH_RADIUS;
+                    double degrees = std::atan(tangent) * 180.0 / M_PI;
+                    angles_[index * numSectors_ + sector] = static_cast<int16_t>(std::lround(degrees * 100.0));
+                }
+                hullT.push_back(t);
+                hullH.push_back(h);
+            }
+        }
+    }
+}
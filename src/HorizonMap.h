@@ -0,0 +1,129 @@
+#ifndef HORIZON_MAP_H
+#define HORIZON_MAP_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * HorizonMap class
+ * 
+ * Terrain horizon elevation angle of every DEM pixel over N azimuth
+ * sectors. Sector k is centered on azimuth 360 * k / N degrees, clockwise
+ * from north. Angles are stored pixel-major ([pixel][sector]) as Int16
+ * centidegrees, so the horizon of one pixel is contiguous; -9000 means
+ * no terrain in that direction (raster edge or masked pixel).
+ * 
+ * Horizons depend only on the DEM, so they can be saved to a cache file
+ * and memory-mapped by later runs (other years or timezones):
+ * 
+ *   magic[8] "SCHORIZN", uint32 version, int32 width, height, numSectors,
+ *   uint64 key, padding to 64 bytes, int16 angles[width * height * numSectors]
+ * 
+ * The key is an FNV-1a hash of the DEM and the algorithm parameters
+ * (see cacheKey); a file with another key is ignored and rewritten.
+ * 
+ * Each direction is computed with a sweep along parallel raster lines
+ * that keeps the upper convex hull of the terrain ahead, which makes the
+ * cost linear in the number of pixels instead of ray marching. Earth
+ * curvature (with standard refraction) is included exactly.
+ */
+class HorizonMap {
+public:
+    static constexpr int16_t NO_HORIZON = -9000;
+    
+    /**
+     * Constructor
+     * @param numSectors Number of azimuth sectors (e.g. 16 or 32)
+     */
+    explicit HorizonMap(int numSectors = 16);
+    
+    ~HorizonMap();
+    
+    HorizonMap(const HorizonMap&) = delete;
+    HorizonMap& operator=(const HorizonMap&) = delete;
+    
+    /**
+     * Compute the horizon of all pixels of a DEM held in memory
+     * @param dem Elevations in meters, row-major
+     * @param geoTransform GDAL geotransform (north-up)
+     * @param geographic True if the geotransform is in degrees (else meters)
+     * @param nodata DEM nodata value; NaN and nodata pixels are not terrain
+     */
+    void compute(const float* dem, int width, int height, const double* geoTransform,
+                 bool geographic, float nodata);
+    
+    int numSectors() const { return numSectors_; }
+    int width() const { return width_; }
+    int height() const { return height_; }
+    
+    /**
+     * Horizon angles of one pixel (numSectors centidegree values)
+     * @param index Pixel index, row * width + column
+     */
+    const int16_t* pixel(size_t index) const { return data_ + index * numSectors_; }
+    
+    /**
+     * Cache key of a DEM for this sector count
+     * @param dem Elevations, row-major
+     * @param geographic See compute()
+     */
+    uint64_t cacheKey(const float* dem, int width, int height, const double* geoTransform,
+                      bool geographic, float nodata) const;
+    
+    /**
+     * Map a cache file if it exists and matches the key
+     * @return true if the horizon was loaded
+     */
+    bool loadCache(const std::string& path, uint64_t key, int width, int height);
+    
+    /**
+     * Write the computed horizon to a cache file (atomically, via rename)
+     * @return true if successful, false otherwise
+     */
+    bool saveCache(const std::string& path, uint64_t key) const;
+    
+    /**
+     * Horizon angle in degrees at an azimuth, interpolated between sectors
+     * @param horizon Angles of one pixel (see pixel())
+     * @param azimuth Azimuth in radians, clockwise from north, in [0, 2 pi]
+     */
+    static double angleAt(const int16_t* horizon, int numSectors, double azimuth) {
+        double position = azimuth * numSectors / (2.0 * M_PI);
+        int k0 = static_cast<int>(position);
+        double frac = position - k0;
+        k0 %= numSectors;
+        int k1 = (k0 + 1) % numSectors;
+        return 0.01 * (horizon[k0] + frac * (horizon[k1] - horizon[k0]));
+    }
+    
+    /**
+     * Memory needed for a raster, in bytes
+     */
+    static size_t bytesFor(size_t pixels, int numSectors) {
+        return pixels * numSectors * sizeof(int16_t);
+    }
+    
+private:
+    int numSectors_;
+    int width_;
+    int height_;
+    std::vector<int16_t> angles_;   // Computed horizon
+    const int16_t* data_;           // angles_ or the mapped cache
+    
+    // Memory-mapped cache file
+    void* mapping_;
+    size_t mappingBytes_;
+    
+    void unmap();
+    
+    /**
+     * Sweep all raster lines parallel to one sector direction
+     */
+    void sweepSector(int sector, const float* dem, float nodata,
+                     double metersX, double metersY);
+};
+
+#endif // HORIZON_MAP_H
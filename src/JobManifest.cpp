@@ -0,0 +1,51 @@
+#include "JobManifest.h"
+#include <iostream>
+#include "cpl_json.h"
+
+bool JobManifest::load(const std::string& path, std::vector<DemJob>& jobs,
+                       int defaultYear, double defaultTimezone) {
+    CPLJSONDocument document;
+    if (!document.Load(path)) {
+        std::cerr << "Error: Cannot read job manifest: " << path << std::endl;
+        return false;
+    }
+    
+    CPLJSONObject root = document.GetRoot();
+    int year = root.GetInteger("year", defaultYear);
+    double timezoneOffset = root.GetDouble("timezone", defaultTimezone);
+    
+    CPLJSONArray entries = root.GetArray("jobs");
+    if (!entries.IsValid() || entries.Size() == 0) {
+        std::cerr << "Error: Job manifest has no \"jobs\" array: " << path << std::endl;
+        return false;
+    }
+    
+    jobs.clear();
+    for (int i = 0; i < entries.Size(); ++i) {
+        CPLJSONObject entry = entries[i];
+        DemJob job;
+        job.inputPath = entry.GetString("input");
+        job.outputPath = entry.GetString("output");
+        job.parquetPath = entry.GetString("parquet");
+        job.year = entry.GetInteger("year", year);
+        job.timezoneOffset = entry.GetDouble("timezone", timezoneOffset);
+        
+        if (job.inputPath.empty()) {
+            std::cerr << "Error: Job " << i << " of " << path << " has no \"input\"" << std::endl;
+            return false;
+        }
+        if (job.outputPath.empty() == job.parquetPath.empty()) {
+            std::cerr << "Error: Job " << i << " (" << job.inputPath
+                      << ") needs exactly one of \"output\" and \"parquet\"" << std::endl;
+            return false;
+        }
+        if (job.year < 1900 || job.year > 2100) {
+            std::cerr << "Error: Job " << i << " (" << job.inputPath
+                      << ") year must be between 1900 and 2100" << std::endl;
+            return false;
+        }
+        jobs.push_back(job);
+    }
+    
+    return true;
+}
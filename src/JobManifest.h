@@ -0,0 +1,46 @@
+#ifndef JOB_MANIFEST_H
+#define JOB_MANIFEST_H
+
+#include <string>
+#include <vector>
+
+/**
+ * One DEM of a --jobs manifest
+ * 
+ * Exactly one of outputPath (GeoTIFF) and parquetPath is set.
+ */
+struct DemJob {
+    std::string inputPath;
+    std::string outputPath;
+    std::string parquetPath;
+    int year = 2025;
+    double timezoneOffset = 1.0;
+};
+
+/**
+ * JobManifest class
+ * 
+ * Reads the JSON list of DEMs processed by one --jobs run:
+ * 
+ *   {
+ *     "year": 2025,                  optional defaults for all jobs
+ *     "timezone": 1.0,
+ *     "jobs": [
+ *       {"input": "dem_dept_38.tif", "output": "solar_38.tif"},
+ *       {"input": "dem_dept_05.tif", "parquet": "dept=05/data.parquet", "year": 2026}
+ *     ]
+ *   }
+ */
+class JobManifest {
+public:
+    /**
+     * Parse a manifest file
+     * @param defaultYear Year of jobs without "year" when the manifest has none
+     * @param defaultTimezone Timezone of jobs without "timezone" when the manifest has none
+     * @return false (with a message on stderr) if the file or a job is invalid
+     */
+    static bool load(const std::string& path, std::vector<DemJob>& jobs,
+                     int defaultYear = 2025, double defaultTimezone = 1.0);
+};
+
+#endif // JOB_MANIFEST_H
@@ -0,0 +1,385 @@
+#include "KernelValidator.h"
+#include "GpuSolver.h"
+#include "SolarGrid.h"
+#include "SolarKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+/**
+ * NOAA sunrise/sunset of a site (sea level, standard time, 2025), from the
+ * NOAA Solar Calculator equations evaluated at the time of each event
+ */
+struct ReferenceSite {
+    const char* name;
+    double latitude;
+    double longitude;    // East positive
+    double timezone;     // Hours
+    int month;
+    int day;
+    int sunrise;         // Minutes after local midnight, -1 if none
+    int sunset;
+    DayStatus status;
+};
+
+const int REFERENCE_YEAR = 2025;
+
+const ReferenceSite REFERENCE_SITES[] = {
+    {"Paris", 48.8566, 2.3522, 1, 3, 20, 413, 1144, DayStatus::Normal},
+    {"Paris", 48.8566, 2.3522, 1, 6, 21, 287, 1258, DayStatus::Normal},
+    {"Paris", 48.8566, 2.3522, 1, 9, 22, 397, 1128, DayStatus::Normal},
+    {"Paris", 48.8566, 2.3522, 1, 12, 21, 521, 1016, DayStatus::Normal},
+    {"Grenoble", 45.1885, 5.7245, 1, 3, 20, 400, 1130, DayStatus::Normal},
+    {"Grenoble", 45.1885, 5.7245, 1, 6, 21, 290, 1228, DayStatus::Normal},
+    {"Grenoble", 45.1885, 5.7245, 1, 9, 22, 384, 1114, DayStatus::Normal},
+    {"Grenoble", 45.1885, 5.7245, 1, 12, 21, 493, 1018, DayStatus::Normal},
+    {"Brest", 48.3904, -4.4861, 1, 3, 20, 441, 1171, DayStatus::Normal},
+    {"Brest", 48.3904, -4.4861, 1, 6, 21, 317, 1283, DayStatus::Normal},
+    {"Brest", 48.3904, -4.4861, 1, 9, 22, 425, 1156, DayStatus::Normal},
+    {"Brest", 48.3904, -4.4861, 1, 12, 21, 547, 1046, DayStatus::Normal},
+    {"Marseille", 43.2965, 5.3698, 1, 3, 20, 402, 1131, DayStatus::Normal},
+    {"Marseille", 43.2965, 5.3698, 1, 6, 21, 298, 1222, DayStatus::Normal},
+    {"Marseille", 43.2965, 5.3698, 1, 9, 22, 386, 1116, DayStatus::Normal},
+    {"Marseille", 43.2965, 5.3698, 1, 12, 21, 488, 1026, DayStatus::Normal},
+    {"Quito", -0.1807, -78.4678, -5, 3, 20, 378, 1104, DayStatus::Normal},
+    {"Quito", -0.1807, -78.4678, -5, 6, 21, 372, 1099, DayStatus::Normal},
+    {"Quito", -0.1807, -78.4678, -5, 9, 22, 363, 1090, DayStatus::Normal},
+    {"Quito", -0.1807, -78.4678, -5, 12, 21, 368, 1096, DayStatus::Normal},
+    {"Sydney", -33.8688, 151.2093, 10, 3, 20, 358, 1087, DayStatus::Normal},
+    {"Sydney", -33.8688, 151.2093, 10, 6, 21, 420, 1014, DayStatus::Normal},
+    {"Sydney", -33.8688, 151.2093, 10, 9, 22, 345, 1071, DayStatus::Normal},
+    {"Sydney", -33.8688, 151.2093, 10, 12, 21, 281, 1146, DayStatus::Normal},
+    {"Reykjavik", 64.1466, -21.9426, 0, 3, 20, 448, 1184, DayStatus::Normal},
+    {"Reykjavik", 64.1466, -21.9426, 0, 6, 21, 175, 4, DayStatus::Normal},
+    {"Reykjavik", 64.1466, -21.9426, 0, 9, 22, 431, 1168, DayStatus::Normal},
+    {"Reykjavik", 64.1466, -21.9426, 0, 12, 21, 682, 930, DayStatus::Normal},
+    {"Tromso", 69.6492, 18.9553, 1, 3, 20, 343, 1083, DayStatus::Normal},
+    {"Tromso", 69.6492, 18.9553, 1, 6, 21, -1, -1, DayStatus::PolarDay},
+    {"Tromso", 69.6492, 18.9553, 1, 9, 22, 325, 1067, DayStatus::Normal},
+    {"Tromso", 69.6492, 18.9553, 1, 12, 21, -1, -1, DayStatus::PolarNight},
+    {"Longyearbyen", 78.2232, 15.6267, 1, 3, 20, 350, 1104, DayStatus::Normal},
+    {"Longyearbyen", 78.2232, 15.6267, 1, 6, 21, -1, -1, DayStatus::PolarDay},
+    {"Longyearbyen", 78.2232, 15.6267, 1, 9, 22, 330, 1087, DayStatus::Normal},
+    {"Longyearbyen", 78.2232, 15.6267, 1, 12, 21, -1, -1, DayStatus::PolarNight},
+};
+
+// The calculator evaluates the ephemeris once per day (0h UT) where NOAA
+// follows the sun to the event; near the equinoxes the gap grows with
+// tan(latitude), to about 5 min in Svalbard
+int siteTolerance(double latitude) {
+    return std::fabs(latitude) <= 60.0 ? 2 : 6;
+}
+
+// Kernel variants against the double reference: rounding of the polynomial
+// acos, and the float guarantee of --precision (see validatePrecision)
+const int DOUBLE_TOLERANCE = 1;
+const int FLOAT_TOLERANCE = 1;
+
+// Same mask as the binary stream
+inline bool isMasked(float elevation, float nodata) {
+    return std::isnan(elevation) || elevation == nodata || elevation == 0.0f;
+}
+
+inline int minuteDistance(int a, int b) {
+    int diff = std::abs(a - b);
+    return std::min(diff, 1440 - diff);
+}
+
+inline int16_t toMinutes(double hours) {
+    return hours == -9999.0 ? -1 : static_cast<int16_t>(std::round(hours * 60.0));
+}
+
+const char* statusName(DayStatus status) {
+    switch (status) {
+        case DayStatus::Normal: return "normal";
+        case DayStatus::PolarDay: return "polar day";
+        case DayStatus::PolarNight: return "polar night";
+    }
+    return "unknown";
+}
+
+/**
+ * Deviation of one variant from the reference, over all days of a tile
+ */
+struct VariantStats {
+    std::string name;
+    bool isFloat = false;
+    int maxDiff = 0;
+    long long eventsAsNone = 0;     // Reference event, variant -1
+    long long noneAsEvents = 0;     // Reference polar day/night, variant event
+    long long noneAgreed = 0;       // Both without event
+    long long maskedWrong = 0;      // Masked pixel not -1
+    long long differsFromScalar = 0;
+};
+
+/**
+ * Row kernel inputs of a tile in one precision
+ */
+template <typename Real>
+struct TileTables {
+    std::vector<Real> cosZenith;
+    std::vector<Real> solarNoon;
+    
+    TileTables(const float* dem, size_t count, int width, float nodata)
+        : cosZenith(count), solarNoon(width) {
+        for (size_t i = 0; i < count; ++i) {
+            cosZenith[i] = isMasked(dem[i], nodata) ? std::numeric_limits<Real>::quiet_NaN()
+                                                    : static_cast<Real>(SolarCalculator::zenithCosine(dem[i]));
+        }
+    }
+    
+    void computeDay(SolarKernels::RowKernel<Real> kernel, const SolarGrid& grid, const DayEphemeris& eph,
+                    double timezoneOffset, int16_t* sunrise, int16_t* sunset) {
+        int width = grid.width();
+        grid.solarNoonTable(eph, 0, width, solarNoon.data());
+        #pragma omp parallel for schedule(static)
+        for (int row = 0; row < grid.height(); ++row) {
+            double rowScale, rowOffset;
+            grid.rowTerms(eph, row, rowScale, rowOffset);
+            size_t start = static_cast<size_t>(row) * width;
+            SolarKernels::RowArgs<Real> args;
+            args.cosZenith = &cosZenith[start];
+            args.solarNoon = solarNoon.data();
+            args.rowScale = static_cast<Real>(rowScale);
+            args.rowOffset = static_cast<Real>(rowOffset);
+            args.timezoneOffset = static_cast<Real>(timezoneOffset);
+            args.unitsPerHour = static_cast<Real>(60.0);
+            args.sunrise = &sunrise[start];
+            args.sunset = &sunset[start];
+            args.n = width;
+            kernel(args);
+        }
+    }
+};
+
+} // namespace
+
+KernelValidator::KernelValidator(int year, double timezoneOffset)
+    : year_(year), timezoneOffset_(timezoneOffset), ephemeris_(year), calc_(timezoneOffset) {}
+
+bool KernelValidator::checkReferenceSites() {
+    int maxDiff = 0;
+    int failures = 0;
+    int polarCases = 0;
+    for (const ReferenceSite& site : REFERENCE_SITES) {
+        SolarCalculator calc(site.timezone);
+        int sunrise = toMinutes(calc.calculateSunrise(site.latitude, site.longitude, 0.0,
+                                                      REFERENCE_YEAR, site.month, site.day));
+        int sunset = toMinutes(calc.calculateSunset(site.latitude, site.longitude, 0.0,
+                                                    REFERENCE_YEAR, site.month, site.day));
+        DayStatus status = calc.calculateDayEvents(calc.computeEphemeris(REFERENCE_YEAR, site.month, site.day),
+                                                   site.latitude, site.longitude, 0.0).status;
+        
+        bool ok = status == site.status && (sunrise < 0) == (site.sunrise < 0) && (sunset < 0) == (site.sunset < 0);
+        int diff = 0;
+        if (ok && site.status == DayStatus::Normal) {
+            diff = std::max(minuteDistance(sunrise, site.sunrise), minuteDistance(sunset, site.sunset));
+            maxDiff = std::max(maxDiff, diff);
+            ok = diff <= siteTolerance(site.latitude);
+        } else if (site.status != DayStatus::Normal) {
+            polarCases++;
+        }
+        if (!ok) {
+            failures++;
+            std::cout << "  " << site.name << " " << REFERENCE_YEAR << "-" << site.month << "-" << site.day
+                      << ": " << sunrise << "/" << sunset << " (" << statusName(status) << "), NOAA "
+                      << site.sunrise << "/" << site.sunset << " (" << statusName(site.status) << ")" << std::endl;
+        }
+    }
+    
+    int count = static_cast<int>(sizeof(REFERENCE_SITES) / sizeof(REFERENCE_SITES[0]));
+    std::cout << "Reference sites (NOAA): " << count << " site-days, " << polarCases
+              << " polar day/night" << std::endl;
+    std::cout << "  Max deviation: " << maxDiff << " min (tolerance 2 min within 60 degrees, 6 min beyond)"
+              << std::endl;
+    std::cout << (failures == 0 ? "  PASS" : "  FAIL") << " (" << failures << " outside tolerance or misclassified)"
+              << std::endl;
+    return failures == 0;
+}
+
+bool KernelValidator::checkEphemeris() {
+    double maxDecl = 0.0, maxEqTime = 0.0;
+    for (int i = 0; i < ephemeris_.numDays(); ++i) {
+        const DayEphemeris& cached = ephemeris_[i];
+        DayEphemeris direct = calc_.computeEphemeris(cached.year, cached.month, cached.day, cached.dayOfYear);
+        maxDecl = std::max(maxDecl, std::fabs(direct.declination - cached.declination));
+        maxEqTime = std::max(maxEqTime, std::fabs(direct.eqTime - cached.eqTime));
+    }
+    
+    bool ok = maxDecl <= 1e-9 && maxEqTime <= 1e-9;
+    std::cout << "Ephemeris table (" << year_ << "): max declination difference " << maxDecl
+              << " deg, equation of time " << maxEqTime << " min" << std::endl;
+    std::cout << (ok ? "  PASS" : "  FAIL") << std::endl;
+    return ok;
+}
+
+bool KernelValidator::checkTile(const std::string& name, const float* dem, int width, int height,
+                                const double* geoTransform, float nodata) {
+    SolarGrid grid(geoTransform, width, height);
+    if (!grid.isSeparable()) {
+        std::cerr << "Error: kernel validation requires a north-up geotransform (" << name << ")" << std::endl;
+        return false;
+    }
+    size_t count = static_cast<size_t>(width) * height;
+    TileTables<double> tables(dem, count, width, nodata);
+    TileTables<float> tablesFloat(dem, count, width, nodata);
+    
+    // CPU variants available on this machine, scalar first in each precision
+    using SolarKernels::Isa;
+    std::vector<VariantStats> variants;
+    std::vector<Isa> isas;
+    for (Isa isa : {Isa::Scalar, Isa::AVX2, Isa::AVX512}) {
+        if (isa <= SolarKernels::detectIsa() && SolarKernels::rowKernel<double>(isa)) {
+            isas.push_back(isa);
+        }
+    }
+    for (int precision = 0; precision < 2; ++precision) {
+        for (Isa isa : isas) {
+            VariantStats stats;
+            stats.name = std::string(SolarKernels::isaName(isa)) + (precision ? " float" : " double");
+            stats.isFloat = precision == 1;
+            variants.push_back(stats);
+        }
+    }
+    
+    // GPU variants, one day per launch
+    GpuSolver gpu, gpuFloat;
+    bool useGpu = GpuSolver::isAvailable() &&
+                  gpu.upload(grid, tables.cosZenith.data(), timezoneOffset_, 60.0, 1) &&
+                  gpuFloat.upload(grid, tablesFloat.cosZenith.data(), timezoneOffset_, 60.0, 1);
+    if (useGpu) {
+        VariantStats stats;
+        stats.name = "gpu double";
+        variants.push_back(stats);
+        stats.name = "gpu float";
+        stats.isFloat = true;
+        variants.push_back(stats);
+    }
+    
+    std::vector<int16_t> refSunrise(count), refSunset(count);
+    std::vector<int16_t> scalarSunrise(count), scalarSunset(count);
+    std::vector<int16_t> sunrise(count), sunset(count);
+    long long referenceEvents = 0, referenceNone = 0;
+    
+    for (int dayIndex = 0; dayIndex < ephemeris_.numDays(); ++dayIndex) {
+        const DayEphemeris& eph = ephemeris_[dayIndex];
+        
+        // calculateSolarTime per pixel; -1 for masked pixels and days without event
+        long long events = 0, none = 0;
+        #pragma omp parallel for schedule(static) reduction(+:events, none)
+        for (int row = 0; row < height; ++row) {
+            for (int col = 0; col < width; ++col) {
+                size_t i = static_cast<size_t>(row) * width + col;
+                refSunrise[i] = refSunset[i] = -1;
+                if (isMasked(dem[i], nodata)) {
+                    continue;
+                }
+                refSunrise[i] = toMinutes(calc_.calculateSunrise(eph, grid.latitude(row), grid.longitude(col), dem[i]));
+                refSunset[i] = toMinutes(calc_.calculateSunset(eph, grid.latitude(row), grid.longitude(col), dem[i]));
+                if (refSunrise[i] < 0) none++;
+                else events++;
+            }
+        }
+        referenceEvents += events;
+        referenceNone += none;
+        
+        for (size_t v = 0; v < variants.size(); ++v) {
+            VariantStats& stats = variants[v];
+            bool isGpu = useGpu && v + 2 >= variants.size();
+            if (isGpu) {
+                GpuSolver& solver = stats.isFloat ? gpuFloat : gpu;
+                if (!solver.launch(0, &eph, 1) || !solver.wait(0)) {
+                    return false;
+                }
+                std::copy(solver.sunrise(0, 0), solver.sunrise(0, 0) + count, sunrise.begin());
+                std::copy(solver.sunset(0, 0), solver.sunset(0, 0) + count, sunset.begin());
+            } else {
+                Isa isa = isas[v % isas.size()];
+                if (stats.isFloat) {
+                    tablesFloat.computeDay(SolarKernels::rowKernel<float>(isa), grid, eph, timezoneOffset_,
+                                           sunrise.data(), sunset.data());
+                } else {
+                    tables.computeDay(SolarKernels::rowKernel<double>(isa), grid, eph, timezoneOffset_,
+                                      sunrise.data(), sunset.data());
+                }
+            }
+            
+            // The scalar kernel of each precision is the bit-exact reference of the others
+            bool isScalar = !isGpu && v % isas.size() == 0;
+            if (isScalar) {
+                scalarSunrise = sunrise;
+                scalarSunset = sunset;
+            }
+            
+            int maxDiff = stats.maxDiff;
+            long long eventsAsNone = 0, noneAsEvents = 0, noneAgreed = 0, maskedWrong = 0, differs = 0;
+            #pragma omp parallel for schedule(static) reduction(max:maxDiff) \
+                reduction(+:eventsAsNone, noneAsEvents, noneAgreed, maskedWrong, differs)
+            for (size_t i = 0; i < count; ++i) {
+                differs += sunrise[i] != scalarSunrise[i] || sunset[i] != scalarSunset[i];
+                if (isMasked(dem[i], nodata)) {
+                    maskedWrong += sunrise[i] != -1 || sunset[i] != -1;
+                } else if (refSunrise[i] < 0) {
+                    if (sunrise[i] < 0) noneAgreed++;
+                    else noneAsEvents++;
+                } else if (sunrise[i] < 0) {
+                    eventsAsNone++;
+                } else {
+                    maxDiff = std::max(maxDiff, std::max(minuteDistance(sunrise[i], refSunrise[i]),
+                                                         minuteDistance(sunset[i], refSunset[i])));
+                }
+            }
+            stats.maxDiff = maxDiff;
+            stats.eventsAsNone += eventsAsNone;
+            stats.noneAsEvents += noneAsEvents;
+            stats.noneAgreed += noneAgreed;
+            stats.maskedWrong += maskedWrong;
+            stats.differsFromScalar += differs;
+        }
+    }
+    
+    std::cout << "Kernels on " << name << " (" << width << "x" << height << ", " << ephemeris_.numDays()
+              << " days): reference " << referenceEvents << " pixel-days with events, "
+              << referenceNone << " polar day/night (-9999)" << std::endl;
+    bool ok = true;
+    for (const VariantStats& stats : variants) {
+        int tolerance = stats.isFloat ? FLOAT_TOLERANCE : DOUBLE_TOLERANCE;
+        bool pass = stats.maxDiff <= tolerance && stats.eventsAsNone == 0 && stats.noneAsEvents == 0 &&
+                    stats.maskedWrong == 0 && stats.differsFromScalar == 0;
+        ok = ok && pass;
+        std::cout << "  " << stats.name << ": max deviation " << stats.maxDiff << " min, polar "
+                  << stats.noneAgreed << " as -1 / " << stats.noneAsEvents << " as events, events as -1 "
+                  << stats.eventsAsNone << ", masked not -1 " << stats.maskedWrong
+                  << ", differs from scalar " << stats.differsFromScalar
+                  << (pass ? "  PASS" : "  FAIL") << " (tolerance: " << tolerance << " min)" << std::endl;
+    }
+    return ok;
+}
+
+void KernelValidator::syntheticTile(int width, int height, std::vector<float>& dem, double* geoTransform) {
+    const double LAT_NORTH = 80.0, LAT_SOUTH = 30.0;
+    const double LON_WEST = -5.0, LON_EAST = 15.0;
+    geoTransform[0] = LON_WEST;
+    geoTransform[1] = (LON_EAST - LON_WEST) / width;
+    geoTransform[2] = 0.0;
+    geoTransform[3] = LAT_NORTH;
+    geoTransform[4] = 0.0;
+    geoTransform[5] = -(LAT_NORTH - LAT_SOUTH) / height;
+    
+    // Smooth terrain up to 4000 m, with one pixel in 17 left as nodata
+    dem.resize(static_cast<size_t>(width) * height);
+    for (int row = 0; row < height; ++row) {
+        for (int col = 0; col < width; ++col) {
+            size_t i = static_cast<size_t>(row) * width + col;
+            double x = static_cast<double>(col) / width;
+            double y = static_cast<double>(row) / height;
+            double terrain = 0.5 + 0.5 * std::sin(7.0 * x + 3.0 * y) * std::cos(5.0 * y - 2.0 * x);
+            dem[i] = (i % 17 == 0) ? std::numeric_limits<float>::quiet_NaN()
+                                   : static_cast<float>(1.0 + 4000.0 * terrain);
+        }
+    }
+}
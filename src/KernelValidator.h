@@ -0,0 +1,59 @@
+#ifndef KERNEL_VALIDATOR_H
+#define KERNEL_VALIDATOR_H
+
+#include <string>
+#include <vector>
+#include "SolarCalculator.h"
+#include "SolarEphemeris.h"
+
+/**
+ * KernelValidator class
+ * 
+ * Accuracy gate of the optimized paths (solar_tests). Three checks:
+ * 
+ *   - reference sites: SolarCalculator::calculateSolarTime against NOAA
+ *     sunrise/sunset times of sites from the equator to Svalbard, polar
+ *     day and night included;
+ *   - ephemeris table: SolarEphemeris days against computeEphemeris();
+ *   - kernels: every row kernel variant (instruction sets, double and
+ *     float, the GPU when available) on a DEM tile for every day of the
+ *     year, against calculateSolarTime evaluated per pixel.
+ * 
+ * Each check reports the maximum deviation in minutes and how no-event
+ * days (-9999 from the calculator, -1 in the kernel outputs) are
+ * classified; variants of one precision must also match the scalar
+ * kernel exactly.
+ */
+class KernelValidator {
+public:
+    /**
+     * @param year Year of the ephemeris and kernel checks
+     * @param timezoneOffset Offset of the kernel checks (sites use their own)
+     */
+    KernelValidator(int year, double timezoneOffset);
+
+    bool checkReferenceSites();
+    bool checkEphemeris();
+
+    /**
+     * Compare the kernel variants with the per-pixel reference on a tile
+     * @param dem Elevations, row-major; NaN, nodata and 0 m are masked as in --stream
+     * @param geoTransform North-up GDAL geotransform of the tile
+     */
+    bool checkTile(const std::string& name, const float* dem, int width, int height,
+                   const double* geoTransform, float nodata);
+
+    /**
+     * Synthetic tile from 30 to 80 degrees north, including the polar
+     * circle, with terrain from sea level to 4000 m and nodata pixels (NaN)
+     */
+    static void syntheticTile(int width, int height, std::vector<float>& dem, double* geoTransform);
+
+private:
+    int year_;
+    double timezoneOffset_;
+    SolarEphemeris ephemeris_;
+    SolarCalculator calc_;
+};
+
+#endif // KERNEL_VALIDATOR_H
@@ -0,0 +1,138 @@
+#include "NumaPlacement.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sched.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+
+// Kernel CPU list, e.g. "0-23,48-71"
+std::vector<int> parseCpuList(const std::string& text) {
+    std::vector<int> cpus;
+    std::stringstream ranges(text);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        int first, last;
+        int fields = std::sscanf(range.c_str(), "%d-%d", &first, &last);
+        if (fields < 1) continue;
+        if (fields == 1) last = first;
+        for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+} // namespace
+
+bool NumaPlacement::bound_ = false;
+cpu_set_t NumaPlacement::processMask_;
+
+std::vector<std::vector<int>> NumaPlacement::nodeCpus() {
+    // Once bound, the calling thread only sees its node
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (bound_) {
+        allowed = processMask_;
+    } else if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return {};
+    }
+    
+    // Node directories are numbered without gaps on the machines we run on;
+    // stop at the first missing one
+    std::vector<std::vector<int>> nodes;
+    for (int node = 0;; ++node) {
+        std::ifstream list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        std::string text;
+        if (!list || !std::getline(list, text)) break;
+        
+        std::vector<int> cpus;
+        for (int cpu : parseCpuList(text)) {
+            if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+        }
+        if (!cpus.empty()) nodes.push_back(cpus);
+    }
+    
+    // No NUMA information: one node with every allowed CPU
+    if (nodes.empty()) {
+        std::vector<int> cpus;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+        }
+        if (!cpus.empty()) nodes.push_back(cpus);
+    }
+    return nodes;
+}
+
+int NumaPlacement::numNodes() {
+    return std::max<int>(1, static_cast<int>(nodeCpus().size()));
+}
+
+bool NumaPlacement::bindThreads(bool spread) {
+    std::vector<std::vector<int>> nodes = nodeCpus();
+    if (nodes.empty()) {
+        std::cerr << "Error: Cannot read the CPUs allowed to the process" << std::endl;
+        return false;
+    }
+    
+    // Node of each thread number: one node after the other, each taking as
+    // many threads as it has CPUs, or the nodes in turn
+    std::vector<int> order;
+    if (spread) {
+        for (size_t k = 0; k < nodes.size(); ++k) order.push_back(static_cast<int>(k));
+    } else {
+        for (size_t k = 0; k < nodes.size(); ++k) order.insert(order.end(), nodes[k].size(), static_cast<int>(k));
+    }
+    std::vector<cpu_set_t> nodeMasks(nodes.size());
+    for (size_t k = 0; k < nodes.size(); ++k) {
+        CPU_ZERO(&nodeMasks[k]);
+        for (int cpu : nodes[k]) CPU_SET(cpu, &nodeMasks[k]);
+    }
+    
+    if (!bound_ && sched_getaffinity(0, sizeof(processMask_), &processMask_) != 0) {
+        std::cerr << "Error: Cannot read the CPUs allowed to the process" << std::endl;
+        return false;
+    }
+    
+    bool bound = true;
+    int threads = 1;
+#ifdef _OPENMP
+    #pragma omp parallel reduction(&& : bound)
+    {
+        #pragma omp single
+        threads = omp_get_num_threads();
+        
+        const cpu_set_t& mask = nodeMasks[order[omp_get_thread_num() % order.size()]];
+        bound = sched_setaffinity(0, sizeof(mask), &mask) == 0;
+    }
+#else
+    bound = sched_setaffinity(0, sizeof(nodeMasks[0]), &nodeMasks[0]) == 0;
+#endif
+    bound_ = true;
+    
+    if (!bound) {
+        std::cerr << "Error: Failed to set thread affinity" << std::endl;
+        return false;
+    }
+    size_t cpus = 0;
+    for (const std::vector<int>& node : nodes) cpus += node.size();
+    std::cerr << "Bound " << threads << " threads (" << (spread ? "spread" : "close") << ") over "
+              << nodes.size() << " NUMA node(s), " << cpus << " CPUs" << std::endl;
+    return true;
+}
+
+NumaPlacement::ProcessMask::ProcessMask() {
+    if (bound_ && sched_getaffinity(0, sizeof(previous_), &previous_) == 0) {
+        widened_ = sched_setaffinity(0, sizeof(processMask_), &processMask_) == 0;
+    }
+}
+
+NumaPlacement::ProcessMask::~ProcessMask() {
+    if (widened_) {
+        sched_setaffinity(0, sizeof(previous_), &previous_);
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef NUMA_PLACEMENT_H
+#define NUMA_PLACEMENT_H
+
+#include <cstddef>
+#include <vector>
+#include <sched.h>
+
+/**
+ * NumaPlacement class
+ * 
+ * Thread affinity for multi-socket nodes (--bind). Linux places a page
+ * on the NUMA node of the thread that first writes it, so buffers that
+ * are not initialized on allocation (ArenaBuffer) and are first written
+ * by the threads computing them stay local to those threads as long as
+ * they do not migrate. Spreading the threads over the nodes then uses
+ * every memory controller instead of saturating one.
+ */
+class NumaPlacement {
+public:
+    /**
+     * Pin each thread of the OpenMP team to the allowed CPUs of one NUMA node
+     * 
+     * spread: round-robin over the nodes (thread t on node t % nodes);
+     * otherwise close: node 0 takes as many threads as it has CPUs, then
+     * node 1, and so on. Applies to the top-level team, which OpenMP reuses
+     * across regions. Threads created by a bound thread inherit its node:
+     * nested teams stay on one node, so main rejects --bind for the modes
+     * that nest (GeoTIFF output and --jobs). Other threads are created
+     * under a ProcessMask.
+     * @return false if the topology cannot be read or a thread cannot be pinned
+     */
+    static bool bindThreads(bool spread);
+    
+    /**
+     * Give the calling thread every CPU allowed to the process for the
+     * lifetime of the object, so that the threads it creates (stream
+     * writer, metrics snapshots, service clients) are not confined to its
+     * node. No effect if bindThreads() has not run.
+     */
+    class ProcessMask {
+    public:
+        ProcessMask();
+        ~ProcessMask();
+        ProcessMask(const ProcessMask&) = delete;
+        ProcessMask& operator=(const ProcessMask&) = delete;
+    
+    private:
+        bool widened_ = false;
+        cpu_set_t previous_;
+    };
+    
+    /**
+     * Number of NUMA nodes with allowed CPUs (1 without NUMA information)
+     */
+    static int numNodes();
+    
+    /**
+     * Write value to count elements under the static partition of
+     * OpenMP parallel loops (first touch of an uninitialized buffer)
+     */
+    template <typename T>
+    static void firstTouch(T* data, size_t count, T value = T()) {
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < count; ++i) {
+            data[i] = value;
+        }
+    }
+
+private:
+    /**
+     * Allowed CPUs of the process grouped by NUMA node
+     */
+    static std::vector<std::vector<int>> nodeCpus();
+    
+    // Affinity of the process before bindThreads(), if it ran
+    static bool bound_;
+    static cpu_set_t processMask_;
+};
+
+#endif // NUMA_PLACEMENT_H
@@ -0,0 +1,215 @@
+#include "ParquetOutput.h"
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#ifdef SOLAR_HAVE_ARROW
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <parquet/arrow/writer.h>
+
+namespace {
+
+parquet::Compression::type toParquetCompression(ParquetCompression compression) {
+    switch (compression) {
+        case ParquetCompression::None: return parquet::Compression::UNCOMPRESSED;
+        case ParquetCompression::Snappy: return parquet::Compression::SNAPPY;
+        case ParquetCompression::Zstd: return parquet::Compression::ZSTD;
+        case ParquetCompression::LZ4: return parquet::Compression::LZ4;
+    }
+    return parquet::Compression::SNAPPY;
+}
+
+bool checkStatus(const arrow::Status& status, const char* what) {
+    if (!status.ok()) {
+        std::cerr << "Error: " << what << ": " << status.ToString() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+struct ParquetOutput::Impl {
+    ParquetLayout layout = ParquetLayout::Wide;
+    int64_t pixels = 0;
+    std::shared_ptr<arrow::Schema> schema;
+    std::unique_ptr<parquet::arrow::FileWriter> writer;
+    
+    // Wide layout: list offsets [0, pixels] shared by every row
+    std::vector<int32_t> listOffsets;
+    
+    // Flat layout: constant pixel ids and the day column of the current day
+    std::vector<int64_t> pixelIds;
+    std::vector<int32_t> dayColumn;
+};
+
+ParquetOutput::ParquetOutput() : impl_(new Impl) {}
+
+ParquetOutput::~ParquetOutput() {
+    if (impl_->writer) {
+        close();
+    }
+}
+
+bool ParquetOutput::isAvailable() {
+    return true;
+}
+
+bool ParquetOutput::open(const std::string& outputPath, int width, int height, int year,
+                         const double* geoTransform, const std::string& crsWkt,
+                         const ProcessingOptions& options,
+                         const std::vector<uint32_t>& maskRuns) {
+    impl_->layout = options.parquetLayout;
+    bool sparse = !maskRuns.empty();
+    impl_->pixels = static_cast<int64_t>(width) * height;
+    if (sparse) {
+        impl_->pixels = 0;
+        for (size_t r = 1; r < maskRuns.size(); r += 2) impl_->pixels += maskRuns[r];
+    }
+    
+    std::string transform;
+    for (int i = 0; i < 6; ++i) {
+        transform += (i ? "," : "") + std::to_string(geoTransform[i]);
+    }
+    std::vector<std::string> keys = {"width", "height", "year", "geotransform", "crs", "layout"};
+    std::vector<std::string> values = {std::to_string(width), std::to_string(height), std::to_string(year),
+                                       transform, crsWkt,
+                                       impl_->layout == ParquetLayout::Wide ? "wide" : "flat"};
+    if (sparse) {
+        std::string runs;
+        for (size_t r = 0; r < maskRuns.size(); ++r) {
+            runs += (r ? "," : "") + std::to_string(maskRuns[r]);
+        }
+        keys.push_back("mask_runs");
+        values.push_back(runs);
+    }
+    auto metadata = arrow::KeyValueMetadata::Make(keys, values);
+    
+    int64_t rowGroupSize = options.parquetRowGroupSize;
+    if (impl_->layout == ParquetLayout::Wide) {
+        if (impl_->pixels > std::numeric_limits<int32_t>::max()) {
+            std::cerr << "Error: raster too large for the wide Parquet layout, use --parquet-layout flat"
+                      << std::endl;
+            return false;
+        }
+        impl_->schema = arrow::schema({arrow::field("day", arrow::int32()),
+                                       arrow::field("sunrise", arrow::list(arrow::int16())),
+                                       arrow::field("sunset", arrow::list(arrow::int16()))},
+                                      metadata);
+        impl_->listOffsets = {0, static_cast<int32_t>(impl_->pixels)};
+        if (rowGroupSize <= 0) rowGroupSize = 1;  // days per row group
+    } else {
+        impl_->schema = arrow::schema({arrow::field("pixel_id", arrow::int64()),
+                                       arrow::field("day", arrow::int32()),
+                                       arrow::field("sunrise", arrow::int16()),
+                                       arrow::field("sunset", arrow::int16())},
+                                      metadata);
+        impl_->pixelIds.resize(impl_->pixels);
+        if (sparse) {
+            // Raster indices of the valid runs
+            int64_t raster = 0;
+            auto id = impl_->pixelIds.begin();
+            for (size_t r = 0; r < maskRuns.size(); ++r) {
+                if (r % 2 == 1) {
+                    std::iota(id, id + maskRuns[r], raster);
+                    id += maskRuns[r];
+                }
+                raster += maskRuns[r];
+            }
+        } else {
+            std::iota(impl_->pixelIds.begin(), impl_->pixelIds.end(), int64_t(0));
+        }
+        impl_->dayColumn.resize(impl_->pixels);
+        if (rowGroupSize <= 0) rowGroupSize = 1 << 20;  // rows per row group
+    }
+    
+    auto sink = arrow::io::FileOutputStream::Open(outputPath);
+    if (!sink.ok()) {
+        std::cerr << "Error: Failed to create output file: " << outputPath << std::endl;
+        return false;
+    }
+    
+    auto properties = parquet::WriterProperties::Builder()
+                          .compression(toParquetCompression(options.parquetCompression))
+                          ->max_row_group_length(rowGroupSize)
+                          ->build();
+    auto arrowProperties = parquet::ArrowWriterProperties::Builder().store_schema()->build();
+    
+    auto writer = parquet::arrow::FileWriter::Open(*impl_->schema, arrow::default_memory_pool(),
+                                                   *sink, properties, arrowProperties);
+    if (!writer.ok()) {
+        return checkStatus(writer.status(), "Failed to create Parquet writer");
+    }
+    impl_->writer = writer.MoveValueUnsafe();
+    return true;
+}
+
+bool ParquetOutput::writeDay(int dayOfYear, const int16_t* sunrise, const int16_t* sunset) {
+    int64_t n = impl_->pixels;
+    auto sunriseArray = std::make_shared<arrow::Int16Array>(n, arrow::Buffer::Wrap(sunrise, n));
+    auto sunsetArray = std::make_shared<arrow::Int16Array>(n, arrow::Buffer::Wrap(sunset, n));
+    
+    std::shared_ptr<arrow::RecordBatch> batch;
+    if (impl_->layout == ParquetLayout::Wide) {
+        int32_t day = dayOfYear;
+        arrow::Int32Array offsets(2, arrow::Buffer::Wrap(impl_->listOffsets.data(), 2));
+        
+        auto sunriseList = arrow::ListArray::FromArrays(offsets, *sunriseArray);
+        auto sunsetList = arrow::ListArray::FromArrays(offsets, *sunsetArray);
+        if (!sunriseList.ok() || !sunsetList.ok()) {
+            return checkStatus(sunriseList.ok() ? sunsetList.status() : sunriseList.status(),
+                               "Failed to build list arrays");
+        }
+        batch = arrow::RecordBatch::Make(impl_->schema, 1,
+                                         {std::make_shared<arrow::Int32Array>(1, arrow::Buffer::Wrap(&day, 1)),
+                                          *sunriseList, *sunsetList});
+        return checkStatus(impl_->writer->WriteRecordBatch(*batch), "Failed to write Parquet batch");
+    }
+    
+    std::fill(impl_->dayColumn.begin(), impl_->dayColumn.end(), static_cast<int32_t>(dayOfYear));
+    batch = arrow::RecordBatch::Make(
+        impl_->schema, n,
+        {std::make_shared<arrow::Int64Array>(n, arrow::Buffer::Wrap(impl_->pixelIds.data(), n)),
+         std::make_shared<arrow::Int32Array>(n, arrow::Buffer::Wrap(impl_->dayColumn.data(), n)),
+         sunriseArray, sunsetArray});
+    return checkStatus(impl_->writer->WriteRecordBatch(*batch), "Failed to write Parquet batch");
+}
+
+bool ParquetOutput::close() {
+    if (!impl_->writer) {
+        return false;
+    }
+    bool ok = checkStatus(impl_->writer->Close(), "Failed to close Parquet file");
+    impl_->writer.reset();
+    return ok;
+}
+
+#else // !SOLAR_HAVE_ARROW
+
+struct ParquetOutput::Impl {};
+
+ParquetOutput::ParquetOutput() : impl_(new Impl) {}
+
+ParquetOutput::~ParquetOutput() = default;
+
+bool ParquetOutput::isAvailable() {
+    return false;
+}
+
+bool ParquetOutput::open(const std::string&, int, int, int, const double*, const std::string&,
+                         const ProcessingOptions&, const std::vector<uint32_t>&) {
+    std::cerr << "Error: Parquet output requires a build with -DSOLAR_WITH_ARROW=ON" << std::endl;
+    return false;
+}
+
+bool ParquetOutput::writeDay(int, const int16_t*, const int16_t*) {
+    return false;
+}
+
+bool ParquetOutput::close() {
+    return false;
+}
+
+#endif // SOLAR_HAVE_ARROW
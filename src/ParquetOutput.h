@@ -0,0 +1,69 @@
+#ifndef PARQUET_OUTPUT_H
+#define PARQUET_OUTPUT_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ProcessingOptions.h"
+
+/**
+ * ParquetOutput class
+ * 
+ * Writes daily sunrise/sunset arrays to a Parquet file through Arrow.
+ * The Int16 compute buffers are wrapped as Arrow arrays without copying.
+ * 
+ * Layouts:
+ *   Wide: one row per day (day int32, sunrise list<int16>, sunset list<int16>),
+ *         as written by run_solar_parquet.py
+ *   Flat: one row per pixel and day (pixel_id int64, day int32,
+ *         sunrise int16, sunset int16), pixel_id = row * width + col
+ * 
+ * day is the day of year, or YYYYDDD for date ranges (see SolarEphemeris::dayId).
+ * 
+ * Raster metadata (width, height, geotransform, CRS, year) is stored in the
+ * schema key/value metadata. Only available in builds with SOLAR_WITH_ARROW.
+ * 
+ * Sparse files hold only the valid pixels: wide lists are packed in raster
+ * order and the mask runs are stored as the "mask_runs" metadata (comma
+ * separated, starting with a masked run); flat pixel ids skip masked pixels.
+ */
+class ParquetOutput {
+public:
+    ParquetOutput();
+    ~ParquetOutput();
+    
+    /**
+     * True if this build includes the Arrow/Parquet writer
+     */
+    static bool isAvailable();
+    
+    /**
+     * Create the output file
+     * @param options Layout, compression and row group size
+     * @param maskRuns Mask runs of a sparse file (see ValidSpans::appendMaskRuns), empty if dense
+     * @return true if successful, false otherwise
+     */
+    bool open(const std::string& outputPath, int width, int height, int year,
+              const double* geoTransform, const std::string& crsWkt,
+              const ProcessingOptions& options,
+              const std::vector<uint32_t>& maskRuns = std::vector<uint32_t>());
+    
+    /**
+     * Append one day; the buffers only need to stay valid during the call
+     * (one value per pixel, or per valid pixel in a sparse file)
+     * @param dayOfYear Day id (day of year, or YYYYDDD for a date range)
+     */
+    bool writeDay(int dayOfYear, const int16_t* sunrise, const int16_t* sunset);
+    
+    /**
+     * Flush the last row group and write the footer
+     */
+    bool close();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+#endif // PARQUET_OUTPUT_H
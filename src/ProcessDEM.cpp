@@ -1,18 +1,239 @@
 #include "ProcessDEM.h"
+#include "GpuSolver.h"
+#include "SolarEphemeris.h"
+#include "SolarGrid.h"
+#include "StreamWriter.h"
+#include "StreamFormat.h"
+#include "ParquetOutput.h"
+#include "ResultCube.h"
+#include "SolarService.h"
+#include "ValidSpans.h"
+#include "NumaPlacement.h"
+#include "BufferArena.h"
 #include "ogr_spatialref.h"
 #include <iostream>
 #include <vector>
 #include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <cstdio>
+#include <type_traits>
+#include <chrono>
+#include <sstream>
+#include <mutex>
+#include <unistd.h>
 
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
+namespace {
+
+// Convert events to Int16 minutes (or other units per hour, see
+// SolarCalculator::setTimeResolution); polar day/night (-9999 from calculator) is written as -1
+inline void toStreamMinutes(const DayEvents& events, double unitsPerHour, int16_t& sunrise, int16_t& sunset) {
+    if (events.status != DayStatus::Normal) {
+        sunrise = -1;
+        sunset = -1;
+    } else {
+        sunrise = static_cast<int16_t>(std::round(events.sunrise * unitsPerHour));
+        sunset = static_cast<int16_t>(std::round(events.sunset * unitsPerHour));
+    }
+}
+
+// GeoTIFF samples: decimal hours as Float32, or minutes as Int16 with
+// polar day/night mapped to the nodata value
+inline void storeEvents(const DayEvents& events, float& sunrise, float& sunset) {
+    sunrise = static_cast<float>(events.sunrise);
+    sunset = static_cast<float>(events.sunset);
+}
+
+inline void storeEvents(const DayEvents& events, int16_t& sunrise, int16_t& sunset) {
+    if (events.status != DayStatus::Normal) {
+        sunrise = static_cast<int16_t>(-9999);
+        sunset = static_cast<int16_t>(-9999);
+    } else {
+        sunrise = static_cast<int16_t>(std::round(events.sunrise * 60.0));
+        sunset = static_cast<int16_t>(std::round(events.sunset * 60.0));
+    }
+}
+
+// Stream mode masks nodata, NaN and sea-level (0 m) pixels
+inline bool isStreamMasked(float elevation, float nodata) {
+    return std::isnan(elevation) || elevation == nodata || elevation == 0.0f;
+}
+
+// Valid-pixel index of DEM rows under the stream mask
+inline void buildStreamSpans(ValidSpans& spans, const float* dem, int width, int numRows, float nodata) {
+    spans.build(dem, width, numRows, [nodata](float elevation) { return isStreamMasked(elevation, nodata); });
+}
+
+// Valid spans computed by the calling thread, the same in every parallel
+// region of a team (see ValidSpans::partition)
+inline void threadSpans(const ValidSpans& spans, size_t& first, size_t& last) {
+#ifdef _OPENMP
+    spans.partition(omp_get_thread_num(), omp_get_num_threads(), first, last);
+#else
+    spans.partition(0, 1, first, last);
+#endif
+}
+
+// Valid pixels of a band-sized buffer, packed in raster order (sparse output)
+inline void packValid(const ValidSpans& spans, int width, const int16_t* in, int16_t* out) {
+    const std::vector<ValidSpans::Span>& valid = spans.valid();
+    #pragma omp parallel for schedule(static)
+    for (size_t s = 0; s < valid.size(); ++s) {
+        std::memcpy(out + valid[s].packed, in + valid[s].offset(width), valid[s].length * sizeof(int16_t));
+    }
+}
+
+// Distance between two times of day in minutes, across midnight
+inline int minuteDistance(int16_t a, int16_t b) {
+    int diff = std::abs(a - b);
+    return std::min(diff, 1440 - diff);
+}
+
+/**
+ * Per-pixel zenith table and per-column noon scratch for the separable solver
+ * 
+ * The table covers a band of consecutive raster rows: the whole raster,
+ * or one strip in bounded-memory streaming. Only the valid spans of the
+ * band are computed; masked pixels are filled with -1.
+ * 
+ * Each thread fills the zenith terms of the spans it computes every day
+ * (threadSpans), so on NUMA nodes its part of the table is local.
+ * @tparam Real Kernel precision (double or float)
+ */
+template <typename Real>
+struct GridTables {
+    ArenaBuffer<Real> cosZenith;   // NaN marks masked pixels
+    std::vector<Real> solarNoon;
+    ValidSpans spans;
+    int width = 0;
+    RunMetrics* metrics = nullptr;   // Thread busy/idle of computeRows, or nullptr
+    BufferArena* arena = nullptr;    // Pool of the zenith table, or nullptr
+    
+    /**
+     * @return false if the table cannot be allocated
+     */
+    bool build(const float* dem, size_t count, int rasterWidth, float nodata) {
+        width = rasterWidth;
+        if (!cosZenith.allocate(count, arena)) {
+            return false;
+        }
+        solarNoon.resize(width);
+        buildStreamSpans(spans, dem, width, static_cast<int>(count / width), nodata);
+        
+        // First touch of the valid pixels by the thread computing them
+        const std::vector<ValidSpans::Span>& valid = spans.valid();
+        #pragma omp parallel
+        {
+            size_t first, last;
+            threadSpans(spans, first, last);
+            for (size_t s = first; s < last; ++s) {
+                size_t start = valid[s].offset(width);
+                for (int k = 0; k < valid[s].length; ++k) {
+                    cosZenith[start + k] = static_cast<Real>(SolarCalculator::zenithCosine(dem[start + k]));
+                }
+            }
+        }
+        spans.fillMasked<Real>(cosZenith.data(), std::numeric_limits<Real>::quiet_NaN());
+        return true;
+    }
+    
+    bool build(const std::vector<float>& dem, int rasterWidth, float nodata) {
+        return build(dem.data(), dem.size(), rasterWidth, nodata);
+    }
+    
+    /**
+     * Compute the whole band of the table, which starts at raster row row0
+     * @param packed Write only the valid pixels, in raster order (sparse output)
+     */
+    void computeRows(const SolarGrid& grid, const SolarCalculator& calc, const DayEphemeris& eph,
+                     int row0, int16_t* sunrise, int16_t* sunset, bool packed = false) {
+        grid.solarNoonTable(eph, 0, width, solarNoon.data());
+        if (!packed) {
+            spans.fillMasked<int16_t>(sunrise, -1);
+            spans.fillMasked<int16_t>(sunset, -1);
+        }
+        
+        // Parallel calculation for this day, one valid span at a time, each
+        // thread on the spans whose zenith terms it wrote
+        const std::vector<ValidSpans::Span>& valid = spans.valid();
+        RunMetrics::RegionTimer region(metrics);
+        #pragma omp parallel
+        {
+            size_t first, last;
+            threadSpans(spans, first, last);
+            for (size_t s = first; s < last; ++s) {
+                const ValidSpans::Span& span = valid[s];
+                double rowScale, rowOffset;
+                grid.rowTerms(eph, row0 + span.row, rowScale, rowOffset);
+                
+                size_t start = span.offset(width);
+                size_t out = packed ? span.packed : start;
+                calc.computeRow(&cosZenith[start], &solarNoon[span.begin],
+                                static_cast<Real>(rowScale), static_cast<Real>(rowOffset),
+                                &sunrise[out], &sunset[out], span.length);
+            }
+            region.threadDone();
+        }
+    }
+    
+    void computeDay(const SolarGrid& grid, const SolarCalculator& calc, const DayEphemeris& eph,
+                    int16_t* sunrise, int16_t* sunset) {
+        computeRows(grid, calc, eph, 0, sunrise, sunset);
+    }
+};
+
+// Geographic (degree) coordinates unless the WKT says otherwise;
+// department DEMs are in EPSG:4326
+bool isGeographicCrs(const std::string& wkt) {
+    OGRSpatialReference srs;
+    if (!wkt.empty() && srs.importFromWkt(wkt.c_str()) == OGRERR_NONE) {
+        return srs.IsGeographic() != 0;
+    }
+    return true;
+}
+
+// Metadata domain of the GeoTIFF outputs holding the run parameters and
+// the per-block DEM checksums used by incremental updates
+const char* UPDATE_DOMAIN = "SUNCAST";
+
+// Block checksums as comma-separated hexadecimal CRC-32 values
+std::string formatBlockCrcs(const std::vector<uint32_t>& crcs) {
+    std::string text;
+    text.reserve(crcs.size() * 9);
+    char value[16];
+    for (size_t i = 0; i < crcs.size(); ++i) {
+        std::snprintf(value, sizeof(value), "%s%08x", i ? "," : "", crcs[i]);
+        text += value;
+    }
+    return text;
+}
+
+bool parseBlockCrcs(const char* text, size_t count, std::vector<uint32_t>& crcs) {
+    crcs.clear();
+    while (*text && crcs.size() < count) {
+        char* end;
+        crcs.push_back(static_cast<uint32_t>(std::strtoul(text, &end, 16)));
+        if (end == text || (*end != ',' && *end != '\0')) {
+            return false;
+        }
+        text = *end ? end + 1 : end;
+    }
+    return crcs.size() == count && !*text;
+}
+
+} // namespace
+
 DemProcessor::DemProcessor(int numThreads)
     : numThreads_(numThreads), solarCalc_(1.0) {
     // Register GDAL drivers
     GDALAllRegister();
-    
+
 #ifdef _OPENMP
     if (numThreads_ > 0) {
         omp_set_num_threads(numThreads_);
@@ -26,6 +247,15 @@ DemProcessor::DemProcessor(int numThreads)
 DemProcessor::~DemProcessor() {
 }
 
+void DemProcessor::reportBuffers() const {
+    size_t peak = arena_.peakBytes();
+    std::cerr << "Buffers: peak " << peak / (1024 * 1024) << " MB, "
+              << arena_.reservedBytes() / (1024 * 1024) << " MB still reserved" << std::endl;
+    if (metrics_) {
+        metrics_->recordBufferPeak(peak);
+    }
+}
+
 void DemProcessor::pixelToGeo(const double* geoTransform, int pixelX, int pixelY,
                              double& lon, double& lat) const {
     // GDAL geotransform: [0]=top left x, [1]=w-e pixel resolution, [2]=rotation (0 if north up),
@@ -36,9 +266,11 @@ void DemProcessor::pixelToGeo(const double* geoTransform, int pixelX, int pixelY
 
 GDALDataset* DemProcessor::createOutputDataset(const std::string& outputPath,
                                                int width, int height,
-                                               int numBands,
+                                               const SolarEphemeris& period,
                                                const double* geoTransform,
                                                const char* projection) const {
+    int numBands = period.numDays() * 2;
+    
     GDALDriver* driver = GetGDALDriverManager()->GetDriverByName("GTiff");
     if (!driver) {
         std::cerr << "Error: GTiff driver not available" << std::endl;
@@ -53,8 +285,16 @@ GDALDataset* DemProcessor::createOutputDataset(const std::string& outputPath,
     options = CSLSetNameValue(options, "BLOCKYSIZE", "512");
     options = CSLSetNameValue(options, "BIGTIFF", "IF_NEEDED"); // Important for large files > 4GB
     
+    // Multithreaded LZW compression of the tiles of each block write
+    std::string compressThreads = numThreads_ > 0 ? std::to_string(numThreads_) : "ALL_CPUS";
+    options = CSLSetNameValue(options, "NUM_THREADS", compressThreads.c_str());
+    
+    bool int16Output = options_.outputType == OutputType::Int16;
+    options = CSLSetNameValue(options, "INTERLEAVE",
+                              options_.interleave == Interleave::Pixel ? "PIXEL" : "BAND");
+    
     GDALDataset* dataset = driver->Create(outputPath.c_str(), width, height, numBands,
-                                          GDT_Float32, options);
+                                          int16Output ? GDT_Int16 : GDT_Float32, options);
     CSLDestroy(options);
     
     if (!dataset) {
@@ -67,23 +307,196 @@ GDALDataset* DemProcessor::createOutputDataset(const std::string& outputPath,
     
     // Set band descriptions and nodata values
     // Band 1: Jan 1 Sunrise, Band 2: Jan 1 Sunset, Band 3: Jan 2 Sunrise...
+    // Date ranges name bands by date instead ("2025-03-01 Sunrise")
     for (int i = 1; i <= numBands; ++i) {
         GDALRasterBand* band = dataset->GetRasterBand(i);
         band->SetNoDataValue(NODATA_VALUE);
+        band->SetUnitType(int16Output ? "min" : "h");
         
-        int day = (i - 1) / 2 + 1;
+        const DayEphemeris& eph = period[(i - 1) / 2];
         bool isSunrise = (i % 2 != 0);
         
-        std::string desc = "Day " + std::to_string(day) + (isSunrise ? " Sunrise" : " Sunset");
+        std::string day = "Day " + std::to_string(eph.dayOfYear);
+        if (period.isRange()) {
+            char date[16];
+            std::snprintf(date, sizeof(date), "%04d-%02d-%02d", eph.year, eph.month, eph.day);
+            day = date;
+        }
+        std::string desc = day + (isSunrise ? " Sunrise" : " Sunset");
         band->SetDescription(desc.c_str());
     }
     
     return dataset;
 }
 
+GDALDataset* DemProcessor::openOutputDataset(const std::string& outputPath,
+                                             int width, int height, int numBands,
+                                             const std::string& parameters,
+                                             size_t numBlocks,
+                                             std::vector<uint32_t>& blockCrcs) const {
+    // Rewritten tiles are compressed on the driver's worker pool, as when creating
+    std::string compressThreads = "NUM_THREADS=" + (numThreads_ > 0 ? std::to_string(numThreads_) : "ALL_CPUS");
+    const char* openOptions[] = {compressThreads.c_str(), nullptr};
+    GDALDataset* dataset = (GDALDataset*)GDALOpenEx(outputPath.c_str(), GDAL_OF_RASTER | GDAL_OF_UPDATE,
+                                                    nullptr, openOptions, nullptr);
+    if (!dataset) {
+        std::cerr << "Error: Failed to open output for update: " << outputPath << std::endl;
+        return nullptr;
+    }
+    
+    const char* recorded = dataset->GetMetadataItem("PARAMETERS", UPDATE_DOMAIN);
+    const char* crcs = dataset->GetMetadataItem("DEM_BLOCK_CRC32", UPDATE_DOMAIN);
+    std::string error;
+    if (dataset->GetRasterXSize() != width || dataset->GetRasterYSize() != height ||
+        dataset->GetRasterCount() != numBands) {
+        error = "its size or band count does not match the DEM and period";
+    } else if (!recorded || !crcs) {
+        error = "it has no block checksums (written by an older version or a failed run)";
+    } else if (parameters != recorded) {
+        error = std::string("it was computed with other parameters (") + recorded + ")";
+    } else if (!parseBlockCrcs(crcs, numBlocks, blockCrcs)) {
+        error = "its block checksums are invalid";
+    }
+    
+    if (!error.empty()) {
+        std::cerr << "Error: Cannot update " << outputPath << ": " << error
+                  << "; run once without --update" << std::endl;
+        GDALClose(dataset);
+        return nullptr;
+    }
+    return dataset;
+}
+
+bool DemProcessor::readDem(const std::string& inputPath, DemRaster& dem, int row0, int numRows) const {
+    // Open input DEM
+    GDALDataset* inputDataset = (GDALDataset*)GDALOpen(inputPath.c_str(), GA_ReadOnly);
+    if (!inputDataset) {
+        std::cerr << "Error: Failed to open input file: " << inputPath << std::endl;
+        return false;
+    }
+    
+    dem.width = inputDataset->GetRasterXSize();
+    dem.height = inputDataset->GetRasterYSize();
+    inputDataset->GetGeoTransform(dem.geoTransform);
+    dem.projection = inputDataset->GetProjectionRef();
+    
+    // Row window: shift the origin to its first row
+    if (numRows > 0) {
+        numRows = std::min(numRows, dem.height - row0);
+        dem.geoTransform[0] += row0 * dem.geoTransform[2];
+        dem.geoTransform[3] += row0 * dem.geoTransform[5];
+        dem.height = numRows;
+    } else {
+        row0 = 0;
+    }
+    
+    // Read DEM data into memory (Float32)
+    GDALRasterBand* demBand = inputDataset->GetRasterBand(1);
+    dem.data.resize(static_cast<size_t>(dem.width) * dem.height);
+    
+    CPLErr err;
+    {
+        RunMetrics::Timer timer(metrics_, MetricPhase::DemRead);
+        err = demBand->RasterIO(GF_Read, 0, row0, dem.width, dem.height,
+                                dem.data.data(), dem.width, dem.height, GDT_Float32, 0, 0);
+    }
+    
+    if (err != CE_None) {
+        std::cerr << "Error: Failed to read DEM data" << std::endl;
+        GDALClose(inputDataset);
+        return false;
+    }
+    
+    dem.nodata = static_cast<float>(demBand->GetNoDataValue());
+    GDALClose(inputDataset);
+    return true;
+}
+
+void DemProcessor::computePixelRows(const double* geoTransform, const float* demData,
+                                    const ValidSpans& spans, int width, int row0,
+                                    const SolarCalculator& calc, const DayEphemeris& eph,
+                                    int16_t* sunrise, int16_t* sunset,
+                                    const HorizonMap* horizon, bool packed) const {
+    size_t firstPixel = static_cast<size_t>(width) * row0;
+    if (!packed) {
+        spans.fillMasked<int16_t>(sunrise, -1);
+        spans.fillMasked<int16_t>(sunset, -1);
+    }
+    
+    // Parallel calculation for this day over the valid spans only
+    const std::vector<ValidSpans::Span>& valid = spans.valid();
+    RunMetrics::RegionTimer region(metrics_);
+    #pragma omp parallel
+    {
+        #pragma omp for schedule(dynamic, 4) nowait
+        for (size_t s = 0; s < valid.size(); ++s) {
+            const ValidSpans::Span& span = valid[s];
+            int y = row0 + span.row;
+            size_t start = span.offset(width);
+            size_t out = packed ? span.packed : start;
+            
+            for (int k = 0; k < span.length; ++k) {
+                size_t i = start + k;
+                double lon, lat;
+                pixelToGeo(geoTransform, span.begin + k, y, lon, lat);
+                
+                DayEvents events = horizon
+                    ? calc.calculateDayEvents(eph, lat, lon, demData[i],
+                                              horizon->pixel(firstPixel + i), horizon->numSectors())
+                    : calc.calculateDayEvents(eph, lat, lon, demData[i]);
+                toStreamMinutes(events, calc.timeUnitsPerHour(), sunrise[out + k], sunset[out + k]);
+            }
+        }
+        region.threadDone();
+    }
+}
+
+void DemProcessor::computeHorizon(const std::string& inputPath, const float* demData,
+                                  int width, int height, const double* geoTransform,
+                                  const std::string& projection, float demNodata,
+                                  HorizonMap& horizon, const std::string& cacheTag) const {
+    RunMetrics::Timer timer(metrics_, MetricPhase::Horizon);
+    bool geographic = isGeographicCrs(projection);
+    
+    // dem_dept_38.tif -> dem_dept_38.horizon16.bin
+    std::string cachePath;
+    uint64_t key = 0;
+    if (options_.horizonCache) {
+        size_t dot = inputPath.find_last_of('.');
+        size_t slash = inputPath.find_last_of('/');
+        std::string stem = (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+                               ? inputPath.substr(0, dot) : inputPath;
+        cachePath = stem + ".horizon" + std::to_string(horizon.numSectors()) + cacheTag + ".bin";
+        
+        key = horizon.cacheKey(demData, width, height, geoTransform, geographic, demNodata);
+        if (horizon.loadCache(cachePath, key, width, height)) {
+            std::cerr << "Terrain horizon loaded from " << cachePath << std::endl;
+            return;
+        }
+    }
+    
+    std::cerr << "Computing terrain horizon (" << horizon.numSectors() << " sectors)..." << std::endl;
+    horizon.compute(demData, width, height, geoTransform, geographic, demNodata);
+    
+    if (options_.horizonCache) {
+        if (horizon.saveCache(cachePath, key)) {
+            std::cerr << "Terrain horizon cached in " << cachePath << std::endl;
+        } else {
+            std::cerr << "Warning: could not write horizon cache " << cachePath << std::endl;
+        }
+    }
+}
+
 bool DemProcessor::streamBinaryOutput(const std::string& inputPath,
                                       int year,
                                       double timezoneOffset) {
+    return streamBinaryOutput(inputPath, std::vector<SolarEphemeris>{SolarEphemeris(year)},
+                              timezoneOffset);
+}
+
+bool DemProcessor::streamBinaryOutput(const std::string& inputPath,
+                                      const std::vector<SolarEphemeris>& periods,
+                                      double timezoneOffset) {
     // Open input DEM
     GDALDataset* inputDataset = (GDALDataset*)GDALOpen(inputPath.c_str(), GA_ReadOnly);
     if (!inputDataset) {
@@ -93,106 +506,741 @@ bool DemProcessor::streamBinaryOutput(const std::string& inputPath,
     
     int width = inputDataset->GetRasterXSize();
     int height = inputDataset->GetRasterYSize();
-    int totalPixels = width * height;
+    size_t totalPixels = static_cast<size_t>(width) * height;
     
     // Get geotransform
     double geoTransform[6];
     inputDataset->GetGeoTransform(geoTransform);
     
-    // Read DEM data into memory (Float32)
     GDALRasterBand* demBand = inputDataset->GetRasterBand(1);
-    float* demData = new float[totalPixels];
+    float demNodata = static_cast<float>(demBand->GetNoDataValue());
     
-    CPLErr err = demBand->RasterIO(GF_Read, 0, 0, width, height,
-                                   demData, width, height, GDT_Float32, 0, 0);
+    SolarGrid grid(geoTransform, width, height);
+    bool useFloat = options_.precision == Precision::Float;
+    if (!grid.isSeparable()) {
+        std::cerr << "Warning: rotated geotransform, using per-pixel solver" << std::endl;
+    }
     
-    if (err != CE_None) {
-        std::cerr << "Error: Failed to read DEM data" << std::endl;
-        delete[] demData;
+    // The horizon-aware search runs per pixel on the resident DEM
+    bool useHorizon = options_.horizonSectors > 0;
+    bool useTables = grid.isSeparable() && !useHorizon;
+    
+    // Frames rotating between compute and the writer thread
+    int pipelineDepth = std::max(options_.pipelineDepth, 1);
+    
+    // Memory per pixel: DEM + zenith table or horizon, plus output frames
+    size_t inputBytesPerPixel = sizeof(float);
+    if (useTables) {
+        inputBytesPerPixel += useFloat ? sizeof(float) : sizeof(double);
+    }
+    if (useHorizon) {
+        inputBytesPerPixel += HorizonMap::bytesFor(1, options_.horizonSectors);
+    }
+    size_t residentBytesPerPixel = inputBytesPerPixel + pipelineDepth * 2 * sizeof(int16_t);
+    
+    // v2 computes into scratch before encoding: sunrise/sunset scratch and the
+    // encoder's payload buffer (at most the Int16 concatenation except for
+    // varint slots), plus the previous day for delta and varint
+    bool formatV2 = options_.streamFormat == StreamFormat::V2;
+    StreamEncoding encoding = formatV2 ? options_.streamEncoding : StreamEncoding::Raw;
+    if (formatV2) {
+        residentBytesPerPixel += (StreamEncoder::usesPreviousDay(encoding) ? 3 : 2) * 2 * sizeof(int16_t);
+        if (encoding == StreamEncoding::Varint) {
+            residentBytesPerPixel += 2 * 3 - 2 * sizeof(int16_t);
+        }
+    }
+    
+    // Rows resident at once: the whole raster, or strips that fit the budget.
+    // A strip needs Int16 sunrise/sunset scratch plus one Int16 array per frame.
+    int stripRows = height;
+    if (useHorizon && options_.maxMemoryBytes > 0 && totalPixels * residentBytesPerPixel > options_.maxMemoryBytes) {
+        // Horizons need the whole DEM; strips would only bound the output
+        std::cerr << "Error: --horizon needs the whole DEM in memory ("
+                  << totalPixels * residentBytesPerPixel << " bytes), above --max-memory" << std::endl;
         GDALClose(inputDataset);
         return false;
     }
+    if (options_.maxMemoryBytes > 0 && totalPixels * residentBytesPerPixel > options_.maxMemoryBytes) {
+        size_t stripBytesPerPixel = inputBytesPerPixel + (2 + pipelineDepth) * sizeof(int16_t);
+        size_t rowBytes = static_cast<size_t>(width) * stripBytesPerPixel;
+        size_t fitRows = options_.maxMemoryBytes / rowBytes;
+        if (fitRows == 0) {
+            std::cerr << "Error: --max-memory too small for one DEM row ("
+                      << rowBytes << " bytes)" << std::endl;
+            GDALClose(inputDataset);
+            return false;
+        }
+        
+        // Follow the GeoTIFF block layout so each strip decodes whole blocks
+        int blockXSize, blockYSize;
+        demBand->GetBlockSize(&blockXSize, &blockYSize);
+        stripRows = static_cast<int>(std::min<size_t>(fitRows, height));
+        if (blockYSize > 0 && stripRows > blockYSize) {
+            stripRows -= stripRows % blockYSize;
+        }
+    }
+    bool resident = stripRows >= height;
+    int numStrips = (height + stripRows - 1) / stripRows;
+    size_t stripPixels = static_cast<size_t>(width) * stripRows;
     
-    float demNodata = static_cast<float>(demBand->GetNoDataValue());
+    if (!resident) {
+        std::cerr << "Bounded-memory streaming: " << numStrips << " strips of "
+                  << stripRows << " rows" << std::endl;
+    }
     
-    // Determine number of days
-    bool isLeap = (year % 4 == 0 && year % 100 != 0) || (year % 400 == 0);
-    int daysInYear = isLeap ? 366 : 365;
+    // The GPU runs the separable solver on the resident raster
+    bool useGpu = options_.device == ComputeDevice::Gpu && useTables && resident;
+    if (options_.device == ComputeDevice::Gpu && !useGpu) {
+        std::cerr << "Warning: --device gpu needs a resident north-up raster without --horizon,"
+                  << " using the CPU" << std::endl;
+    }
+    
+    // Delta and varint chunks need the whole previous day, which strips do not keep
+    if (StreamEncoder::usesPreviousDay(encoding) && !resident) {
+        std::cerr << "Warning: --encoding " << StreamEncoder::encodingName(encoding)
+                  << " ignored in bounded-memory streaming" << std::endl;
+        encoding = StreamEncoding::Raw;
+    }
     
-    // Allocate output buffers (Int16)
-    int16_t* sunriseBuffer = new int16_t[totalPixels];
-    int16_t* sunsetBuffer = new int16_t[totalPixels];
+    // DEM and Int16 scratch for one strip; resident v1 computes straight into frames.
+    // The DEM pages are placed by a parallel first touch rather than by the
+    // reading thread; the scratch is first written by the compute threads.
+    ArenaBuffer<float> demData;
+    ArenaBuffer<int16_t> sunriseStrip, sunsetStrip;
+    if (!demData.allocate(stripPixels, &arena_) ||
+        ((!resident || formatV2) && (!sunriseStrip.allocate(stripPixels, &arena_) ||
+                                     !sunsetStrip.allocate(stripPixels, &arena_)))) {
+        GDALClose(inputDataset);
+        return false;
+    }
+    NumaPlacement::firstTouch(demData.data(), stripPixels);
     
     SolarCalculator calc(timezoneOffset);
+    calc.setTimeResolution(formatV2 ? options_.timeResolutionSeconds : 60);
+    
+    // Separable solver: per-row latitude terms, per-column solar noon and a
+    // per-pixel zenith term. Only the table of the selected precision is built.
+    GridTables<double> tables;
+    GridTables<float> tablesFloat;
+    HorizonMap horizon(options_.horizonSectors);
+    ValidSpans demSpans;  // Per-pixel path; the tables index their own band
+    tables.metrics = metrics_;
+    tablesFloat.metrics = metrics_;
+    tables.arena = &arena_;
+    tablesFloat.arena = &arena_;
+    
+    // Read DEM rows [row0, row0 + numRows) and build the zenith table for them
+    auto loadStrip = [&](int row0, int numRows) -> bool {
+        CPLErr err;
+        {
+            RunMetrics::Timer timer(metrics_, MetricPhase::DemRead);
+            err = demBand->RasterIO(GF_Read, 0, row0, width, numRows,
+                                    demData.data(), width, numRows, GDT_Float32, 0, 0);
+        }
+        if (err != CE_None) {
+            std::cerr << "Error: Failed to read DEM data" << std::endl;
+            return false;
+        }
+        
+        RunMetrics::Timer timer(metrics_, MetricPhase::Compute);
+        size_t count = static_cast<size_t>(width) * numRows;
+        if (useTables) {
+            if (!(useFloat ? tablesFloat.build(demData.data(), count, width, demNodata)
+                           : tables.build(demData.data(), count, width, demNodata))) {
+                return false;
+            }
+        } else {
+            buildStreamSpans(demSpans, demData.data(), width, numRows, demNodata);
+        }
+        return true;
+    };
+    
+    // Valid pixels of the loaded strip
+    auto stripSpans = [&]() -> const ValidSpans& {
+        if (!useTables) return demSpans;
+        return useFloat ? tablesFloat.spans : tables.spans;
+    };
+    
+    // Sparse v2 streams write only the valid pixels of each strip
+    bool sparse = formatV2 && options_.sparseOutput;
+    
+    auto computeStrip = [&](const DayEphemeris& eph, int row0,
+                            int16_t* sunrise, int16_t* sunset) {
+        RunMetrics::Timer timer(metrics_, MetricPhase::Compute);
+        if (!useTables) {
+            computePixelRows(geoTransform, demData.data(), demSpans, width, row0,
+                             calc, eph, sunrise, sunset, useHorizon ? &horizon : nullptr, sparse);
+        } else if (useFloat) {
+            tablesFloat.computeRows(grid, calc, eph, row0, sunrise, sunset, sparse);
+        } else {
+            tables.computeRows(grid, calc, eph, row0, sunrise, sunset, sparse);
+        }
+    };
+    
+    GpuSolver gpu;
+    if (resident) {
+        if (!loadStrip(0, height)) {
+            GDALClose(inputDataset);
+            return false;
+        }
+        // The zenith table replaces the DEM for the rest of the run
+        if (useTables) {
+            demData.reset();
+        }
+        if (useGpu) {
+            // Pinned results of both batch slots, within what --max-memory leaves
+            size_t pinnedDayBytes = GpuSolver::NUM_SLOTS * 2 * sizeof(int16_t) * totalPixels;
+            size_t used = totalPixels * residentBytesPerPixel;
+            size_t budgetDays = GpuSolver::MAX_BATCH_DAYS;
+            if (options_.maxMemoryBytes > 0) {
+                size_t spare = options_.maxMemoryBytes > used ? options_.maxMemoryBytes - used : 0;
+                budgetDays = std::max<size_t>(spare / pinnedDayBytes, 1);
+            }
+            int maxBatchDays = static_cast<int>(std::min<size_t>(budgetDays, GpuSolver::MAX_BATCH_DAYS));
+            bool uploaded = useFloat
+                ? gpu.upload(grid, tablesFloat.cosZenith.data(), timezoneOffset, calc.timeUnitsPerHour(), maxBatchDays)
+                : gpu.upload(grid, tables.cosZenith.data(), timezoneOffset, calc.timeUnitsPerHour(), maxBatchDays);
+            if (!uploaded) {
+                GDALClose(inputDataset);
+                return false;
+            }
+            // The device holds the zenith table from here on
+            tables.cosZenith.reset();
+            tablesFloat.cosZenith.reset();
+        }
+        if (useHorizon) {
+            computeHorizon(inputPath, demData.data(), width, height, geoTransform,
+                           inputDataset->GetProjectionRef(), demNodata, horizon);
+        }
+    }
+    
+    // Sparse header: mask runs of the whole raster and the packed index of
+    // each strip's first valid pixel (one extra DEM pass when in strips)
+    std::vector<uint32_t> maskRuns;
+    std::vector<uint64_t> stripPacked(numStrips + 1, 0);
+    if (sparse) {
+        for (int strip = 0; strip < numStrips; ++strip) {
+            int row0 = strip * stripRows;
+            if (!resident && !loadStrip(row0, std::min(stripRows, height - row0))) {
+                GDALClose(inputDataset);
+                return false;
+            }
+            stripSpans().appendMaskRuns(maskRuns);
+            stripPacked[strip + 1] = stripPacked[strip] + stripSpans().validPixels();
+        }
+        std::cerr << "Sparse output: " << stripPacked[numStrips] << " of " << totalPixels
+                  << " pixels valid" << std::endl;
+    }
+    
+    // GPU days come in batches: the device fills one slot while the days of
+    // the other are encoded
+    auto gpuDay = [&](const SolarEphemeris& ephemeris, int dayIndex,
+                      const int16_t*& sunrise, const int16_t*& sunset) -> bool {
+        int batch = gpu.batchDays();
+        int numDays = ephemeris.numDays();
+        int slot = (dayIndex / batch) % GpuSolver::NUM_SLOTS;
+        if (dayIndex % batch == 0) {
+            if (dayIndex == 0 && !gpu.launch(slot, &ephemeris[0], std::min(batch, numDays))) {
+                return false;
+            }
+            int next = dayIndex + batch;
+            if (next < numDays &&
+                !gpu.launch((slot + 1) % GpuSolver::NUM_SLOTS, &ephemeris[next], std::min(batch, numDays - next))) {
+                return false;
+            }
+            RunMetrics::Timer timer(metrics_, MetricPhase::Compute);
+            if (!gpu.wait(slot)) {
+                return false;
+            }
+        }
+        sunrise = gpu.sunrise(slot, dayIndex % batch);
+        sunset = gpu.sunset(slot, dayIndex % batch);
+        return true;
+    };
     
-    // Output raster dimensions first (metadata)
-    // Using cerr for metadata to keep stdout clean for binary data?
-    // No, let's put metadata in the stream header.
-    // Header: [Magic: "SOLAR"][Width: int32][Height: int32][Days: int32]
-    const char magic[] = "SOLAR";
-    std::cout.write(magic, 5);
-    std::cout.write(reinterpret_cast<const char*>(&width), sizeof(int32_t));
-    std::cout.write(reinterpret_cast<const char*>(&height), sizeof(int32_t));
-    std::cout.write(reinterpret_cast<const char*>(&daysInYear), sizeof(int32_t));
-    std::cout.write(reinterpret_cast<const char*>(geoTransform), 6 * sizeof(double));
+    // Raw writes on stdout from a dedicated thread; nothing else may use std::cout here
     std::cout.flush();
+    StreamWriter writer(STDOUT_FILENO, pipelineDepth, metrics_);
+    bool success = true;
     
-    // Loop over days
-    int currentDayOfYear = 0;
-    for (int m = 1; m <= 12; ++m) {
-        int daysInMonth = 31;
-        if (m == 4 || m == 6 || m == 9 || m == 11) daysInMonth = 30;
-        else if (m == 2) daysInMonth = isLeap ? 29 : 28;
+    // One self-contained stream (header, days) per period, back to back;
+    // the DEM, tables and horizon above are shared by all periods
+    for (size_t period = 0; success && period < periods.size(); ++period) {
+        const SolarEphemeris& ephemeris = periods[period];
+        int daysInYear = ephemeris.numDays();
+        int year = ephemeris.year();
+        
+        // Delta state restarts with each stream
+        StreamEncoder encoder(options_.compression, options_.compressionLevel);
+        
+        // Output raster dimensions first (metadata)
+        // v1 header: [Magic: "SOLAR"][Width: int32][Height: int32][Days: int32][GeoTransform: 6 x double]
+        if (formatV2) {
+            if (StreamFrame* frame = writer.acquire()) {
+                StreamHeaderInfo info;
+                info.width = width;
+                info.height = height;
+                info.numDays = daysInYear;
+                info.year = year;
+                info.firstDayOfYear = ephemeris[0].dayOfYear;
+                info.ordinalDayIds = ephemeris.isRange();
+                std::memcpy(info.geoTransform, geoTransform, sizeof(geoTransform));
+                info.timezoneOffset = timezoneOffset;
+                info.demNodata = demNodata;
+                info.timeResolutionSeconds = static_cast<uint16_t>(options_.timeResolutionSeconds);
+                const char* projection = inputDataset->GetProjectionRef();
+                info.crsWkt = projection ? projection : "";
+                info.sparse = sparse;
+                info.maskRuns = maskRuns;
+                RunMetrics::Timer timer(metrics_, MetricPhase::Encode);
+                encoder.encodeHeader(info, encoding, *frame);
+                writer.submit(frame);
+            } else {
+                success = false;
+            }
+        } else if (StreamFrame* frame = writer.acquire()) {
+            char* header = frame->part<char>(0, 5 + 3 * sizeof(int32_t) + 6 * sizeof(double));
+            std::memcpy(header, "SOLAR", 5);
+            std::memcpy(header + 5, &width, sizeof(int32_t));
+            std::memcpy(header + 9, &height, sizeof(int32_t));
+            std::memcpy(header + 13, &daysInYear, sizeof(int32_t));
+            std::memcpy(header + 17, geoTransform, 6 * sizeof(double));
+            frame->parts.resize(1);
+            writer.submit(frame);
+        } else {
+            success = false;
+        }
         
-        for (int d = 1; d <= daysInMonth; ++d) {
-            currentDayOfYear++;
+        // Loop over days
+        for (int dayIndex = 0; success && dayIndex < daysInYear; ++dayIndex) {
+            const DayEphemeris& eph = ephemeris[dayIndex];
+            int32_t currentDayOfYear = ephemeris.dayId(dayIndex);
             
-            // Parallel calculation for this day
-            #pragma omp parallel for schedule(static)
-            for (int i = 0; i < totalPixels; ++i) {
-                float elevation = demData[i];
+            // v2: one chunk per day (or per strip) carrying sunrise then sunset
+            if (formatV2) {
+                for (int strip = 0; success && strip < numStrips; ++strip) {
+                    int row0 = strip * stripRows;
+                    int numRows = std::min(stripRows, height - row0);
+                    if (!resident && !loadStrip(row0, numRows)) {
+                        success = false;
+                        break;
+                    }
+                    const int16_t* sunrise = sunriseStrip.data();
+                    const int16_t* sunset = sunsetStrip.data();
+                    if (!useGpu) {
+                        computeStrip(eph, row0, sunriseStrip.data(), sunsetStrip.data());
+                    } else if (!gpuDay(ephemeris, dayIndex, sunrise, sunset)) {
+                        success = false;
+                        break;
+                    } else if (sparse) {
+                        packValid(stripSpans(), width, sunrise, sunriseStrip.data());
+                        packValid(stripSpans(), width, sunset, sunsetStrip.data());
+                        sunrise = sunriseStrip.data();
+                        sunset = sunsetStrip.data();
+                    }
+                    
+                    StreamFrame* frame = writer.acquire();
+                    if (!frame) {
+                        success = false;
+                        break;
+                    }
+                    uint64_t offset = sparse ? stripPacked[strip] : static_cast<uint64_t>(width) * row0;
+                    uint64_t count = sparse ? stripSpans().validPixels()
+                                            : static_cast<uint64_t>(width) * numRows;
+                    {
+                        RunMetrics::Timer timer(metrics_, MetricPhase::Encode);
+                        encoder.encodeChunk(currentDayOfYear, sunrise, sunset,
+                                            offset, count, encoding, *frame);
+                    }
+                    writer.submit(frame);
+                }
+            }
+            // Binary block for this day
+            // [DayID: int32][SunriseArray][SunsetArray]
+            else if (resident) {
+                const int16_t* gpuSunrise = nullptr;
+                const int16_t* gpuSunset = nullptr;
+                if (useGpu && !gpuDay(ephemeris, dayIndex, gpuSunrise, gpuSunset)) {
+                    success = false;
+                    break;
+                }
+                StreamFrame* frame = writer.acquire();
+                if (!frame) {
+                    success = false;
+                    break;
+                }
+                *frame->part<int32_t>(0, 1) = currentDayOfYear;
+                int16_t* sunrise = frame->part<int16_t>(1, totalPixels);
+                int16_t* sunset = frame->part<int16_t>(2, totalPixels);
+                frame->parts.resize(3);
                 
-                if (std::isnan(elevation) || elevation == demNodata || elevation == 0.0f) {
-                    sunriseBuffer[i] = -1;
-                    sunsetBuffer[i] = -1;
+                if (useGpu) {
+                    std::memcpy(sunrise, gpuSunrise, totalPixels * sizeof(int16_t));
+                    std::memcpy(sunset, gpuSunset, totalPixels * sizeof(int16_t));
                 } else {
-                    int y = i / width;
-                    int x = i % width;
-                    double lon, lat;
-                    pixelToGeo(geoTransform, x, y, lon, lat);
-                    
-                    double sunrise = calc.calculateSunrise(lat, lon, elevation, year, m, d);
-                    double sunset = calc.calculateSunset(lat, lon, elevation, year, m, d);
-                    
-                    // Convert to minutes (Int16)
-                    // Handle NoData (-9999) from calculator
-                    if (sunrise < 0) sunriseBuffer[i] = -1;
-                    else sunriseBuffer[i] = static_cast<int16_t>(std::round(sunrise * 60.0));
-                    
-                    if (sunset < 0) sunsetBuffer[i] = -1;
-                    else sunsetBuffer[i] = static_cast<int16_t>(std::round(sunset * 60.0));
+                    computeStrip(eph, 0, sunrise, sunset);
+                }
+                writer.submit(frame);
+            } else {
+                StreamFrame* dayFrame = writer.acquire();
+                if (!dayFrame) {
+                    success = false;
+                    break;
+                }
+                *dayFrame->part<int32_t>(0, 1) = currentDayOfYear;
+                dayFrame->parts.resize(1);
+                writer.submit(dayFrame);
+                
+                // The sunrise array precedes the sunset array, so strips are
+                // computed twice rather than holding a full-raster day in memory
+                for (int pass = 0; success && pass < 2; ++pass) {
+                    const ArenaBuffer<int16_t>& output = (pass == 0) ? sunriseStrip : sunsetStrip;
+                    for (int strip = 0; strip < numStrips; ++strip) {
+                        int row0 = strip * stripRows;
+                        int numRows = std::min(stripRows, height - row0);
+                        size_t count = static_cast<size_t>(width) * numRows;
+                        if (!loadStrip(row0, numRows)) {
+                            success = false;
+                            break;
+                        }
+                        computeStrip(eph, row0, sunriseStrip.data(), sunsetStrip.data());
+                        
+                        StreamFrame* frame = writer.acquire();
+                        if (!frame) {
+                            success = false;
+                            break;
+                        }
+                        std::memcpy(frame->part<int16_t>(0, count), output.data(), count * sizeof(int16_t));
+                        frame->parts.resize(1);
+                        writer.submit(frame);
+                    }
                 }
             }
             
-            // Write binary block for this day
-            // [DayID: int32][SunriseArray][SunsetArray]
-            std::cout.write(reinterpret_cast<const char*>(&currentDayOfYear), sizeof(int32_t));
-            std::cout.write(reinterpret_cast<const char*>(sunriseBuffer), totalPixels * sizeof(int16_t));
-            std::cout.write(reinterpret_cast<const char*>(sunsetBuffer), totalPixels * sizeof(int16_t));
-            std::cout.flush();
+            if (metrics_) {
+                metrics_->addDays(1);
+            }
             
             // Progress to stderr to avoid corrupting stdout
-            if (currentDayOfYear % 10 == 0) {
-                std::cerr << "Processed day " << currentDayOfYear << "/" << daysInYear << std::endl;
+            if ((dayIndex + 1) % 10 == 0) {
+                std::cerr << "Processed day " << dayIndex + 1 << "/" << daysInYear
+                          << " (" << ephemeris.label() << ")" << std::endl;
+            }
+        }
+        
+        if (success && formatV2) {
+            if (StreamFrame* frame = writer.acquire()) {
+                encoder.encodeEnd(*frame);
+                writer.submit(frame);
+            } else {
+                success = false;
             }
         }
     }
     
-    delete[] demData;
-    delete[] sunriseBuffer;
-    delete[] sunsetBuffer;
+    if (!writer.finish()) {
+        success = false;
+    }
     GDALClose(inputDataset);
     
+    return success;
+}
+
+bool DemProcessor::validatePrecision(const std::string& inputPath,
+                                     int year,
+                                     double timezoneOffset) {
+    DemRaster dem;
+    if (!readDem(inputPath, dem)) {
+        return false;
+    }
+    
+    SolarGrid grid(dem.geoTransform, dem.width, dem.height);
+    if (!grid.isSeparable()) {
+        std::cerr << "Error: precision validation requires a north-up geotransform" << std::endl;
+        return false;
+    }
+    
+    size_t totalPixels = dem.data.size();
+    SolarEphemeris ephemeris(year);
+    SolarCalculator calc(timezoneOffset);
+    
+    GridTables<double> tables;
+    GridTables<float> tablesFloat;
+    tables.arena = &arena_;
+    tablesFloat.arena = &arena_;
+    if (!tables.build(dem.data, dem.width, dem.nodata) ||
+        !tablesFloat.build(dem.data, dem.width, dem.nodata)) {
+        return false;
+    }
+    
+    std::vector<int16_t> sunrise(totalPixels), sunset(totalPixels);
+    std::vector<int16_t> sunriseFloat(totalPixels), sunsetFloat(totalPixels);
+    
+    // Histogram of |float - double| in minutes; last bin is ">= HISTOGRAM_BINS - 1"
+    const int HISTOGRAM_BINS = 6;
+    std::vector<long long> histogram(HISTOGRAM_BINS, 0);
+    long long classMismatches = 0;
+    int maxDiff = 0;
+    
+    for (int dayIndex = 0; dayIndex < ephemeris.numDays(); ++dayIndex) {
+        const DayEphemeris& eph = ephemeris[dayIndex];
+        tables.computeDay(grid, calc, eph, sunrise.data(), sunset.data());
+        tablesFloat.computeDay(grid, calc, eph, sunriseFloat.data(), sunsetFloat.data());
+        
+        for (size_t i = 0; i < totalPixels; ++i) {
+            if ((sunrise[i] < 0) != (sunriseFloat[i] < 0)) {
+                classMismatches++;
+                continue;
+            }
+            if (sunrise[i] < 0) {
+                continue;
+            }
+            int diffs[2] = {minuteDistance(sunrise[i], sunriseFloat[i]),
+                            minuteDistance(sunset[i], sunsetFloat[i])};
+            for (int diff : diffs) {
+                maxDiff = std::max(maxDiff, diff);
+                histogram[std::min(diff, HISTOGRAM_BINS - 1)]++;
+            }
+        }
+    }
+    
+    std::cout << "Precision validation: " << inputPath << " (Year " << year << ")" << std::endl;
+    std::cout << "  Max difference: " << maxDiff << " min" << std::endl;
+    for (int b = 0; b < HISTOGRAM_BINS; ++b) {
+        std::cout << "  " << (b == HISTOGRAM_BINS - 1 ? ">=" : "  ") << b << " min: "
+                  << histogram[b] << std::endl;
+    }
+    std::cout << "  Valid/polar classification mismatches: " << classMismatches << std::endl;
+    
+    bool ok = maxDiff <= 1 && classMismatches == 0;
+    std::cout << (ok ? "  PASS" : "  FAIL") << " (tolerance: 1 min)" << std::endl;
+    return ok;
+}
+
+bool DemProcessor::writeParquet(const std::string& inputPath,
+                                const std::string& outputPath,
+                                int year,
+                                double timezoneOffset) {
+    return writeParquet(inputPath, std::vector<std::string>{outputPath},
+                        std::vector<SolarEphemeris>{SolarEphemeris(year)}, timezoneOffset);
+}
+
+bool DemProcessor::writeParquet(const std::string& inputPath,
+                                const std::vector<std::string>& outputPaths,
+                                const std::vector<SolarEphemeris>& periods,
+                                double timezoneOffset) {
+    DemRaster dem;
+    if (!readDem(inputPath, dem)) {
+        return false;
+    }
+    
+    SolarGrid grid(dem.geoTransform, dem.width, dem.height);
+    bool useFloat = options_.precision == Precision::Float;
+    if (!grid.isSeparable()) {
+        std::cerr << "Warning: rotated geotransform, using per-pixel solver" << std::endl;
+    }
+    
+    bool useHorizon = options_.horizonSectors > 0;
+    bool useTables = grid.isSeparable() && !useHorizon;
+    
+    GridTables<double> tables;
+    GridTables<float> tablesFloat;
+    HorizonMap horizon(options_.horizonSectors);
+    ValidSpans demSpans;
+    tables.metrics = metrics_;
+    tablesFloat.metrics = metrics_;
+    tables.arena = &arena_;
+    tablesFloat.arena = &arena_;
+    if (useTables) {
+        if (!(useFloat ? tablesFloat.build(dem.data, dem.width, dem.nodata)
+                       : tables.build(dem.data, dem.width, dem.nodata))) {
+            return false;
+        }
+        std::vector<float>().swap(dem.data);
+    } else {
+        buildStreamSpans(demSpans, dem.data.data(), dem.width, dem.height, dem.nodata);
+    }
+    if (useHorizon) {
+        computeHorizon(inputPath, dem.data.data(), dem.width, dem.height, dem.geoTransform, dem.projection,
+                       dem.nodata, horizon);
+    }
+    
+    // Sparse files hold only the valid pixels, with the mask runs in their metadata
+    bool sparse = options_.sparseOutput;
+    const ValidSpans& spans = !useTables ? demSpans : (useFloat ? tablesFloat.spans : tables.spans);
+    std::vector<uint32_t> maskRuns;
+    if (sparse) {
+        spans.appendMaskRuns(maskRuns);
+    }
+    
+    size_t totalPixels = sparse ? spans.validPixels() : static_cast<size_t>(dem.width) * dem.height;
+    std::vector<int16_t> sunrise(totalPixels), sunset(totalPixels);
+    
+    SolarCalculator calc(timezoneOffset);
+    
+    // One file per period, all computed from the tables above
+    for (size_t period = 0; period < periods.size(); ++period) {
+        const SolarEphemeris& ephemeris = periods[period];
+        
+        ParquetOutput output;
+        if (!output.open(outputPaths[period], dem.width, dem.height, ephemeris.year(),
+                         dem.geoTransform, dem.projection, options_, maskRuns)) {
+            return false;
+        }
+        
+        for (int dayIndex = 0; dayIndex < ephemeris.numDays(); ++dayIndex) {
+            const DayEphemeris& eph = ephemeris[dayIndex];
+            {
+                RunMetrics::Timer timer(metrics_, MetricPhase::Compute);
+                if (!useTables) {
+                    computePixelRows(dem.geoTransform, dem.data.data(), demSpans, dem.width, 0, calc, eph,
+                                     sunrise.data(), sunset.data(), useHorizon ? &horizon : nullptr, sparse);
+                } else if (useFloat) {
+                    tablesFloat.computeRows(grid, calc, eph, 0, sunrise.data(), sunset.data(), sparse);
+                } else {
+                    tables.computeRows(grid, calc, eph, 0, sunrise.data(), sunset.data(), sparse);
+                }
+            }
+            
+            bool written;
+            {
+                RunMetrics::Timer timer(metrics_, MetricPhase::Write);
+                written = output.writeDay(ephemeris.dayId(dayIndex), sunrise.data(), sunset.data());
+            }
+            if (!written) {
+                output.close();
+                return false;
+            }
+            if (metrics_) {
+                metrics_->addBytes(2 * totalPixels * sizeof(int16_t));
+                metrics_->addDays(1);
+            }
+            
+            if ((dayIndex + 1) % 10 == 0) {
+                std::cerr << "Processed day " << dayIndex + 1 << "/" << ephemeris.numDays()
+                          << " (" << ephemeris.label() << ")" << std::endl;
+            }
+        }
+        
+        if (!output.close()) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool DemProcessor::writeCube(const std::string& inputPath,
+                             const std::vector<std::string>& outputPaths,
+                             const std::vector<SolarEphemeris>& periods,
+                             double timezoneOffset) {
+    DemRaster dem;
+    if (!readDem(inputPath, dem)) {
+        return false;
+    }
+    
+    SolarGrid grid(dem.geoTransform, dem.width, dem.height);
+    bool useFloat = options_.precision == Precision::Float;
+    if (!grid.isSeparable()) {
+        std::cerr << "Warning: rotated geotransform, using per-pixel solver" << std::endl;
+    }
+    
+    bool useHorizon = options_.horizonSectors > 0;
+    bool useTables = grid.isSeparable() && !useHorizon;
+    
+    HorizonMap horizon(options_.horizonSectors);
+    if (useHorizon) {
+        computeHorizon(inputPath, dem.data.data(), dem.width, dem.height, dem.geoTransform, dem.projection,
+                       dem.nodata, horizon);
+    }
+    
+    // Days are computed for a strip of about 1M pixels at a time, DAY_BATCH
+    // days per pass, so the transpose writes 64 contiguous bytes per pixel
+    // of the cube instead of 4
+    const int DAY_BATCH = 16;
+    int width = dem.width;
+    int stripRows = std::max(1, std::min(dem.height, (1 << 20) / std::max(width, 1)));
+    size_t stripPixels = static_cast<size_t>(stripRows) * width;
+    std::vector<int16_t> sunrise(DAY_BATCH * stripPixels), sunset(DAY_BATCH * stripPixels);
+    
+    GridTables<double> tables;
+    GridTables<float> tablesFloat;
+    ValidSpans spans;
+    tables.metrics = metrics_;
+    tablesFloat.metrics = metrics_;
+    tables.arena = &arena_;
+    tablesFloat.arena = &arena_;
+    
+    SolarCalculator calc(timezoneOffset);
+    
+    for (size_t period = 0; period < periods.size(); ++period) {
+        const SolarEphemeris& ephemeris = periods[period];
+        int numDays = ephemeris.numDays();
+        
+        ResultCube cube;
+        if (!cube.create(outputPaths[period], width, dem.height, ephemeris, dem.geoTransform, timezoneOffset)) {
+            return false;
+        }
+        
+        for (int row0 = 0; row0 < dem.height; row0 += stripRows) {
+            int rows = std::min(stripRows, dem.height - row0);
+            size_t pixels = static_cast<size_t>(rows) * width;
+            const float* stripDem = dem.data.data() + static_cast<size_t>(row0) * width;
+            if (!useTables) {
+                buildStreamSpans(spans, stripDem, width, rows, dem.nodata);
+            } else if (!(useFloat ? tablesFloat.build(stripDem, pixels, width, dem.nodata)
+                                  : tables.build(stripDem, pixels, width, dem.nodata))) {
+                return false;
+            }
+            
+            for (int day0 = 0; day0 < numDays; day0 += DAY_BATCH) {
+                int batch = std::min(DAY_BATCH, numDays - day0);
+                {
+                    RunMetrics::Timer timer(metrics_, MetricPhase::Compute);
+                    for (int b = 0; b < batch; ++b) {
+                        const DayEphemeris& eph = ephemeris[day0 + b];
+                        int16_t* rise = &sunrise[b * stripPixels];
+                        int16_t* set = &sunset[b * stripPixels];
+                        if (!useTables) {
+                            computePixelRows(dem.geoTransform, stripDem, spans, width, row0, calc, eph,
+                                             rise, set, useHorizon ? &horizon : nullptr);
+                        } else if (useFloat) {
+                            tablesFloat.computeRows(grid, calc, eph, row0, rise, set);
+                        } else {
+                            tables.computeRows(grid, calc, eph, row0, rise, set);
+                        }
+                    }
+                }
+                
+                RunMetrics::Timer timer(metrics_, MetricPhase::Write);
+                size_t first = static_cast<size_t>(row0) * width;
+                #pragma omp parallel for schedule(static)
+                for (size_t i = 0; i < pixels; ++i) {
+                    int16_t* out = cube.pixelSeries(first + i) + day0 * 2;
+                    for (int b = 0; b < batch; ++b) {
+                        out[b * 2] = sunrise[b * stripPixels + i];
+                        out[b * 2 + 1] = sunset[b * stripPixels + i];
+                    }
+                }
+            }
+            
+            if (metrics_) {
+                metrics_->addBytes(pixels * numDays * 2 * sizeof(int16_t));
+            }
+            std::cerr << "\rProcessed rows " << row0 + rows << "/" << dem.height
+                      << " (" << ephemeris.label() << ")" << std::flush;
+        }
+        std::cerr << std::endl;
+        
+        if (!cube.finish()) {
+            return false;
+        }
+        if (metrics_) {
+            metrics_->addDays(numDays);
+        }
+        std::cerr << "Result cube written to " << outputPaths[period] << std::endl;
+    }
+    
     return true;
 }
 
@@ -200,9 +1248,19 @@ bool DemProcessor::processDEM(const std::string& inputPath,
                              const std::string& outputPath,
                              int year,
                              double timezoneOffset) {
+    return processDEM(inputPath, std::vector<std::string>{outputPath},
+                      std::vector<SolarEphemeris>{SolarEphemeris(year)}, timezoneOffset);
+}
+
+bool DemProcessor::processDEM(const std::string& inputPath,
+                             const std::vector<std::string>& outputPaths,
+                             const std::vector<SolarEphemeris>& periods,
+                             double timezoneOffset) {
     std::cout << "\n========================================" << std::endl;
     std::cout << "Processing: " << inputPath << std::endl;
-    std::cout << "Year: " << year << " (Full Year)" << std::endl;
+    for (const SolarEphemeris& period : periods) {
+        std::cout << "Period: " << period.label() << (period.isRange() ? "" : " (Full Year)") << std::endl;
+    }
     std::cout << "========================================\n" << std::endl;
     
     // Open input DEM
@@ -222,142 +1280,658 @@ bool DemProcessor::processDEM(const std::string& inputPath,
     inputDataset->GetGeoTransform(geoTransform);
     const char* projection = inputDataset->GetProjectionRef();
     
-    // Determine number of days in year (handle leap years)
-    bool isLeap = (year % 4 == 0 && year % 100 != 0) || (year % 400 == 0);
-    int daysInYear = isLeap ? 366 : 365;
-    int numBands = daysInYear * 2;
-    
-    std::cout << "Days in year: " << daysInYear << std::endl;
-    std::cout << "Output bands: " << numBands << std::endl;
-    
-    // Create output dataset
-    GDALDataset* outputDataset = createOutputDataset(outputPath, width, height, numBands,
-                                                      geoTransform, projection);
-    if (!outputDataset) {
+    // Rows written by this run; the output raster starts at rowBegin
+    bool windowed = options_.rowCount > 0;
+    int rowBegin = windowed ? std::min(std::max(options_.rowBegin, 0), height) : 0;
+    int rowEnd = windowed ? std::min(rowBegin + options_.rowCount, height) : height;
+    if (rowEnd <= rowBegin) {
+        std::cerr << "Error: Row window " << options_.rowBegin << "+" << options_.rowCount
+                  << " is outside the DEM" << std::endl;
         GDALClose(inputDataset);
         return false;
     }
-    
-    // Initialize solar calculator
-    SolarCalculator calc(timezoneOffset);
+    double outputGeoTransform[6];
+    std::memcpy(outputGeoTransform, geoTransform, sizeof(geoTransform));
+    outputGeoTransform[0] += rowBegin * geoTransform[2];
+    outputGeoTransform[3] += rowBegin * geoTransform[5];
+    if (windowed) {
+        std::cout << "Row window: " << rowBegin << " - " << rowEnd << std::endl;
+    }
     
     // Process in blocks to manage memory
     // Block size 512x512 is standard for tiled GeoTIFF
     int blockXSize = 512;
     int blockYSize = 512;
     
-    // Buffer for one block of DEM data
-    float* demBlock = new float[blockXSize * blockYSize];
-    
-    // Buffer for one block of output data (all bands)
-    // Size: 512 * 512 * 730 * 4 bytes ~= 765 MB
-    // This is allocated once and reused
-    float* outputBlock = new float[blockXSize * blockYSize * numBands];
-    
     GDALRasterBand* demBand = inputDataset->GetRasterBand(1);
     float demNodata = static_cast<float>(demBand->GetNoDataValue());
     
-    int totalBlocks = ((width + blockXSize - 1) / blockXSize) * ((height + blockYSize - 1) / blockYSize);
-    int processedBlocks = 0;
+    int blocksPerRow = (width + blockXSize - 1) / blockXSize;
+    int blockRows = (rowEnd - rowBegin + blockYSize - 1) / blockYSize;
+    int totalBlocks = blocksPerRow * blockRows;
+    
+    // Output sample type and interleave of the file and of the block buffers
+    bool int16Output = options_.outputType == OutputType::Int16;
+    bool pixelInterleaved = options_.interleave == Interleave::Pixel;
+    GDALDataType outputDataType = int16Output ? GDT_Int16 : GDT_Float32;
+    size_t sampleBytes = int16Output ? sizeof(int16_t) : sizeof(float);
+    bool useHorizon = options_.horizonSectors > 0;
     
-    std::cout << "\nProcessing blocks..." << std::endl;
+    // Everything but the DEM values that the output depends on, recorded in
+    // it; an incremental update must be run with the same parameters
+    auto outputParameters = [&](const SolarEphemeris& period) {
+        std::ostringstream text;
+        text.precision(17);
+        text << "period=" << period.label() << " timezone=" << timezoneOffset
+             << " type=" << (int16Output ? "int16" : "float32")
+             << " interleave=" << (pixelInterleaved ? "pixel" : "band")
+             << " horizon=" << options_.horizonSectors
+             << " rows=" << rowBegin << "-" << rowEnd << " nodata=" << demNodata;
+        if (windowed && useHorizon) {
+            text << " halo=" << options_.horizonHalo;
+        }
+        text << " geotransform=";
+        for (int i = 0; i < 6; ++i) {
+            text << (i ? "," : "") << geoTransform[i];
+        }
+        return text.str();
+    };
+    
+    // One output dataset per period; every DEM block is read once for all of them.
+    // An incremental update opens the outputs of the previous run instead.
+    bool incremental = options_.incrementalUpdate;
+    std::vector<std::vector<uint32_t>> storedCrcs(periods.size());
+    std::vector<GDALDataset*> outputDatasets;
+    int maxBands = 0;
+    for (size_t period = 0; period < periods.size(); ++period) {
+        int numBands = periods[period].numDays() * 2;
+        maxBands = std::max(maxBands, numBands);
+        std::cout << "Output bands: " << numBands << " -> " << outputPaths[period]
+                  << (incremental ? " (update)" : "") << std::endl;
+        
+        GDALDataset* outputDataset = incremental
+            ? openOutputDataset(outputPaths[period], width, rowEnd - rowBegin, numBands,
+                                outputParameters(periods[period]), totalBlocks, storedCrcs[period])
+            : createOutputDataset(outputPaths[period], width, rowEnd - rowBegin,
+                                  periods[period], outputGeoTransform, projection);
+        if (!outputDataset) {
+            for (GDALDataset* dataset : outputDatasets) GDALClose(dataset);
+            GDALClose(inputDataset);
+            return false;
+        }
+        outputDatasets.push_back(outputDataset);
+    }
+    
+    auto closeAll = [&]() {
+        GDALClose(inputDataset);
+        for (GDALDataset* dataset : outputDatasets) GDALClose(dataset);
+    };
     
-    // Loop over blocks
-    for (int y = 0; y < height; y += blockYSize) {
-        for (int x = 0; x < width; x += blockXSize) {
+    // DEM checksum of each block, recorded in the outputs once they are complete
+    std::vector<uint32_t> blockCrcs(totalBlocks, 0);
+    
+    // Blocks to compute, and for each period the blocks to write
+    std::vector<int> blockList;
+    std::vector<std::vector<char>> rewrite(periods.size(), std::vector<char>(totalBlocks, 1));
+    if (!incremental) {
+        blockList.resize(totalBlocks);
+        for (int block = 0; block < totalBlocks; ++block) blockList[block] = block;
+    } else {
+        // Checksum the new DEM one row of blocks at a time (rows are chained,
+        // so this matches the checksum of a block read on its own)
+        std::vector<float> strip(static_cast<size_t>(width) * blockYSize);
+        for (int blockRow = 0; blockRow < blockRows; ++blockRow) {
+            int y = rowBegin + blockRow * blockYSize;
+            int rows = std::min(blockYSize, rowEnd - y);
+            CPLErr err;
+            {
+                RunMetrics::Timer timer(metrics_, MetricPhase::DemRead);
+                err = demBand->RasterIO(GF_Read, 0, y, width, rows, strip.data(), width, rows,
+                                        GDT_Float32, 0, 0);
+            }
+            if (err != CE_None) {
+                std::cerr << "Error reading DEM rows at " << y << std::endl;
+                closeAll();
+                return false;
+            }
+            for (int blockX = 0; blockX < blocksPerRow; ++blockX) {
+                int x = blockX * blockXSize;
+                size_t rowBytes = std::min(blockXSize, width - x) * sizeof(float);
+                uint32_t crc = 0;
+                for (int row = 0; row < rows; ++row) {
+                    crc = StreamEncoder::crc32(&strip[static_cast<size_t>(row) * width + x], rowBytes, crc);
+                }
+                blockCrcs[blockRow * blocksPerRow + blockX] = crc;
+            }
+        }
+        
+        // Terrain changes move the horizon of pixels up to horizonHalo away,
+        // so the changed blocks are grown by that many blocks (0 = whole DEM)
+        int haloX = 0;
+        int haloY = 0;
+        if (useHorizon) {
+            haloX = blocksPerRow;
+            haloY = blockRows;
+            if (options_.horizonHalo > 0.0) {
+                double metresX = std::fabs(geoTransform[1]);
+                double metresY = std::fabs(geoTransform[5]);
+                if (isGeographicCrs(projection ? projection : "")) {
+                    double centerLat = geoTransform[3] + 0.5 * height * geoTransform[5];
+                    metresX *= 111320.0 * std::cos(centerLat * M_PI / 180.0);
+                    metresY *= 111320.0;
+                }
+                haloX = static_cast<int>(std::ceil(options_.horizonHalo / metresX / blockXSize));
+                haloY = static_cast<int>(std::ceil(options_.horizonHalo / metresY / blockYSize));
+            }
+        }
+        
+        std::vector<char> compute(totalBlocks, 0);
+        for (size_t period = 0; period < periods.size(); ++period) {
+            std::vector<char>& dirty = rewrite[period];
+            std::fill(dirty.begin(), dirty.end(), 0);
+            int changed = 0;
+            for (int block = 0; block < totalBlocks; ++block) {
+                if (storedCrcs[period][block] == blockCrcs[block]) {
+                    continue;
+                }
+                changed++;
+                int blockX = block % blocksPerRow;
+                int blockRow = block / blocksPerRow;
+                for (int by = std::max(0, blockRow - haloY); by <= std::min(blockRows - 1, blockRow + haloY); ++by) {
+                    for (int bx = std::max(0, blockX - haloX); bx <= std::min(blocksPerRow - 1, blockX + haloX); ++bx) {
+                        dirty[by * blocksPerRow + bx] = 1;
+                    }
+                }
+            }
+            int rewritten = static_cast<int>(std::count(dirty.begin(), dirty.end(), 1));
+            std::cout << outputPaths[period] << ": " << changed << " changed DEM blocks, "
+                      << rewritten << "/" << totalBlocks << " blocks to rewrite" << std::endl;
+            for (int block = 0; block < totalBlocks; ++block) {
+                compute[block] |= dirty[block];
+            }
+        }
+        for (int block = 0; block < totalBlocks; ++block) {
+            if (compute[block]) blockList.push_back(block);
+        }
+        
+        if (blockList.empty()) {
+            std::cout << "Outputs are up to date" << std::endl;
+            closeAll();
+            return true;
+        }
+    }
+    int numComputed = static_cast<int>(blockList.size());
+    
+    // Initialize solar calculator
+    SolarCalculator calc(timezoneOffset);
+    
+    // Separable solver (see SolarGrid); tables are rebuilt for each block
+    SolarGrid grid(geoTransform, width, height);
+    if (!grid.isSeparable()) {
+        std::cout << "Rotated geotransform, using per-pixel solver" << std::endl;
+    }
+    
+    // Terrain horizon: computed once from the whole DEM, then used per pixel.
+    // A row window only needs its rows plus a halo of horizonHalo metres.
+    bool useTables = grid.isSeparable() && !useHorizon;
+    HorizonMap horizon(options_.horizonSectors);
+    int horizonRow0 = 0;
+    if (useHorizon) {
+        int horizonRows = height;
+        std::string cacheTag;
+        if (windowed && options_.horizonHalo > 0.0) {
+            double rowMetres = std::fabs(geoTransform[5]) * (isGeographicCrs(projection ? projection : "") ? 111320.0 : 1.0);
+            int haloRows = static_cast<int>(std::ceil(options_.horizonHalo / rowMetres));
+            horizonRow0 = std::max(0, rowBegin - haloRows);
+            horizonRows = std::min(height, rowEnd + haloRows) - horizonRow0;
+            cacheTag = ".rows" + std::to_string(horizonRow0) + "-" + std::to_string(horizonRow0 + horizonRows);
+        }
+        
+        DemRaster dem;
+        if (!readDem(inputPath, dem, horizonRow0, horizonRows < height ? horizonRows : 0)) {
+            closeAll();
+            return false;
+        }
+        computeHorizon(inputPath, dem.data.data(), width, dem.height, dem.geoTransform, dem.projection,
+                       dem.nodata, horizon, cacheTag);
+    }
+    
+    // Blocks in flight: each owns a DEM block and an all-band output block
+    // (512 * 512 * 730 * 4 bytes ~= 765 MB as Float32), so memory is bounded by their number
+    size_t outputBlockBytes = static_cast<size_t>(blockXSize) * blockYSize * maxBands * sampleBytes;
+    int blocksInFlight = options_.blocksInFlight;
+    if (blocksInFlight <= 0) {
+        blocksInFlight = 4;
+        if (options_.maxMemoryBytes > 0) {
+            blocksInFlight = static_cast<int>(options_.maxMemoryBytes / outputBlockBytes);
+        }
+    }
+    blocksInFlight = std::max(1, std::min({blocksInFlight, numComputed, std::max(numThreads_, 1)}));
+    
+    // Threads computing each block; GDAL compresses on its own NUM_THREADS pool.
+    // Under processJobs this is only the share wanted from the shared budget.
+    int threadsPerBlock = std::max(1, numThreads_ / blocksInFlight);
+    
+    std::cout << "\nProcessing blocks (" << blocksInFlight << " in flight, "
+              << threadsPerBlock << " threads each)..." << std::endl;
+    
+    // Buffers of one block in flight, allocated once and reused
+    // (leased from the arena, so the next job of a manifest reuses them)
+    struct BlockSlot {
+        ArenaBuffer<float> dem;
+        ArenaBuffer<char> output;         // Float32 or Int16 samples, file interleave
+        ArenaBuffer<double> cosZenith;
+        ArenaBuffer<double> solarNoon;    // [day][column]
+        ArenaBuffer<double> rowScale;     // [day][row]
+        ArenaBuffer<double> rowOffset;    // [day][row]
+        ValidSpans spans;                 // Valid pixels of the DEM block
+    };
+    
+    // Compute all bands of one period for the block at (x, y) into slot.output
+    auto computeBlock = [&](BlockSlot& slot, const SolarEphemeris& ephemeris, int blockThreads,
+                            int x, int y, int currentBlockX, int currentBlockY) {
+        int daysInYear = ephemeris.numDays();
+        int numBands = daysInYear * 2;
+        size_t blockPixels = static_cast<size_t>(currentBlockX) * currentBlockY;
+        int pixelCount = currentBlockX * currentBlockY;
+        const float* demBlock = slot.dem.data();
+        
+        if (useTables) {
+            #pragma omp parallel for schedule(static) num_threads(blockThreads)
+            for (int i = 0; i < pixelCount; ++i) {
+                slot.cosZenith[i] = SolarCalculator::zenithCosine(demBlock[i]);
+            }
+            for (int dayIndex = 0; dayIndex < daysInYear; ++dayIndex) {
+                const DayEphemeris& eph = ephemeris[dayIndex];
+                grid.solarNoonTable(eph, x, currentBlockX, &slot.solarNoon[dayIndex * currentBlockX]);
+                for (int localY = 0; localY < currentBlockY; ++localY) {
+                    grid.rowTerms(eph, y + localY,
+                                  slot.rowScale[dayIndex * currentBlockY + localY],
+                                  slot.rowOffset[dayIndex * currentBlockY + localY]);
+                }
+            }
+        }
+        
+        // Strides in elements between bands and between pixels of the block
+        size_t bandStride = pixelInterleaved ? 1 : blockPixels;
+        size_t pixelStride = pixelInterleaved ? numBands : 1;
+        
+        // Process pixels in block
+        // Output buffer layout follows the file interleave: [band][pixel] or [pixel][band].
+        // Pixels are computed in tiles of up to TILE_PIXELS consecutive pixels of a
+        // valid span (row localY, from column localX of the block) by TILE_DAYS days.
+        // The inputs of a tile stay in L1 and its stores follow the file order:
+        // runs of bands of one pixel, or runs of pixels of one band, instead of
+        // one store per day across the whole band-sequential buffer.
+        constexpr int TILE_PIXELS = 64;
+        constexpr int TILE_DAYS = 32;
+        auto computeTile = [&](auto* outputBlock, size_t start, int localY, int localX, int count,
+                               int day0, int days) {
+            // Visit (pixel, day) in the order of the output buffer
+            auto forEachInTile = [&](auto&& body) {
+                if (pixelInterleaved) {
+                    for (int p = 0; p < count; ++p) {
+                        for (int dayIndex = day0; dayIndex < day0 + days; ++dayIndex) body(p, dayIndex);
+                    }
+                } else {
+                    for (int dayIndex = day0; dayIndex < day0 + days; ++dayIndex) {
+                        for (int p = 0; p < count; ++p) body(p, dayIndex);
+                    }
+                }
+            };
+            
+            // Band indices (0-based): sunrise, then sunset
+            auto store = [&](int p, int dayIndex, const DayEvents& events) {
+                auto* pixelOut = outputBlock + (start + p) * pixelStride;
+                storeEvents(events, pixelOut[(dayIndex * 2) * bandStride],
+                            pixelOut[(dayIndex * 2 + 1) * bandStride]);
+            };
+            
+            if (useTables) {
+                const double* cosZen = &slot.cosZenith[start];
+                forEachInTile([&](int p, int dayIndex) {
+                    store(p, dayIndex, calc.calculateDayEvents(
+                        cosZen[p],
+                        slot.rowScale[dayIndex * currentBlockY + localY],
+                        slot.rowOffset[dayIndex * currentBlockY + localY],
+                        slot.solarNoon[dayIndex * currentBlockX + localX + p]));
+                });
+            } else {
+                double lon[TILE_PIXELS], lat[TILE_PIXELS];
+                const int16_t* pixelHorizon[TILE_PIXELS];
+                for (int p = 0; p < count; ++p) {
+                    pixelToGeo(geoTransform, x + localX + p, y + localY, lon[p], lat[p]);
+                    pixelHorizon[p] = useHorizon
+                        ? horizon.pixel(static_cast<size_t>(y + localY - horizonRow0) * width + x + localX + p)
+                        : nullptr;
+                }
+                forEachInTile([&](int p, int dayIndex) {
+                    const DayEphemeris& eph = ephemeris[dayIndex];
+                    float elevation = demBlock[start + p];
+                    store(p, dayIndex, pixelHorizon[p]
+                        ? calc.calculateDayEvents(eph, lat[p], lon[p], elevation,
+                                                  pixelHorizon[p], horizon.numSectors())
+                        : calc.calculateDayEvents(eph, lat[p], lon[p], elevation));
+                });
+            }
+        };
+        
+        // Only the valid spans of the block are computed, with dynamic
+        // scheduling; nodata gaps are written as NODATA_VALUE in every band
+        const std::vector<ValidSpans::Span>& valid = slot.spans.valid();
+        const std::vector<ValidSpans::Span>& gaps = slot.spans.gaps();
+        auto fillBlock = [&](auto* outputBlock) {
+            using Sample = std::decay_t<decltype(*outputBlock)>;
+            
+            RunMetrics::RegionTimer region(metrics_, blockThreads);
+            #pragma omp parallel num_threads(blockThreads)
+            {
+                #pragma omp for schedule(static) nowait
+                for (size_t g = 0; g < gaps.size(); ++g) {
+                    size_t start = gaps[g].offset(currentBlockX);
+                    for (size_t i = start; i < start + gaps[g].length; ++i) {
+                        for (int b = 0; b < numBands; ++b) {
+                            outputBlock[i * pixelStride + b * bandStride] = static_cast<Sample>(NODATA_VALUE);
+                        }
+                    }
+                }
+                
+                #pragma omp for schedule(dynamic, 1) nowait
+                for (size_t s = 0; s < valid.size(); ++s) {
+                    const ValidSpans::Span& span = valid[s];
+                    size_t start = span.offset(currentBlockX);
+                    for (int k = 0; k < span.length; k += TILE_PIXELS) {
+                        int count = std::min(TILE_PIXELS, span.length - k);
+                        for (int day0 = 0; day0 < daysInYear; day0 += TILE_DAYS) {
+                            computeTile(outputBlock, start + k, span.row, span.begin + k, count,
+                                        day0, std::min(TILE_DAYS, daysInYear - day0));
+                        }
+                    }
+                }
+                region.threadDone();
+            }
+        };
+        
+        if (int16Output) {
+            fillBlock(reinterpret_cast<int16_t*>(slot.output.data()));
+        } else {
+            fillBlock(reinterpret_cast<float*>(slot.output.data()));
+        }
+    };
+    
+    std::vector<int> bandList(maxBands);
+    for (int i = 0; i < maxBands; ++i) bandList[i] = i + 1;
+    
+    int nextBlock = 0;
+    int processedBlocks = 0;
+    bool success = true;
+
+#ifdef _OPENMP
+    // Outer team schedules blocks, inner teams compute them (one level
+    // deeper when running inside a processJobs worker)
+    omp_set_max_active_levels(std::max(omp_get_max_active_levels(), omp_get_level() + 2));
+#endif
+    
+    // Each worker takes the next block, computes it with its own thread subset
+    // and writes it. A GDAL dataset must not be used by two threads at once, so
+    // each dataset of this call has its own lock: the blocks of other jobs in
+    // processJobs, which use other datasets, keep reading and writing. The
+    // block cache and the GTiff compression pool are thread-safe in GDAL.
+    std::mutex demMutex;
+    std::vector<std::mutex> outputMutexes(periods.size());
+    std::mutex progressMutex;
+    #pragma omp parallel num_threads(blocksInFlight)
+    {
+        // Tables sized for the longest period; the output is fully written
+        // (nodata gaps included), so nothing is zeroed
+        BlockSlot slot;
+        size_t maxDays = maxBands / 2;
+        bool allocated = slot.dem.allocate(static_cast<size_t>(blockXSize) * blockYSize, &arena_) &&
+                         slot.output.allocate(outputBlockBytes, &arena_) &&
+                         (!useTables ||
+                          (slot.cosZenith.allocate(static_cast<size_t>(blockXSize) * blockYSize, &arena_) &&
+                           slot.solarNoon.allocate(maxDays * blockXSize, &arena_) &&
+                           slot.rowScale.allocate(maxDays * blockYSize, &arena_) &&
+                           slot.rowOffset.allocate(maxDays * blockYSize, &arena_)));
+        if (!allocated) {
+            #pragma omp atomic write
+            success = false;
+        }
+        
+        while (allocated) {
+            int index;
+            #pragma omp atomic capture
+            index = nextBlock++;
+            if (index >= numComputed) {
+                break;
+            }
+            int block = blockList[index];
+            
+            int x = (block % blocksPerRow) * blockXSize;
+            int y = rowBegin + (block / blocksPerRow) * blockYSize;
             int currentBlockX = std::min(blockXSize, width - x);
-            int currentBlockY = std::min(blockYSize, height - y);
+            int currentBlockY = std::min(blockYSize, rowEnd - y);
             
             // Read DEM block
-            CPLErr err = demBand->RasterIO(GF_Read, x, y, currentBlockX, currentBlockY,
-                                         demBlock, currentBlockX, currentBlockY, GDT_Float32,
-                                         0, 0);
+            CPLErr err;
+            double lockStart = RunMetrics::now();
+            {
+                std::lock_guard<std::mutex> lock(demMutex);
+                if (metrics_) {
+                    metrics_->addTime(MetricPhase::IoLockWait, RunMetrics::now() - lockStart);
+                }
+                RunMetrics::Timer timer(metrics_, MetricPhase::DemRead);
+                err = demBand->RasterIO(GF_Read, x, y, currentBlockX, currentBlockY,
+                                        slot.dem.data(), currentBlockX, currentBlockY, GDT_Float32,
+                                        0, 0);
+            }
             
             if (err != CE_None) {
                 std::cerr << "Error reading DEM block at " << x << "," << y << std::endl;
+                #pragma omp atomic write
+                success = false;
                 continue;
             }
+            if (!incremental) {
+                blockCrcs[block] = StreamEncoder::crc32(slot.dem.data(),
+                                                        static_cast<size_t>(currentBlockX) * currentBlockY * sizeof(float));
+            }
+            slot.spans.build(slot.dem.data(), currentBlockX, currentBlockY, [demNodata](float elevation) {
+                return std::isnan(elevation) || elevation == demNodata;
+            });
             
-            // Process pixels in block
-            // Parallelize over pixels within the block
-            #pragma omp parallel for schedule(static)
-            for (int i = 0; i < currentBlockY * currentBlockX; ++i) {
-                int localY = i / currentBlockX;
-                int localX = i % currentBlockX;
-                int globalX = x + localX;
-                int globalY = y + localY;
-                
-                float elevation = demBlock[i];
-                
-                // Base index in output buffer for this pixel
-                // Output buffer layout: [pixel 0 all bands][pixel 1 all bands]...
-                // Wait, GDAL RasterIO expects: [band 1 all pixels][band 2 all pixels]... if using band sequential
-                // OR [pixel 0 band 1][pixel 0 band 2]... if using pixel interleaved
-                // Let's use standard band sequential for the buffer to match GDAL default expectation for multi-band write
-                // Buffer layout: [Band 1 (all pixels)][Band 2 (all pixels)]...
+            // Threads of this block, taken from the jobs' shared pool if any
+            int blockThreads = threadBudget_ ? threadBudget_->acquire(threadsPerBlock) : threadsPerBlock;
+            
+            for (size_t period = 0; period < periods.size(); ++period) {
+                if (!rewrite[period][block]) {
+                    continue;
+                }
+                int numBands = periods[period].numDays() * 2;
+                {
+                    RunMetrics::Timer timer(metrics_, MetricPhase::Compute);
+                    computeBlock(slot, periods[period], blockThreads, x, y, currentBlockX, currentBlockY);
+                }
                 
-                if (std::isnan(elevation) || elevation == demNodata) {
-                    for (int b = 0; b < numBands; ++b) {
-                        outputBlock[b * (currentBlockX * currentBlockY) + i] = NODATA_VALUE;
+                // Write output block to all bands; with NUM_THREADS the GTiff
+                // driver compresses the tiles of this write on its worker pool
+                lockStart = RunMetrics::now();
+                {
+                    std::lock_guard<std::mutex> lock(outputMutexes[period]);
+                    if (metrics_) {
+                        metrics_->addTime(MetricPhase::IoLockWait, RunMetrics::now() - lockStart);
+                        metrics_->addBytes(static_cast<uint64_t>(currentBlockX) * currentBlockY * numBands * sampleBytes);
                     }
-                } else {
-                    double lon, lat;
-                    pixelToGeo(geoTransform, globalX, globalY, lon, lat);
+                    RunMetrics::Timer timer(metrics_, MetricPhase::Write);
+                    // Buffer spacing in bytes; band sequential uses GDAL's default strides
+                    GSpacing pixelSpace = pixelInterleaved ? numBands * sampleBytes : 0;
+                    GSpacing lineSpace = pixelInterleaved ? pixelSpace * currentBlockX : 0;
+                    GSpacing bandSpace = pixelInterleaved ? sampleBytes : 0;
+                    err = outputDatasets[period]->RasterIO(GF_Write, x, y - rowBegin, currentBlockX, currentBlockY,
+                                                           slot.output.data(), currentBlockX, currentBlockY,
+                                                           outputDataType, numBands, bandList.data(),
+                                                           pixelSpace, lineSpace, bandSpace);
                     
-                    // Calculate for all days
-                    int currentDayOfYear = 0;
-                    for (int m = 1; m <= 12; ++m) {
-                        int daysInMonth = 31;
-                        if (m == 4 || m == 6 || m == 9 || m == 11) daysInMonth = 30;
-                        else if (m == 2) daysInMonth = isLeap ? 29 : 28;
-                        
-                        for (int d = 1; d <= daysInMonth; ++d) {
-                            currentDayOfYear++;
-                            
-                            double sunrise = calc.calculateSunrise(lat, lon, elevation, year, m, d);
-                            double sunset = calc.calculateSunset(lat, lon, elevation, year, m, d);
-                            
-                            // Band indices (0-based for buffer)
-                            int sunriseBandIdx = (currentDayOfYear - 1) * 2;
-                            int sunsetBandIdx = sunriseBandIdx + 1;
-                            
-                            outputBlock[sunriseBandIdx * (currentBlockX * currentBlockY) + i] = static_cast<float>(sunrise);
-                            outputBlock[sunsetBandIdx * (currentBlockX * currentBlockY) + i] = static_cast<float>(sunset);
-                        }
+                    if (err != CE_None) {
+                        std::cerr << "Error writing output block at " << x << "," << y << std::endl;
+                        #pragma omp atomic write
+                        success = false;
                     }
                 }
             }
             
-            // Write output block to all bands
-            // We use RasterIO on the dataset to write all bands at once
-            // Note: We need to construct the band list
-            std::vector<int> bandList(numBands);
-            for(int i=0; i<numBands; ++i) bandList[i] = i + 1;
-            
-            err = outputDataset->RasterIO(GF_Write, x, y, currentBlockX, currentBlockY,
-                                        outputBlock, currentBlockX, currentBlockY, GDT_Float32,
-                                        numBands, bandList.data(),
-                                        0, 0, 0); // Default strides for band sequential
+            if (threadBudget_) {
+                threadBudget_->release(blockThreads);
+            }
             
-            if (err != CE_None) {
-                std::cerr << "Error writing output block at " << x << "," << y << std::endl;
+            if (metrics_) {
+                metrics_->addBlocks(1);
             }
             
-            processedBlocks++;
-            std::cout << "\rProcessed block " << processedBlocks << "/" << totalBlocks << std::flush;
+            {
+                std::lock_guard<std::mutex> lock(progressMutex);
+                processedBlocks++;
+                std::cout << "\rProcessed block " << processedBlocks << "/" << numComputed << std::flush;
+            }
         }
     }
     
     std::cout << "\n\nWriting metadata and closing..." << std::endl;
     
-    delete[] demBlock;
-    delete[] outputBlock;
+    // Record what the outputs were computed from. A failed run keeps the
+    // previous checksums, so the next update recomputes the blocks it changed.
+    if (success) {
+        std::string crcs = formatBlockCrcs(blockCrcs);
+        for (size_t period = 0; period < periods.size(); ++period) {
+            outputDatasets[period]->SetMetadataItem("PARAMETERS", outputParameters(periods[period]).c_str(),
+                                                    UPDATE_DOMAIN);
+            outputDatasets[period]->SetMetadataItem("DEM_BLOCK_CRC32", crcs.c_str(), UPDATE_DOMAIN);
+        }
+    }
     
-    GDALClose(inputDataset);
-    GDALClose(outputDataset);
+    closeAll();
+    
+    if (!success) {
+        std::cerr << "Error: some blocks failed, output is incomplete" << std::endl;
+        return false;
+    }
     
-    std::cout << "✓ Output saved to: " << outputPath << std::endl;
+    for (const std::string& outputPath : outputPaths) {
+        std::cout << "✓ Output saved to: " << outputPath << std::endl;
+    }
     std::cout << "========================================\n" << std::endl;
     
     return true;
 }
+
+bool DemProcessor::serve(const std::string& inputPath,
+                         double timezoneOffset,
+                         const std::string& socketPath) {
+    DemRaster dem;
+    if (!readDem(inputPath, dem)) {
+        return false;
+    }
+    
+    HorizonMap horizon(options_.horizonSectors);
+    bool useHorizon = options_.horizonSectors > 0;
+    if (useHorizon) {
+        computeHorizon(inputPath, dem.data.data(), dem.width, dem.height, dem.geoTransform, dem.projection,
+                       dem.nodata, horizon);
+    }
+    
+    SolarService service(dem.data.data(), dem.width, dem.height, dem.geoTransform, dem.nodata,
+                         useHorizon ? &horizon : nullptr, timezoneOffset, options_.serviceCacheBytes);
+    std::cerr << "DEM " << inputPath << " resident (" << dem.width << " x " << dem.height
+              << "), tile cache " << options_.serviceCacheBytes / (1024 * 1024) << " MB" << std::endl;
+    
+    if (!socketPath.empty()) {
+        return service.serveSocket(socketPath);
+    }
+    bool served = service.serve(stdin, stdout);
+    std::cerr << "Tile cache: " << service.cacheHits() << " hits, " << service.cacheMisses()
+              << " misses" << std::endl;
+    return served;
+}
+
+bool DemProcessor::processJobs(const std::vector<DemJob>& jobs) {
+    int numJobs = static_cast<int>(jobs.size());
+    int totalThreads = numThreads_ > 0 ? numThreads_ : 1;
+#ifdef _OPENMP
+    if (numThreads_ <= 0) {
+        totalThreads = omp_get_max_threads();
+    }
+#endif
+    
+    // Largest DEM first, so that the small ones fill the cores at the end
+    std::vector<long long> jobPixels(numJobs, 0);
+    for (int i = 0; i < numJobs; ++i) {
+        GDALDataset* dataset = (GDALDataset*)GDALOpen(jobs[i].inputPath.c_str(), GA_ReadOnly);
+        if (dataset) {
+            jobPixels[i] = static_cast<long long>(dataset->GetRasterXSize()) * dataset->GetRasterYSize();
+            GDALClose(dataset);
+        }
+    }
+    std::vector<int> order(numJobs);
+    for (int i = 0; i < numJobs; ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&](int a, int b) { return jobPixels[a] > jobPixels[b]; });
+    
+    int jobsInFlight = options_.jobsInFlight > 0 ? options_.jobsInFlight : 4;
+    jobsInFlight = std::max(1, std::min({jobsInFlight, numJobs, totalThreads}));
+    
+    // Memory budget and threads are split between the jobs in flight;
+    // block threads are then balanced through the shared budget
+    size_t maxMemoryBytes = options_.maxMemoryBytes;
+    options_.maxMemoryBytes = maxMemoryBytes / jobsInFlight;
+    ThreadBudget budget(totalThreads);
+    threadBudget_ = &budget;
+    int threadsPerJob = std::max(1, totalThreads / jobsInFlight);
+    
+    std::cerr << "Processing " << numJobs << " jobs (" << jobsInFlight << " in flight, "
+              << totalThreads << " shared threads)" << std::endl;
+    
+    std::vector<char> jobSucceeded(numJobs, 0);
+    std::vector<double> jobSeconds(numJobs, 0.0);
+
+#ifdef _OPENMP
+    // Job team, then block teams, then pixel teams
+    omp_set_max_active_levels(3);
+#endif
+    
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(jobsInFlight)
+    for (int k = 0; k < numJobs; ++k) {
+        const DemJob& job = jobs[order[k]];
+#ifdef _OPENMP
+        // Parallel regions outside the block loop (horizon, Parquet) use a fixed share
+        omp_set_num_threads(threadsPerJob);
+#endif
+        auto start = std::chrono::steady_clock::now();
+        
+        bool ok = job.parquetPath.empty()
+            ? processDEM(job.inputPath, job.outputPath, job.year, job.timezoneOffset)
+            : writeParquet(job.inputPath, job.parquetPath, job.year, job.timezoneOffset);
+        
+        jobSucceeded[order[k]] = ok;
+        jobSeconds[order[k]] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    
+    threadBudget_ = nullptr;
+    options_.maxMemoryBytes = maxMemoryBytes;
+    
+    // Summary in manifest order
+    int failed = 0;
+    std::cerr << "\nJobs:" << std::endl;
+    for (int i = 0; i < numJobs; ++i) {
+        const DemJob& job = jobs[i];
+        std::cerr << (jobSucceeded[i] ? "  ✓ " : "  ✗ ") << job.inputPath << " -> "
+                  << (job.parquetPath.empty() ? job.outputPath : job.parquetPath)
+                  << " (" << jobSeconds[i] << " s)" << std::endl;
+        failed += jobSucceeded[i] ? 0 : 1;
+    }
+    
+    if (failed > 0) {
+        std::cerr << "Error: " << failed << " of " << numJobs << " jobs failed" << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -3,8 +3,17 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 #include "gdal_priv.h"
 #include "SolarCalculator.h"
+#include "ProcessingOptions.h"
+#include "HorizonMap.h"
+#include "SolarEphemeris.h"
+#include "JobManifest.h"
+#include "ThreadBudget.h"
+#include "ValidSpans.h"
+#include "RunMetrics.h"
+#include "BufferArena.h"
 
 /**
  * DemProcessor class
@@ -25,14 +34,79 @@ public:
      */
     ~DemProcessor();
     
+    /**
+     * Set tuning options for subsequent runs
+     */
+    void setOptions(const ProcessingOptions& options) {
+        options_ = options;
+        arena_.setHugePages(options.hugePages);
+    }
+    
+    /**
+     * Record phase timings, thread busy/idle time and output bytes of
+     * subsequent runs into metrics (nullptr to stop)
+     */
+    void setMetrics(RunMetrics* metrics) { metrics_ = metrics; }
+    
+    /**
+     * Log the peak footprint of the buffer arena of the runs so far, and
+     * record it in the metrics
+     */
+    void reportBuffers() const;
+    
     /**
      * Process a DEM file and stream binary data to stdout
-     * Format: [int32 day][int32 count][int16 sunrise_array][int16 sunset_array]
+     * Format: [int32 day][int16 sunrise_array][int16 sunset_array] per day
+     * 
+     * With ProcessingOptions::maxMemoryBytes set, the DEM is processed in
+     * strips aligned to its block layout; the stream is unchanged.
      */
     bool streamBinaryOutput(const std::string& inputPath,
                            int year,
                            double timezoneOffset = 1.0);
-
+    
+    /**
+     * Stream several periods (years or date ranges) from one DEM load
+     * 
+     * Each period is written as a complete stream (header and days),
+     * back to back on stdout.
+     */
+    bool streamBinaryOutput(const std::string& inputPath,
+                           const std::vector<SolarEphemeris>& periods,
+                           double timezoneOffset = 1.0);
+    
+    /**
+     * Process a DEM file and write the results to a Parquet file
+     * 
+     * Layout, compression and row group size come from ProcessingOptions.
+     * @return true if successful, false otherwise
+     */
+    bool writeParquet(const std::string& inputPath,
+                      const std::string& outputPath,
+                      int year,
+                      double timezoneOffset = 1.0);
+    
+    /**
+     * Write one Parquet file per period from one DEM load
+     * @param outputPaths One path per period
+     */
+    bool writeParquet(const std::string& inputPath,
+                      const std::vector<std::string>& outputPaths,
+                      const std::vector<SolarEphemeris>& periods,
+                      double timezoneOffset = 1.0);
+    
+    /**
+     * Write one memory-mappable result cube per period (see ResultCube)
+     * 
+     * The DEM is computed in strips of rows and batches of days, which are
+     * transposed into the pixel-major cube.
+     * @param outputPaths One path per period
+     */
+    bool writeCube(const std::string& inputPath,
+                   const std::vector<std::string>& outputPaths,
+                   const std::vector<SolarEphemeris>& periods,
+                   double timezoneOffset = 1.0);
+    
     /**
      * Process a DEM file to calculate solar times for the full year
      * @param inputPath Path to input DEM GeoTIFF
@@ -40,18 +114,99 @@ public:
      * @param year Year for calculation
      * @param timezoneOffset Timezone offset from UTC (default: 1.0 for CET)
      * @return true if successful, false otherwise
+     * 
+     * Each output records the CRC-32 of every 512x512 DEM block. With
+     * ProcessingOptions::incrementalUpdate the existing outputs are opened
+     * instead of created, and only the blocks whose DEM changed since are
+     * recomputed and rewritten.
      */
     bool processDEM(const std::string& inputPath,
                    const std::string& outputPath,
                    int year,
                    double timezoneOffset = 1.0);
+    
+    /**
+     * Write one GeoTIFF per period (Year or date range, two bands per day)
+     * 
+     * The DEM, per-block tables and horizon are shared by all periods.
+     * @param outputPaths One path per period
+     */
+    bool processDEM(const std::string& inputPath,
+                   const std::vector<std::string>& outputPaths,
+                   const std::vector<SolarEphemeris>& periods,
+                   double timezoneOffset = 1.0);
+    
+    /**
+     * Keep a DEM resident and answer point/date requests (see SolarService)
+     * 
+     * Requests are read from stdin and answered on stdout, or from the
+     * clients of a Unix socket. Only the days asked for are computed.
+     * @param socketPath Unix socket to listen on, empty for stdin/stdout
+     * @return false if the DEM cannot be loaded; otherwise runs until the
+     *         end of stdin (socket mode only returns on error)
+     */
+    bool serve(const std::string& inputPath,
+               double timezoneOffset = 1.0,
+               const std::string& socketPath = std::string());
+    
+    /**
+     * Process all DEMs of a job manifest in this process
+     * 
+     * GDAL and the OpenMP runtime are initialised once. Jobs run largest
+     * DEM first, ProcessingOptions::jobsInFlight at a time, and all of
+     * them draw their block threads from one shared ThreadBudget: when a
+     * small job finishes, its threads go to the blocks of the jobs still
+     * running. A failed job does not stop the others.
+     * @return true if every job succeeded
+     */
+    bool processJobs(const std::vector<DemJob>& jobs);
+    
+    /**
+     * Compare the float and double kernels on a DEM for a full year
+     * 
+     * Reports the maximum and a histogram of per-pixel differences in
+     * minutes, plus pixels classified differently (valid vs polar).
+     * @return true if all differences are within one minute
+     */
+    bool validatePrecision(const std::string& inputPath,
+                           int year,
+                           double timezoneOffset = 1.0);
 
 private:
     int numThreads_;
     SolarCalculator solarCalc_;
+    ProcessingOptions options_;
+    
+    // Threads shared by concurrent jobs (processJobs only)
+    ThreadBudget* threadBudget_ = nullptr;
+    
+    RunMetrics* metrics_ = nullptr;
+    
+    // Large buffers of every run of this processor, reused across runs and jobs
+    mutable BufferArena arena_;
     
     static constexpr float NODATA_VALUE = -9999.0f;
     
+    /**
+     * DEM raster loaded in memory
+     */
+    struct DemRaster {
+        int width = 0;
+        int height = 0;
+        double geoTransform[6];
+        std::string projection;
+        float nodata = 0.0f;
+        std::vector<float> data;
+    };
+    
+    /**
+     * Read the first band of a DEM into memory
+     * 
+     * With numRows > 0 only rows [row0, row0 + numRows) are read and the
+     * geotransform is shifted to the first of them.
+     */
+    bool readDem(const std::string& inputPath, DemRaster& dem, int row0 = 0, int numRows = 0) const;
+    
     /**
      * Convert pixel coordinates to geographic coordinates
      * @param geoTransform GDAL geotransform array
@@ -64,13 +219,52 @@ private:
                    double& lon, double& lat) const;
     
     /**
-     * Create output dataset with proper metadata
+     * Per-pixel (non-separable) solver for the rows indexed by spans, from row0
+     * @param demData DEM values of those rows
+     * @param spans Valid pixels of those rows; masked pixels are set to -1
+     * @param horizon Terrain horizon of the whole raster, or nullptr
+     * @param packed Write only the valid pixels, in raster order (sparse output)
+     */
+    void computePixelRows(const double* geoTransform, const float* demData,
+                          const ValidSpans& spans, int width, int row0,
+                          const SolarCalculator& calc, const DayEphemeris& eph,
+                          int16_t* sunrise, int16_t* sunset,
+                          const HorizonMap* horizon = nullptr, bool packed = false) const;
+    
+    /**
+     * Terrain horizon of a DEM held in memory (ProcessingOptions::horizonSectors
+     * sectors), mapped from the cache file next to the DEM when it matches,
+     * otherwise computed and cached
+     * @param inputPath DEM path, used to name the cache file
+     * @param cacheTag Suffix of the cache name for partial DEMs (row windows)
+     */
+    void computeHorizon(const std::string& inputPath, const float* demData, int width, int height,
+                        const double* geoTransform, const std::string& projection,
+                        float demNodata, HorizonMap& horizon,
+                        const std::string& cacheTag = std::string()) const;
+    
+    /**
+     * Create output dataset with proper metadata (two bands per day of the period)
      */
     GDALDataset* createOutputDataset(const std::string& outputPath,
                                      int width, int height,
-                                     int numBands,
+                                     const SolarEphemeris& period,
                                      const double* geoTransform,
                                      const char* projection) const;
+    
+    /**
+     * Open an output written by a previous run for incremental update
+     * 
+     * The dataset must have the expected size and band count and the
+     * parameters recorded by that run (PARAMETERS in the SUNCAST metadata
+     * domain); blockCrcs receives its per-block DEM checksums.
+     * @return Dataset opened for update, or nullptr
+     */
+    GDALDataset* openOutputDataset(const std::string& outputPath,
+                                   int width, int height, int numBands,
+                                   const std::string& parameters,
+                                   size_t numBlocks,
+                                   std::vector<uint32_t>& blockCrcs) const;
 };
 
 #endif // PROCESS_DEM_H
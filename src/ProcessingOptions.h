@@ -0,0 +1,137 @@
+#ifndef PROCESSING_OPTIONS_H
+#define PROCESSING_OPTIONS_H
+
+#include <cstddef>
+#include "StreamFormat.h"
+
+/**
+ * Floating-point precision of the per-pixel kernels
+ */
+enum class Precision {
+    Double,   // Reference precision
+    Float     // Twice the SIMD width, validated to +/-1 minute
+};
+
+/**
+ * Sample type of GeoTIFF output
+ */
+enum class OutputType {
+    Float32,  // Decimal hours
+    Int16     // Minutes after local midnight, as in the binary stream
+};
+
+/**
+ * GeoTIFF band interleave
+ */
+enum class Interleave {
+    Band,     // One plane per band
+    Pixel     // All bands of a pixel contiguous (GDAL default)
+};
+
+/**
+ * Device running the per-pixel kernel of --stream
+ */
+enum class ComputeDevice {
+    Cpu,
+    Gpu       // CUDA backend (GpuSolver), builds with SOLAR_WITH_CUDA
+};
+
+/**
+ * Huge page backing of the large buffers (BufferArena)
+ */
+enum class HugePages {
+    Off,
+    Transparent,   // madvise(MADV_HUGEPAGE), 2 MB aligned
+    Explicit       // MAP_HUGETLB from the vm.nr_hugepages pool, else transparent
+};
+
+/**
+ * Row layout of --parquet output
+ */
+enum class ParquetLayout {
+    Wide,   // One row per day with list<int16> sunrise/sunset columns
+    Flat    // One row per (pixel_id, day)
+};
+
+/**
+ * Column compression of --parquet output
+ */
+enum class ParquetCompression {
+    None,
+    Snappy,
+    Zstd,
+    LZ4
+};
+
+/**
+ * Tuning options shared by the DemProcessor output modes
+ * 
+ * Defaults reproduce the reference behaviour.
+ */
+struct ProcessingOptions {
+    Precision precision = Precision::Double;
+    ComputeDevice device = ComputeDevice::Cpu;
+    
+    // Memory budget for DEM and per-pixel/per-block buffers in bytes (0 = unlimited)
+    size_t maxMemoryBytes = 0;
+    
+    // Huge pages for DEM, table and output block buffers
+    HugePages hugePages = HugePages::Off;
+    
+    // Stream frames rotating between compute and the writer thread (1 = no overlap)
+    int pipelineDepth = 2;
+    
+    // Terrain horizon azimuth sectors (0 = sea-level horizon only)
+    int horizonSectors = 0;
+    
+    // Reuse horizons from a cache file next to the DEM (see HorizonMap)
+    bool horizonCache = true;
+    
+    // GeoTIFF sample type and interleave
+    OutputType outputType = OutputType::Float32;
+    Interleave interleave = Interleave::Pixel;
+    
+    // GeoTIFF blocks computed concurrently by processDEM (0 = auto, bounded by maxMemoryBytes)
+    int blocksInFlight = 0;
+    
+    // DEMs of a --jobs manifest processed concurrently (0 = auto)
+    int jobsInFlight = 0;
+    
+    // processDEM: update existing GeoTIFF outputs in place, recomputing only
+    // the blocks whose DEM checksum changed (plus horizonHalo around them)
+    bool incrementalUpdate = false;
+    
+    // processDEM row window [rowBegin, rowBegin + rowCount), 0 rows = whole DEM;
+    // the GeoTIFF then covers only the window (one strip per MPI rank)
+    int rowBegin = 0;
+    int rowCount = 0;
+    
+    // Row window: terrain within this distance in metres of the window shapes
+    // its horizon (0 = whole DEM). Incremental update: distance around the
+    // changed blocks whose horizon, hence output, is recomputed
+    double horizonHalo = 0.0;
+    
+    // Stream layout; v2 adds a self-describing header and checksummed chunks
+    StreamFormat streamFormat = StreamFormat::V1;
+    StreamCompression compression = StreamCompression::None;
+    int compressionLevel = 3;
+    
+    // v2 only: chunk value encoding (delta and varint relative to the previous day)
+    StreamEncoding streamEncoding = StreamEncoding::Raw;
+    
+    // v2 only: unit of the stream values in seconds (60, 30 or 10)
+    int timeResolutionSeconds = 60;
+    
+    // --serve: memory of the LRU cache of computed tiles
+    size_t serviceCacheBytes = 256ull * 1024 * 1024;
+    
+    // v2 stream and Parquet: write only valid pixels, with the mask RLE in the header
+    bool sparseOutput = false;
+    
+    // Parquet output; row group size in days (wide) or rows (flat), 0 = layout default
+    ParquetLayout parquetLayout = ParquetLayout::Wide;
+    ParquetCompression parquetCompression = ParquetCompression::Snappy;
+    long long parquetRowGroupSize = 0;
+};
+
+#endif // PROCESSING_OPTIONS_H
@@ -0,0 +1,221 @@
+#include "ResultCube.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char CUBE_MAGIC[8] = {'S', 'C', 'R', 'E', 'S', 'U', 'L', 'T'};
+const uint32_t CUBE_VERSION = 1;
+const size_t CUBE_HEADER_BYTES = 128;
+
+struct CubeHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    int32_t numDays;
+    int32_t firstYear;
+    int32_t firstMonth;
+    int32_t firstDay;
+    int32_t reserved;
+    double geoTransform[6];
+    double timezoneOffset;
+};
+
+static_assert(sizeof(CubeHeader) <= CUBE_HEADER_BYTES, "cube header does not fit");
+
+// Days since 1970-01-01 of a proleptic Gregorian date, and back
+long daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    long era = (year >= 0 ? year : year - 399) / 400;
+    long yearOfEra = year - era * 400;
+    long dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+CalendarDate civilFromDays(long days) {
+    days += 719468;
+    long era = (days >= 0 ? days : days - 146096) / 146097;
+    long dayOfEra = days - era * 146097;
+    long yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    long dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    long monthIndex = (5 * dayOfYear + 2) / 153;
+    CalendarDate date;
+    date.day = static_cast<int>(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+    date.month = static_cast<int>(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+    date.year = static_cast<int>(yearOfEra + era * 400 + (date.month <= 2));
+    return date;
+}
+
+} // namespace
+
+ResultCube::ResultCube()
+    : width_(0), height_(0), numDays_(0), firstDate_{0, 0, 0}, geoTransform_{0, 1, 0, 0, 0, -1},
+      timezoneOffset_(0.0), mapping_(nullptr), mappingBytes_(0), data_(nullptr), writable_(false) {
+}
+
+ResultCube::~ResultCube() {
+    unmap();
+}
+
+void ResultCube::unmap() {
+    if (mapping_) {
+        munmap(mapping_, mappingBytes_);
+        mapping_ = nullptr;
+        mappingBytes_ = 0;
+        data_ = nullptr;
+    }
+}
+
+void ResultCube::close() {
+    unmap();
+    writable_ = false;
+}
+
+bool ResultCube::create(const std::string& path, int width, int height, const SolarEphemeris& period,
+                        const double* geoTransform, double timezoneOffset) {
+    close();
+    path_ = path;
+    width_ = width;
+    height_ = height;
+    numDays_ = period.numDays();
+    firstDate_ = CalendarDate{period[0].year, period[0].month, period[0].day};
+    std::memcpy(geoTransform_, geoTransform, sizeof(geoTransform_));
+    timezoneOffset_ = timezoneOffset;
+    
+    size_t bytes = CUBE_HEADER_BYTES + static_cast<size_t>(width) * height * numDays_ * 2 * sizeof(int16_t);
+    std::string tempPath = path + ".tmp";
+    int fd = ::open(tempPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: Failed to create result cube " << tempPath << std::endl;
+        return false;
+    }
+    
+    // The header stays zero (no magic) until finish()
+    void* mapping = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(bytes)) == 0) {
+        mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Error: Failed to allocate result cube " << tempPath << " ("
+                  << bytes / (1024 * 1024) << " MB)" << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    
+    mapping_ = mapping;
+    mappingBytes_ = bytes;
+    data_ = reinterpret_cast<int16_t*>(static_cast<char*>(mapping) + CUBE_HEADER_BYTES);
+    writable_ = true;
+    return true;
+}
+
+bool ResultCube::finish() {
+    if (!mapping_ || !writable_) {
+        return false;
+    }
+    
+    CubeHeader header = {};
+    std::memcpy(header.magic, CUBE_MAGIC, sizeof(CUBE_MAGIC));
+    header.version = CUBE_VERSION;
+    header.width = width_;
+    header.height = height_;
+    header.numDays = numDays_;
+    header.firstYear = firstDate_.year;
+    header.firstMonth = firstDate_.month;
+    header.firstDay = firstDate_.day;
+    std::memcpy(header.geoTransform, geoTransform_, sizeof(geoTransform_));
+    header.timezoneOffset = timezoneOffset_;
+    
+    // Data first, then the header that makes the file valid
+    std::string tempPath = path_ + ".tmp";
+    bool written = msync(mapping_, mappingBytes_, MS_SYNC) == 0;
+    std::memcpy(mapping_, &header, sizeof(header));
+    written = written && msync(mapping_, CUBE_HEADER_BYTES, MS_SYNC) == 0;
+    close();
+    
+    if (!written || std::rename(tempPath.c_str(), path_.c_str()) != 0) {
+        std::cerr << "Error: Failed to write result cube " << path_ << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ResultCube::open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: Failed to open result cube " << path << std::endl;
+        return false;
+    }
+    
+    struct stat info;
+    CubeHeader header;
+    bool valid = fstat(fd, &info) == 0 &&
+                 pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+                 std::memcmp(header.magic, CUBE_MAGIC, sizeof(CUBE_MAGIC)) == 0 &&
+                 header.version == CUBE_VERSION && header.width > 0 && header.height > 0 &&
+                 header.numDays > 0 &&
+                 static_cast<size_t>(info.st_size) ==
+                     CUBE_HEADER_BYTES + static_cast<size_t>(header.width) * header.height *
+                                             header.numDays * 2 * sizeof(int16_t);
+    void* mapping = valid ? mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (!valid || mapping == MAP_FAILED) {
+        std::cerr << "Error: " << path << " is not a complete result cube" << std::endl;
+        return false;
+    }
+    
+    // Queries touch a few pages each; readahead would only evict others
+    madvise(mapping, info.st_size, MADV_RANDOM);
+    
+    path_ = path;
+    width_ = header.width;
+    height_ = header.height;
+    numDays_ = header.numDays;
+    firstDate_ = CalendarDate{header.firstYear, header.firstMonth, header.firstDay};
+    std::memcpy(geoTransform_, header.geoTransform, sizeof(geoTransform_));
+    timezoneOffset_ = header.timezoneOffset;
+    mapping_ = mapping;
+    mappingBytes_ = info.st_size;
+    data_ = reinterpret_cast<int16_t*>(static_cast<char*>(mapping) + CUBE_HEADER_BYTES);
+    return true;
+}
+
+bool ResultCube::pixelAt(double lon, double lat, int& row, int& column) const {
+    // Inverse of the geotransform, rotation terms included
+    const double* gt = geoTransform_;
+    double det = gt[1] * gt[5] - gt[2] * gt[4];
+    if (det == 0.0) {
+        return false;
+    }
+    double dx = lon - gt[0];
+    double dy = lat - gt[3];
+    double x = (gt[5] * dx - gt[2] * dy) / det;
+    double y = (gt[1] * dy - gt[4] * dx) / det;
+    if (!(x >= 0.0 && y >= 0.0 && x < width_ && y < height_)) {
+        return false;
+    }
+    column = static_cast<int>(std::floor(x));
+    row = static_cast<int>(std::floor(y));
+    return true;
+}
+
+int ResultCube::dayIndex(const CalendarDate& date) const {
+    long index = daysFromCivil(date.year, date.month, date.day) -
+                 daysFromCivil(firstDate_.year, firstDate_.month, firstDate_.day);
+    return index >= 0 && index < numDays_ ? static_cast<int>(index) : -1;
+}
+
+CalendarDate ResultCube::date(int dayIndex) const {
+    return civilFromDays(daysFromCivil(firstDate_.year, firstDate_.month, firstDate_.day) + dayIndex);
+}
@@ -0,0 +1,108 @@
+#ifndef RESULT_CUBE_H
+#define RESULT_CUBE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "SolarEphemeris.h"
+
+/**
+ * ResultCube class
+ * 
+ * Sunrise/sunset times of every pixel for every day of a period, stored
+ * pixel-major so that the series of one pixel is contiguous and a point
+ * query is a single lookup in the memory-mapped file:
+ * 
+ *   magic[8] "SCRESULT", uint32 version, int32 width, height, numDays,
+ *   int32 firstYear, firstMonth, firstDay, int32 reserved,
+ *   float64 geoTransform[6], float64 timezoneOffset, padding to 128 bytes,
+ *   int16 minutes[height][width][numDays][2]   (sunrise, sunset)
+ * 
+ * Values are minutes after local midnight as in the binary stream; -1
+ * marks masked pixels and days without sunrise or sunset. Little-endian.
+ * The magic is written last, so an interrupted run leaves a file that
+ * open() rejects.
+ */
+class ResultCube {
+public:
+    static constexpr int16_t NO_EVENT = -1;
+    
+    ResultCube();
+    ~ResultCube();
+    
+    ResultCube(const ResultCube&) = delete;
+    ResultCube& operator=(const ResultCube&) = delete;
+    
+    /**
+     * Create a cube for writing, mapped read-write (path.tmp until finish())
+     * @param geoTransform GDAL geotransform of the DEM
+     */
+    bool create(const std::string& path, int width, int height, const SolarEphemeris& period,
+                const double* geoTransform, double timezoneOffset);
+    
+    /**
+     * Write the header and move the file to its final path
+     */
+    bool finish();
+    
+    /**
+     * Map an existing cube read-only
+     */
+    bool open(const std::string& path);
+    
+    void close();
+    
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int numDays() const { return numDays_; }
+    const double* geoTransform() const { return geoTransform_; }
+    double timezoneOffset() const { return timezoneOffset_; }
+    
+    /**
+     * Series of one pixel: numDays (sunrise, sunset) pairs
+     */
+    const int16_t* series(int row, int column) const {
+        return data_ + (static_cast<size_t>(row) * width_ + column) * numDays_ * 2;
+    }
+    
+    /**
+     * Writable series of pixel index row * width + column (create() only)
+     */
+    int16_t* pixelSeries(size_t index) { return data_ + index * numDays_ * 2; }
+    
+    /**
+     * Pixel containing a point given in the coordinates of the geotransform
+     * (longitude and latitude for the department DEMs)
+     * @return false if the point is outside the raster
+     */
+    bool pixelAt(double lon, double lat, int& row, int& column) const;
+    
+    /**
+     * Index of a date in the cube, or -1 if it is outside the period
+     */
+    int dayIndex(const CalendarDate& date) const;
+    
+    /**
+     * Date of an index of the cube
+     */
+    CalendarDate date(int dayIndex) const;
+
+private:
+    std::string path_;
+    int width_;
+    int height_;
+    int numDays_;
+    CalendarDate firstDate_;
+    double geoTransform_[6];
+    double timezoneOffset_;
+    
+    // Memory-mapped file; data_ points past the header
+    void* mapping_;
+    size_t mappingBytes_;
+    int16_t* data_;
+    bool writable_;
+    
+    void unmap();
+};
+
+#endif // RESULT_CUBE_H
@@ -0,0 +1,246 @@
+#include "RunMetrics.h"
+#include "NumaPlacement.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+
+const char* PHASE_NAMES[] = {"dem_read", "io_lock_wait", "horizon", "compute",
+                             "encode", "write", "frame_wait", "pipe_blocked"};
+
+// Thread slots handed out so far, for all RunMetrics instances
+std::atomic<int> nextThreadSlot{0};
+
+uint64_t toNs(double seconds) {
+    return seconds > 0.0 ? static_cast<uint64_t>(seconds * 1e9) : 0;
+}
+
+double toSeconds(const std::atomic<uint64_t>& ns) {
+    return ns.load(std::memory_order_relaxed) * 1e-9;
+}
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() &&
+           text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+RunMetrics::RunMetrics() : start_(now()), threads_(new ThreadSlot[MAX_THREADS]) {
+    for (std::atomic<uint64_t>& phase : phaseNs_) {
+        phase.store(0, std::memory_order_relaxed);
+    }
+}
+
+RunMetrics::~RunMetrics() {
+    stopSnapshots();
+}
+
+double RunMetrics::now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int RunMetrics::threadSlot() {
+    thread_local int slot = nextThreadSlot.fetch_add(1);
+    return slot < MAX_THREADS ? slot : -1;
+}
+
+void RunMetrics::addTime(MetricPhase phase, double seconds) {
+    phaseNs_[static_cast<int>(phase)].fetch_add(toNs(seconds), std::memory_order_relaxed);
+}
+
+void RunMetrics::addBytes(uint64_t bytes) {
+    bytes_.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void RunMetrics::addDays(int days) {
+    days_.fetch_add(days, std::memory_order_relaxed);
+}
+
+void RunMetrics::addBlocks(int blocks) {
+    blocks_.fetch_add(blocks, std::memory_order_relaxed);
+}
+
+void RunMetrics::recordBufferPeak(uint64_t bytes) {
+    uint64_t peak = bufferPeak_.load(std::memory_order_relaxed);
+    while (peak < bytes && !bufferPeak_.compare_exchange_weak(peak, bytes, std::memory_order_relaxed)) {
+    }
+}
+
+void RunMetrics::addThreadTime(int slot, double busySeconds, double idleSeconds) {
+    if (slot < 0) {
+        return;
+    }
+    threads_[slot].busyNs.fetch_add(toNs(busySeconds), std::memory_order_relaxed);
+    threads_[slot].idleNs.fetch_add(toNs(idleSeconds), std::memory_order_relaxed);
+}
+
+RunMetrics::RegionTimer::RegionTimer(RunMetrics* metrics, int maxTeamSize)
+    : metrics_(metrics), start_(0.0) {
+    if (metrics_) {
+#ifdef _OPENMP
+        if (maxTeamSize <= 0) maxTeamSize = omp_get_max_threads();
+#endif
+        maxTeamSize = std::max(maxTeamSize, 1);
+        busy_.assign(maxTeamSize, -1.0);
+        slots_.assign(maxTeamSize, -1);
+        start_ = now();
+    }
+}
+
+void RunMetrics::RegionTimer::threadDone() {
+#ifdef _OPENMP
+    int thread = omp_get_thread_num();
+#else
+    int thread = 0;
+#endif
+    if (!metrics_ || thread >= static_cast<int>(busy_.size())) {
+        return;
+    }
+    busy_[thread] = now() - start_;
+    slots_[thread] = threadSlot();
+}
+
+RunMetrics::RegionTimer::~RegionTimer() {
+    if (!metrics_) {
+        return;
+    }
+    double elapsed = now() - start_;
+    for (size_t t = 0; t < busy_.size(); ++t) {
+        if (busy_[t] >= 0.0) {
+            metrics_->addThreadTime(slots_[t], busy_[t], elapsed - busy_[t]);
+        }
+    }
+}
+
+std::string RunMetrics::toJson(bool final) const {
+    std::ostringstream out;
+    out.precision(9);
+    out << "{\n";
+    out << "  \"final\": " << (final ? "true" : "false") << ",\n";
+    out << "  \"elapsed_seconds\": " << now() - start_ << ",\n";
+    out << "  \"days_completed\": " << days_.load(std::memory_order_relaxed) << ",\n";
+    out << "  \"blocks_completed\": " << blocks_.load(std::memory_order_relaxed) << ",\n";
+    out << "  \"bytes_written\": " << bytes_.load(std::memory_order_relaxed) << ",\n";
+    out << "  \"buffer_peak_bytes\": " << bufferPeak_.load(std::memory_order_relaxed) << ",\n";
+    out << "  \"phase_seconds\": {";
+    for (int p = 0; p < static_cast<int>(MetricPhase::Count); ++p) {
+        out << (p ? ", " : "") << "\"" << PHASE_NAMES[p] << "\": " << toSeconds(phaseNs_[p]);
+    }
+    out << "},\n";
+    
+    // Only threads that took part in an instrumented region
+    out << "  \"threads\": [";
+    int numSlots = std::min(nextThreadSlot.load(), MAX_THREADS);
+    bool first = true;
+    for (int t = 0; t < numSlots; ++t) {
+        double busy = toSeconds(threads_[t].busyNs);
+        double idle = toSeconds(threads_[t].idleNs);
+        if (busy == 0.0 && idle == 0.0) {
+            continue;
+        }
+        out << (first ? "\n" : ",\n") << "    {\"thread\": " << t << ", \"busy_seconds\": " << busy
+            << ", \"idle_seconds\": " << idle << "}";
+        first = false;
+    }
+    out << (first ? "]\n" : "\n  ]\n");
+    out << "}\n";
+    return out.str();
+}
+
+std::string RunMetrics::toPrometheus() const {
+    std::ostringstream out;
+    out.precision(9);
+    out << "# HELP suncast_elapsed_seconds Time since the start of the run\n"
+        << "# TYPE suncast_elapsed_seconds gauge\n"
+        << "suncast_elapsed_seconds " << now() - start_ << "\n";
+    out << "# HELP suncast_days_completed_total Days computed (stream and Parquet outputs)\n"
+        << "# TYPE suncast_days_completed_total counter\n"
+        << "suncast_days_completed_total " << days_.load(std::memory_order_relaxed) << "\n";
+    out << "# HELP suncast_blocks_completed_total Blocks computed (GeoTIFF output)\n"
+        << "# TYPE suncast_blocks_completed_total counter\n"
+        << "suncast_blocks_completed_total " << blocks_.load(std::memory_order_relaxed) << "\n";
+    out << "# HELP suncast_bytes_written_total Bytes handed to the output\n"
+        << "# TYPE suncast_bytes_written_total counter\n"
+        << "suncast_bytes_written_total " << bytes_.load(std::memory_order_relaxed) << "\n";
+    out << "# HELP suncast_buffer_peak_bytes Peak memory of the DEM, table and output buffers\n"
+        << "# TYPE suncast_buffer_peak_bytes gauge\n"
+        << "suncast_buffer_peak_bytes " << bufferPeak_.load(std::memory_order_relaxed) << "\n";
+    
+    out << "# HELP suncast_phase_seconds_total Time per phase, summed over threads\n"
+        << "# TYPE suncast_phase_seconds_total counter\n";
+    for (int p = 0; p < static_cast<int>(MetricPhase::Count); ++p) {
+        out << "suncast_phase_seconds_total{phase=\"" << PHASE_NAMES[p] << "\"} "
+            << toSeconds(phaseNs_[p]) << "\n";
+    }
+    
+    out << "# HELP suncast_thread_busy_seconds_total Work time of each thread in the compute regions\n"
+        << "# TYPE suncast_thread_busy_seconds_total counter\n";
+    std::ostringstream idle;
+    idle.precision(9);
+    idle << "# HELP suncast_thread_idle_seconds_total Wait time of each thread at the end of the compute regions\n"
+         << "# TYPE suncast_thread_idle_seconds_total counter\n";
+    int numSlots = std::min(nextThreadSlot.load(), MAX_THREADS);
+    for (int t = 0; t < numSlots; ++t) {
+        double busy = toSeconds(threads_[t].busyNs);
+        double wait = toSeconds(threads_[t].idleNs);
+        if (busy == 0.0 && wait == 0.0) {
+            continue;
+        }
+        out << "suncast_thread_busy_seconds_total{thread=\"" << t << "\"} " << busy << "\n";
+        idle << "suncast_thread_idle_seconds_total{thread=\"" << t << "\"} " << wait << "\n";
+    }
+    out << idle.str();
+    return out.str();
+}
+
+bool RunMetrics::write(const std::string& path, bool final) const {
+    bool prometheus = endsWith(path, ".prom") || endsWith(path, ".txt");
+    std::string text = prometheus ? toPrometheus() : toJson(final);
+    
+    // Readers never see a partially written file
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::trunc);
+        if (!file || !(file << text) || !file.flush()) {
+            std::cerr << "Error: Failed to write metrics to " << tmpPath << std::endl;
+            return false;
+        }
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Error: Failed to write metrics to " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void RunMetrics::startSnapshots(const std::string& path, double intervalSeconds) {
+    stopSnapshots();
+    stopping_ = false;
+    NumaPlacement::ProcessMask processMask;
+    snapshotThread_ = std::thread([this, path, intervalSeconds]() {
+        std::unique_lock<std::mutex> lock(snapshotMutex_);
+        auto interval = std::chrono::duration<double>(intervalSeconds);
+        while (!snapshotWake_.wait_for(lock, interval, [this] { return stopping_; })) {
+            write(path, false);
+        }
+    });
+}
+
+void RunMetrics::stopSnapshots() {
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex_);
+        stopping_ = true;
+    }
+    snapshotWake_.notify_all();
+    if (snapshotThread_.joinable()) {
+        snapshotThread_.join();
+    }
+}
@@ -0,0 +1,168 @@
+#ifndef RUN_METRICS_H
+#define RUN_METRICS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Phases timed by RunMetrics
+ * 
+ * Times are summed over the threads that run a phase, so with several
+ * blocks in flight a phase may exceed the elapsed time.
+ */
+enum class MetricPhase {
+    DemRead,      // DEM reads
+    IoLockWait,   // GeoTIFF blocks waiting for their dataset's GDAL I/O lock
+    Horizon,      // Terrain horizon computation or cache load
+    Compute,      // Tables and sunrise/sunset computation
+    Encode,       // v2 stream chunk encoding and compression
+    Write,        // Output writes (GeoTIFF, Parquet, stream writev)
+    FrameWait,    // Compute waiting for a free stream frame (writer behind)
+    PipeBlocked,  // Stream writer waiting for room in a full pipe
+    Count
+};
+
+/**
+ * RunMetrics class
+ * 
+ * Lightweight run instrumentation: per-phase timers, per-thread busy and
+ * idle time in the OpenMP compute regions, bytes handed to the output and
+ * progress counters. All counters are relaxed atomics, so they can be
+ * updated from any thread and read by the snapshot thread meanwhile.
+ * 
+ * The summary is written as Prometheus text when the path ends in .prom
+ * or .txt, as JSON otherwise. Instrumented code takes a RunMetrics
+ * pointer and does nothing when it is null.
+ */
+class RunMetrics {
+public:
+    RunMetrics();
+    ~RunMetrics();
+    
+    RunMetrics(const RunMetrics&) = delete;
+    RunMetrics& operator=(const RunMetrics&) = delete;
+    
+    void addTime(MetricPhase phase, double seconds);
+    
+    /**
+     * Count output bytes (uncompressed samples for GeoTIFF and Parquet)
+     */
+    void addBytes(uint64_t bytes);
+    
+    /**
+     * Count completed days (stream, Parquet) or blocks (GeoTIFF)
+     */
+    void addDays(int days);
+    void addBlocks(int blocks);
+    
+    /**
+     * Peak bytes of the buffer arena (the highest value recorded is kept)
+     */
+    void recordBufferPeak(uint64_t bytes);
+    
+    /**
+     * Write the current values to path (written to path.tmp, then renamed)
+     * @param final False for the periodic snapshots
+     */
+    bool write(const std::string& path, bool final = true) const;
+    
+    /**
+     * Rewrite path every intervalSeconds from a background thread until
+     * stopSnapshots (or destruction)
+     */
+    void startSnapshots(const std::string& path, double intervalSeconds);
+    void stopSnapshots();
+    
+    /**
+     * Monotonic time in seconds
+     */
+    static double now();
+    
+    /**
+     * Adds the lifetime of the timer to a phase
+     */
+    class Timer {
+    public:
+        Timer(RunMetrics* metrics, MetricPhase phase)
+            : metrics_(metrics), phase_(phase), start_(metrics ? now() : 0.0) {}
+        ~Timer() {
+            if (metrics_) metrics_->addTime(phase_, now() - start_);
+        }
+        
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+    
+    private:
+        RunMetrics* metrics_;
+        MetricPhase phase_;
+        double start_;
+    };
+    
+    /**
+     * Busy and idle time of the threads of one OpenMP parallel region
+     * 
+     * Create it just before the region; each thread calls threadDone()
+     * when its share of the work is done (after nowait loops). The time
+     * until the region has ended, when the timer is destroyed, is idle.
+     * @param maxTeamSize Threads of the region (0: omp_get_max_threads())
+     */
+    class RegionTimer {
+    public:
+        explicit RegionTimer(RunMetrics* metrics, int maxTeamSize = 0);
+        ~RegionTimer();
+        
+        RegionTimer(const RegionTimer&) = delete;
+        RegionTimer& operator=(const RegionTimer&) = delete;
+        
+        void threadDone();
+    
+    private:
+        RunMetrics* metrics_;
+        double start_;
+        std::vector<double> busy_;   // Per team thread, < 0 if not joined
+        std::vector<int> slots_;     // Per team thread, RunMetrics thread slot
+    };
+
+private:
+    static constexpr int MAX_THREADS = 1024;
+    
+    /**
+     * Per OS thread counters, padded against false sharing
+     */
+    struct alignas(64) ThreadSlot {
+        std::atomic<uint64_t> busyNs{0};
+        std::atomic<uint64_t> idleNs{0};
+    };
+    
+    double start_;
+    std::atomic<uint64_t> phaseNs_[static_cast<int>(MetricPhase::Count)];
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> days_{0};
+    std::atomic<uint64_t> blocks_{0};
+    std::atomic<uint64_t> bufferPeak_{0};
+    std::unique_ptr<ThreadSlot[]> threads_;
+    
+    // Snapshot thread
+    std::thread snapshotThread_;
+    std::mutex snapshotMutex_;
+    std::condition_variable snapshotWake_;
+    bool stopping_ = false;
+    
+    /**
+     * Slot of the calling thread, assigned on first use (-1 past MAX_THREADS)
+     */
+    static int threadSlot();
+    
+    void addThreadTime(int slot, double busySeconds, double idleSeconds);
+    
+    std::string toJson(bool final) const;
+    std::string toPrometheus() const;
+};
+
+#endif // RUN_METRICS_H
@@ -1,4 +1,8 @@
 #include "SolarCalculator.h"
+#include "CalendarTables.h"
+#include "HorizonMap.h"
+#include "SolarKernels.h"
+#include <algorithm>
 #include <cmath>
 
 #ifndef M_PI
@@ -6,7 +10,11 @@
 #endif
 
 SolarCalculator::SolarCalculator(double timezoneOffset)
-    : timezoneOffset_(timezoneOffset) {}
+    : timezoneOffset_(timezoneOffset), unitsPerHour_(60.0) {}
+
+void SolarCalculator::setTimeResolution(int seconds) {
+    unitsPerHour_ = 3600.0 / seconds;
+}
 
 double SolarCalculator::calculateSunrise(double latitude, double longitude, double elevation,
                                         int year, int month, int day) const {
@@ -18,20 +26,41 @@ double SolarCalculator::calculateSunset(double latitude, double longitude, doubl
     return calculateSolarTime(latitude, longitude, elevation, year, month, day, false);
 }
 
-double SolarCalculator::julianDay(int year, int month, int day) const {
-    if (month <= 2) {
-        year -= 1;
-        month += 12;
-    }
+double SolarCalculator::calculateSunrise(const DayEphemeris& eph,
+                                        double latitude, double longitude, double elevation) const {
+    return calculateSolarTime(eph, latitude, longitude, elevation, true);
+}
+
+double SolarCalculator::calculateSunset(const DayEphemeris& eph,
+                                       double latitude, double longitude, double elevation) const {
+    return calculateSolarTime(eph, latitude, longitude, elevation, false);
+}
+
+DayEphemeris SolarCalculator::computeEphemeris(int year, int month, int day, int dayOfYear) const {
+    return computeEphemeris(julianDay(year, month, day), year, month, day, dayOfYear);
+}
+
+DayEphemeris SolarCalculator::computeEphemeris(double jd, int year, int month, int day, int dayOfYear) const {
+    double t = julianCentury(jd);
     
-    int A = year / 100;
-    int B = 2 - A + (A / 4);
+    DayEphemeris eph;
+    eph.year = year;
+    eph.dayOfYear = dayOfYear;
+    eph.month = month;
+    eph.day = day;
+    eph.eqTime = equationOfTime(t);
+    eph.declination = sunDeclination(t);
     
-    double JD = std::floor(365.25 * (year + 4716)) + 
-                std::floor(30.6001 * (month + 1)) + 
-                day + B - 1524.5;
+    double declRad = eph.declination * M_PI / 180.0;
+    eph.sinDecl = std::sin(declRad);
+    eph.cosDecl = std::cos(declRad);
+    eph.tanDecl = std::tan(declRad);
     
-    return JD;
+    return eph;
+}
+
+double SolarCalculator::julianDay(int year, int month, int day) const {
+    return Calendar::julianDay(year, month, day);
 }
 
 double SolarCalculator::julianCentury(double jd) const {
@@ -114,16 +143,19 @@ double SolarCalculator::equationOfTime(double t) const {
     return 4.0 * Etime * 180.0 / M_PI; // in minutes
 }
 
-double SolarCalculator::hourAngleSunrise(double latitude, double declination, double elevation) const {
-    double latRad = latitude * M_PI / 180.0;
-    double declRad = declination * M_PI / 180.0;
-    
+double SolarCalculator::zenithCosine(double elevation) {
     // Atmospheric refraction correction for elevation
     double elevationCorrection = -2.076 * std::sqrt(elevation) / 60.0;
     double zenith = 90.0 + SOLAR_DEPRESSION + elevationCorrection;
     
-    double cosHA = (std::cos(zenith * M_PI / 180.0) / (std::cos(latRad) * std::cos(declRad))) -
-                   std::tan(latRad) * std::tan(declRad);
+    return std::cos(zenith * M_PI / 180.0);
+}
+
+double SolarCalculator::hourAngleSunrise(double latitude, const DayEphemeris& eph, double elevation) const {
+    double latRad = latitude * M_PI / 180.0;
+    
+    double cosHA = (zenithCosine(elevation) / (std::cos(latRad) * eph.cosDecl)) -
+                   std::tan(latRad) * eph.tanDecl;
     
     if (cosHA > 1.0) {
         // Sun never rises
@@ -139,12 +171,13 @@ double SolarCalculator::hourAngleSunrise(double latitude, double declination, do
 
 double SolarCalculator::calculateSolarTime(double latitude, double longitude, double elevation,
                                           int year, int month, int day, bool isSunrise) const {
-    double jd = julianDay(year, month, day);
-    double t = julianCentury(jd);
-    
-    double eqTime = equationOfTime(t);
-    double declination = sunDeclination(t);
-    double ha = hourAngleSunrise(latitude, declination, elevation);
+    return calculateSolarTime(computeEphemeris(year, month, day), latitude, longitude,
+                              elevation, isSunrise);
+}
+
+double SolarCalculator::calculateSolarTime(const DayEphemeris& eph, double latitude, double longitude,
+                                          double elevation, bool isSunrise) const {
+    double ha = hourAngleSunrise(latitude, eph, elevation);
     
     if (ha < 0.0) {
         // Sun never rises or sets
@@ -152,7 +185,7 @@ double SolarCalculator::calculateSolarTime(double latitude, double longitude, do
     }
     
     // Calculate solar noon
-    double solarNoon = (720.0 - 4.0 * longitude - eqTime) / 60.0;
+    double solarNoon = (720.0 - 4.0 * longitude - eph.eqTime) / 60.0;
     
     // Calculate sunrise or sunset
     double solarTime;
@@ -162,6 +195,156 @@ double SolarCalculator::calculateSolarTime(double latitude, double longitude, do
         solarTime = solarNoon + ha * 4.0 / 60.0;
     }
     
+    return toLocalTime(solarTime);
+}
+
+DayEvents SolarCalculator::calculateDayEvents(const DayEphemeris& eph,
+                                             double latitude, double longitude,
+                                             double elevation) const {
+    DayEvents events;
+    double ha = hourAngleSunrise(latitude, eph, elevation);
+    
+    if (ha < 0.0) {
+        // -1.0: sun never rises, -2.0: sun never sets
+        events.sunrise = -9999.0;
+        events.sunset = -9999.0;
+        events.status = (ha == -1.0) ? DayStatus::PolarNight : DayStatus::PolarDay;
+        return events;
+    }
+    
+    double solarNoon = (720.0 - 4.0 * longitude - eph.eqTime) / 60.0;
+    double halfDay = ha * 4.0 / 60.0;
+    
+    events.sunrise = toLocalTime(solarNoon - halfDay);
+    events.sunset = toLocalTime(solarNoon + halfDay);
+    events.status = DayStatus::Normal;
+    return events;
+}
+
+DayEvents SolarCalculator::calculateDayEvents(double cosZenith, double rowScale, double rowOffset,
+                                             double solarNoon) const {
+    DayEvents events;
+    double cosHA = cosZenith * rowScale - rowOffset;
+    
+    if (cosHA > 1.0 || cosHA < -1.0) {
+        events.sunrise = -9999.0;
+        events.sunset = -9999.0;
+        events.status = (cosHA > 1.0) ? DayStatus::PolarNight : DayStatus::PolarDay;
+        return events;
+    }
+    
+    double halfDay = std::acos(cosHA) * 180.0 / M_PI * 4.0 / 60.0;
+    
+    events.sunrise = toLocalTime(solarNoon - halfDay);
+    events.sunset = toLocalTime(solarNoon + halfDay);
+    events.status = DayStatus::Normal;
+    return events;
+}
+
+DayEvents SolarCalculator::calculateDayEvents(const DayEphemeris& eph,
+                                             double latitude, double longitude, double elevation,
+                                             const int16_t* horizon, int numSectors) const {
+    DayEvents events;
+    double latRad = latitude * M_PI / 180.0;
+    double sinLat = std::sin(latRad);
+    double cosLat = std::cos(latRad);
+    double cosLatDecl = cosLat * eph.cosDecl;
+    double rowOffset = std::tan(latRad) * eph.tanDecl;
+    
+    // Standard event: sin(altitude) of the sun at the sea-level horizon
+    double baseSinAltitude = zenithCosine(elevation);
+    double cosHA = baseSinAltitude / cosLatDecl - rowOffset;
+    if (cosHA > 1.0 || cosHA < -1.0) {
+        events.sunrise = -9999.0;
+        events.sunset = -9999.0;
+        events.status = (cosHA > 1.0) ? DayStatus::PolarNight : DayStatus::PolarDay;
+        return events;
+    }
+    double baseHA = std::acos(cosHA);
+    
+    // Hour angle (radians, positive) of the morning (side = -1) or evening
+    // (side = +1) crossing of the terrain horizon; negative if none
+    auto eventHourAngle = [&](double side) {
+        double ha = baseHA;
+        for (int iter = 0; iter < HORIZON_ITERATIONS; ++iter) {
+            // Solar azimuth clockwise from north at hour angle side * ha
+            double signedHA = side * ha;
+            double azimuth = std::atan2(std::sin(signedHA),
+                                        std::cos(signedHA) * sinLat - eph.tanDecl * cosLat) + M_PI;
+            double terrain = HorizonMap::angleAt(horizon, numSectors, azimuth);
+            double sinAltitude = std::max(baseSinAltitude,
+                                          std::sin((terrain - SOLAR_DEPRESSION) * M_PI / 180.0));
+            
+            double c = sinAltitude / cosLatDecl - rowOffset;
+            if (c > 1.0) {
+                return -1.0;   // Terrain hides the sun around noon
+            }
+            double next = std::acos(std::max(c, -1.0));
+            if (std::abs(next - ha) < 1e-7) {
+                return next;
+            }
+            ha = next;
+        }
+        return ha;
+    };
+    
+    double riseHA = eventHourAngle(-1.0);
+    double setHA = eventHourAngle(1.0);
+    if (riseHA < 0.0 || setHA < 0.0) {
+        events.sunrise = -9999.0;
+        events.sunset = -9999.0;
+        events.status = DayStatus::PolarNight;
+        return events;
+    }
+    
+    double solarNoon = (720.0 - 4.0 * longitude - eph.eqTime) / 60.0;
+    
+    // Same operation order as the standard path, so flat terrain matches it exactly
+    events.sunrise = toLocalTime(solarNoon - riseHA * 180.0 / M_PI * 4.0 / 60.0);
+    events.sunset = toLocalTime(solarNoon + setHA * 180.0 / M_PI * 4.0 / 60.0);
+    events.status = DayStatus::Normal;
+    return events;
+}
+
+void SolarCalculator::computeRow(const double* cosZenith, const double* solarNoon,
+                                 double rowScale, double rowOffset,
+                                 int16_t* sunrise, int16_t* sunset, int n) const {
+    static const SolarKernels::RowKernel<double> kernel =
+        SolarKernels::rowKernel<double>(SolarKernels::activeIsa());
+    
+    SolarKernels::RowArgs<double> args;
+    args.cosZenith = cosZenith;
+    args.solarNoon = solarNoon;
+    args.rowScale = rowScale;
+    args.rowOffset = rowOffset;
+    args.timezoneOffset = timezoneOffset_;
+    args.unitsPerHour = unitsPerHour_;
+    args.sunrise = sunrise;
+    args.sunset = sunset;
+    args.n = n;
+    kernel(args);
+}
+
+void SolarCalculator::computeRow(const float* cosZenith, const float* solarNoon,
+                                 float rowScale, float rowOffset,
+                                 int16_t* sunrise, int16_t* sunset, int n) const {
+    static const SolarKernels::RowKernel<float> kernel =
+        SolarKernels::rowKernel<float>(SolarKernels::activeIsa());
+    
+    SolarKernels::RowArgs<float> args;
+    args.cosZenith = cosZenith;
+    args.solarNoon = solarNoon;
+    args.rowScale = rowScale;
+    args.rowOffset = rowOffset;
+    args.timezoneOffset = static_cast<float>(timezoneOffset_);
+    args.unitsPerHour = static_cast<float>(unitsPerHour_);
+    args.sunrise = sunrise;
+    args.sunset = sunset;
+    args.n = n;
+    kernel(args);
+}
+
+double SolarCalculator::toLocalTime(double solarTime) const {
     // Convert to local time
     solarTime += timezoneOffset_;
     
@@ -2,8 +2,45 @@
 #define SOLAR_CALCULATOR_H
 
 #include <cmath>
+#include <cstdint>
 #include <ctime>
 
+/**
+ * Solar ephemeris terms for a single day
+ * 
+ * These values depend only on the date, not on the observer,
+ * so they are computed once per day and shared by all pixels.
+ */
+struct DayEphemeris {
+    int year;             // Year
+    int dayOfYear;        // Day of year (1-366)
+    int month;            // Month (1-12)
+    int day;              // Day of month (1-31)
+    double declination;   // Sun declination (degrees)
+    double eqTime;        // Equation of time (minutes)
+    double sinDecl;       // sin(declination)
+    double cosDecl;       // cos(declination)
+    double tanDecl;       // tan(declination)
+};
+
+/**
+ * Classification of a day at a given location
+ */
+enum class DayStatus {
+    Normal,       // Sun rises and sets
+    PolarNight,   // Sun never rises
+    PolarDay      // Sun never sets
+};
+
+/**
+ * Sunrise and sunset of one day, from a single hour-angle evaluation
+ */
+struct DayEvents {
+    double sunrise;     // Decimal hours (local time), or -9999.0 if no sunrise
+    double sunset;      // Decimal hours (local time), or -9999.0 if no sunset
+    DayStatus status;
+};
+
 /**
  * SolarCalculator class
  * 
@@ -45,13 +82,141 @@ public:
      */
     double calculateSunset(double latitude, double longitude, double elevation,
                           int year, int month, int day) const;
+    
+    /**
+     * Compute the date-dependent solar terms for one day
+     * @param dayOfYear Day of year stored in the result (1-366)
+     * @return Ephemeris entry usable with the per-pixel entry points below
+     */
+    DayEphemeris computeEphemeris(int year, int month, int day, int dayOfYear = 0) const;
+    
+    /**
+     * Same, from the Julian day of the date (see CalendarTables.h)
+     */
+    DayEphemeris computeEphemeris(double julianDay, int year, int month, int day, int dayOfYear) const;
+    
+    /**
+     * Calculate sunrise time from a precomputed ephemeris entry
+     * @param eph Ephemeris entry for the day (see SolarEphemeris)
+     * @param latitude Latitude in degrees (-90 to 90)
+     * @param longitude Longitude in degrees (-180 to 180)
+     * @param elevation Elevation above sea level in meters
+     * @return Sunrise time in decimal hours (local time), or -9999.0 if no sunrise
+     */
+    double calculateSunrise(const DayEphemeris& eph,
+                           double latitude, double longitude, double elevation) const;
+    
+    /**
+     * Calculate sunset time from a precomputed ephemeris entry
+     * @return Sunset time in decimal hours (local time), or -9999.0 if no sunset
+     */
+    double calculateSunset(const DayEphemeris& eph,
+                          double latitude, double longitude, double elevation) const;
+    
+    /**
+     * Calculate sunrise and sunset together
+     * 
+     * Sunrise and sunset are symmetric around solar noon, so the
+     * hour angle is evaluated once and reused for both events.
+     * @param eph Ephemeris entry for the day (see SolarEphemeris)
+     * @param latitude Latitude in degrees (-90 to 90)
+     * @param longitude Longitude in degrees (-180 to 180)
+     * @param elevation Elevation above sea level in meters
+     * @return Both event times and the polar day/night status
+     */
+    DayEvents calculateDayEvents(const DayEphemeris& eph,
+                                 double latitude, double longitude, double elevation) const;
+    
+    /**
+     * Calculate sunrise and sunset from precomputed grid terms
+     * 
+     * Used by grid solvers that factor the per-row, per-column and
+     * per-pixel parts of the hour-angle formula out of the pixel loop.
+     * @param cosZenith Cosine of the sunrise zenith for the pixel (see zenithCosine)
+     * @param rowScale 1 / (cos(latitude) * cos(declination))
+     * @param rowOffset tan(latitude) * tan(declination)
+     * @param solarNoon Solar noon in UTC hours, (720 - 4 * longitude - eqTime) / 60
+     */
+    DayEvents calculateDayEvents(double cosZenith, double rowScale, double rowOffset,
+                                 double solarNoon) const;
+    
+    /**
+     * Calculate sunrise and sunset against a terrain horizon
+     * 
+     * The sun must clear the local terrain (less refraction and solar
+     * semi-diameter) or, where the terrain is lower, the sea-level horizon
+     * of the standard calculation. Because the horizon depends on the sun's
+     * azimuth, each event is found by iterating hour angle -> azimuth ->
+     * horizon altitude -> hour angle. On flat terrain the result equals the
+     * standard calculateDayEvents. Days on which the sun stays behind the
+     * terrain are reported as PolarNight.
+     * @param eph Ephemeris entry for the day (see SolarEphemeris)
+     * @param latitude Latitude in degrees (-90 to 90)
+     * @param longitude Longitude in degrees (-180 to 180)
+     * @param elevation Elevation above sea level in meters
+     * @param horizon Horizon angles of the pixel (see HorizonMap::pixel)
+     * @param numSectors Number of azimuth sectors in horizon
+     */
+    DayEvents calculateDayEvents(const DayEphemeris& eph,
+                                 double latitude, double longitude, double elevation,
+                                 const int16_t* horizon, int numSectors) const;
+    
+    /**
+     * Time unit of computeRow outputs, in seconds (default 60: minutes)
+     * @param seconds Divisor of 3600
+     */
+    void setTimeResolution(int seconds);
+    
+    /**
+     * Output time units per hour of computeRow (60 for minutes)
+     */
+    double timeUnitsPerHour() const { return unitsPerHour_; }
+    
+    /**
+     * Calculate sunrise/sunset minutes for a row of pixels
+     * 
+     * Batch form of the grid-term calculateDayEvents that writes Int16
+     * minutes (or units of setTimeResolution) directly. Runs the best SIMD kernel supported by the CPU
+     * (see SolarKernels); all kernels return identical results.
+     * @param cosZenith Per-pixel zenith term, NaN for masked pixels
+     * @param solarNoon Per-pixel solar noon in UTC hours
+     * @param rowScale 1 / (cos(latitude) * cos(declination))
+     * @param rowOffset tan(latitude) * tan(declination)
+     * @param sunrise Output minutes after midnight, -1 if masked or polar
+     * @param sunset Output minutes after midnight, -1 if masked or polar
+     * @param n Number of pixels
+     */
+    void computeRow(const double* cosZenith, const double* solarNoon,
+                    double rowScale, double rowOffset,
+                    int16_t* sunrise, int16_t* sunset, int n) const;
+    
+    /**
+     * Single-precision variant of computeRow
+     * 
+     * Uses twice the SIMD lanes of the double kernel. Results stay within
+     * one minute of the double path away from polar day/night transitions.
+     */
+    void computeRow(const float* cosZenith, const float* solarNoon,
+                    float rowScale, float rowOffset,
+                    int16_t* sunrise, int16_t* sunset, int n) const;
+    
+    /**
+     * Cosine of the sunrise/sunset zenith angle, including the
+     * elevation-dependent horizon dip correction
+     * @param elevation Elevation above sea level in meters
+     */
+    static double zenithCosine(double elevation);
 
 private:
     double timezoneOffset_;  // Timezone offset from UTC in hours
+    double unitsPerHour_;    // computeRow output units per hour
     
     // Solar depression angle for sunrise/sunset (degrees below horizon)
     static constexpr double SOLAR_DEPRESSION = 0.833;
     
+    // Fixed-point iterations of the horizon-aware event search
+    static constexpr int HORIZON_ITERATIONS = 6;
+    
     /**
      * Calculate Julian day number
      */
@@ -115,7 +280,7 @@ private:
     /**
      * Calculate hour angle for sunrise/sunset (degrees)
      */
-    double hourAngleSunrise(double latitude, double declination, double elevation) const;
+    double hourAngleSunrise(double latitude, const DayEphemeris& eph, double elevation) const;
     
     /**
      * Calculate sunrise/sunset time
@@ -123,6 +288,18 @@ private:
      */
     double calculateSolarTime(double latitude, double longitude, double elevation,
                              int year, int month, int day, bool isSunrise) const;
+    
+    /**
+     * Calculate sunrise/sunset time from a precomputed ephemeris entry
+     * @param isSunrise true for sunrise, false for sunset
+     */
+    double calculateSolarTime(const DayEphemeris& eph, double latitude, double longitude,
+                             double elevation, bool isSunrise) const;
+    
+    /**
+     * Convert solar time (UTC hours) to local time in [0, 24)
+     */
+    double toLocalTime(double solarTime) const;
 };
 
 #endif // SOLAR_CALCULATOR_H
@@ -0,0 +1,81 @@
+#include "SolarEphemeris.h"
+#include "CalendarTables.h"
+#include <cstdio>
+
+namespace {
+
+// Days [first, last] (0-based indices) of one year, dates from the compile-time table
+template <bool Leap>
+void appendDays(int year, int first, int last, const SolarCalculator& calc,
+                std::vector<DayEphemeris>& days) {
+    const Calendar::CalendarTable<Leap>& table = Calendar::CALENDAR<Leap>;
+    double jan1 = Calendar::julianDayJan1(year);
+    for (int i = first; i <= last; ++i) {
+        days.push_back(calc.computeEphemeris(jan1 + i, year, table.month[i], table.day[i], i + 1));
+    }
+}
+
+void appendYearDays(int year, int first, int last, const SolarCalculator& calc,
+                    std::vector<DayEphemeris>& days) {
+    if (Calendar::isLeapYear(year)) {
+        appendDays<true>(year, first, last, calc, days);
+    } else {
+        appendDays<false>(year, first, last, calc, days);
+    }
+}
+
+} // namespace
+
+SolarEphemeris::SolarEphemeris(int year)
+    : year_(year), isRange_(false) {
+    SolarCalculator calc;
+    days_.reserve(daysInYear(year));
+    appendYearDays(year, 0, daysInYear(year) - 1, calc, days_);
+}
+
+SolarEphemeris::SolarEphemeris(const CalendarDate& start, const CalendarDate& end)
+    : year_(start.year), isRange_(true) {
+    SolarCalculator calc;
+    
+    // Whole years between the first and last partial ones
+    for (int year = start.year; year <= end.year; ++year) {
+        int first = year == start.year ? Calendar::dayIndex(start.year, start.month, start.day) : 0;
+        int last = year == end.year ? Calendar::dayIndex(end.year, end.month, end.day) : daysInYear(year) - 1;
+        appendYearDays(year, first, last, calc, days_);
+    }
+}
+
+std::string SolarEphemeris::label() const {
+    if (!isRange_) {
+        return std::to_string(year_);
+    }
+    char text[32] = "empty";
+    if (!days_.empty()) {
+        const DayEphemeris& first = days_.front();
+        const DayEphemeris& last = days_.back();
+        std::snprintf(text, sizeof(text), "%04d-%02d-%02d_%04d-%02d-%02d",
+                      first.year, first.month, first.day, last.year, last.month, last.day);
+    }
+    return text;
+}
+
+bool SolarEphemeris::isLeapYear(int year) {
+    return Calendar::isLeapYear(year);
+}
+
+int SolarEphemeris::daysInYear(int year) {
+    return Calendar::daysInYear(year);
+}
+
+int SolarEphemeris::daysInMonth(int year, int month) {
+    return Calendar::daysInMonth(year, month);
+}
+
+bool SolarEphemeris::parseDate(const std::string& text, CalendarDate& date) {
+    char trailing;
+    if (std::sscanf(text.c_str(), "%d-%d-%d%c", &date.year, &date.month, &date.day, &trailing) != 3) {
+        return false;
+    }
+    return date.month >= 1 && date.month <= 12 &&
+           date.day >= 1 && date.day <= daysInMonth(date.year, date.month);
+}
@@ -0,0 +1,91 @@
+#ifndef SOLAR_EPHEMERIS_H
+#define SOLAR_EPHEMERIS_H
+
+#include <string>
+#include <vector>
+#include "SolarCalculator.h"
+
+/**
+ * Calendar date (proleptic Gregorian)
+ */
+struct CalendarDate {
+    int year;
+    int month;   // 1-12
+    int day;     // 1-31
+};
+
+/**
+ * SolarEphemeris class
+ * 
+ * Table of DayEphemeris entries, one per day of a calendar year or of
+ * an arbitrary date range. Built once per run and shared read-only by
+ * all pixels and threads, so the per-pixel work reduces to the
+ * hour-angle computation.
+ */
+class SolarEphemeris {
+public:
+    /**
+     * Constructor
+     * @param year Year (e.g., 2025)
+     */
+    explicit SolarEphemeris(int year);
+    
+    /**
+     * Constructor for the inclusive date range [start, end]
+     * 
+     * Days of a range are identified by YYYYDDD (year * 1000 + day of
+     * year, see dayId) so that ranges may span several years.
+     */
+    SolarEphemeris(const CalendarDate& start, const CalendarDate& end);
+    
+    /**
+     * Number of days in the table (365 or 366 for a year)
+     */
+    int numDays() const { return static_cast<int>(days_.size()); }
+    
+    /**
+     * Year of the first day
+     */
+    int year() const { return year_; }
+    
+    /**
+     * True for a date range (YYYYDDD day ids)
+     */
+    bool isRange() const { return isRange_; }
+    
+    /**
+     * Access an entry by 0-based index (index = dayOfYear - 1 for a year)
+     */
+    const DayEphemeris& operator[](int index) const { return days_[index]; }
+    
+    /**
+     * Day id written to the outputs: day of year (1-366) for a year,
+     * year * 1000 + day of year for a range
+     */
+    int dayId(int index) const {
+        const DayEphemeris& eph = days_[index];
+        return isRange_ ? eph.year * 1000 + eph.dayOfYear : eph.dayOfYear;
+    }
+    
+    /**
+     * Short name of the period for file names and logs ("2025" or
+     * "2025-03-01_2025-09-30")
+     */
+    std::string label() const;
+    
+    static bool isLeapYear(int year);
+    static int daysInYear(int year);
+    static int daysInMonth(int year, int month);
+    
+    /**
+     * Parse a YYYY-MM-DD date; returns false if malformed or invalid
+     */
+    static bool parseDate(const std::string& text, CalendarDate& date);
+    
+private:
+    int year_;
+    bool isRange_;
+    std::vector<DayEphemeris> days_;
+};
+
+#endif // SOLAR_EPHEMERIS_H
@@ -0,0 +1,41 @@
+#include "SolarGrid.h"
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+SolarGrid::SolarGrid(const double* geoTransform, int width, int height)
+    : width_(width), height_(height),
+      separable_(geoTransform[2] == 0.0 && geoTransform[4] == 0.0) {
+    if (!separable_) {
+        return;
+    }
+    
+    latitude_.resize(height);
+    cosLat_.resize(height);
+    tanLat_.resize(height);
+    for (int y = 0; y < height; ++y) {
+        latitude_[y] = geoTransform[3] + y * geoTransform[5];
+        double latRad = latitude_[y] * M_PI / 180.0;
+        cosLat_[y] = std::cos(latRad);
+        tanLat_[y] = std::tan(latRad);
+    }
+    
+    longitude_.resize(width);
+    for (int x = 0; x < width; ++x) {
+        longitude_[x] = geoTransform[0] + x * geoTransform[1];
+    }
+}
+
+void SolarGrid::solarNoonTable(const DayEphemeris& eph, int col0, int count, double* noon) const {
+    for (int i = 0; i < count; ++i) {
+        noon[i] = (720.0 - 4.0 * longitude_[col0 + i] - eph.eqTime) / 60.0;
+    }
+}
+
+void SolarGrid::solarNoonTable(const DayEphemeris& eph, int col0, int count, float* noon) const {
+    for (int i = 0; i < count; ++i) {
+        noon[i] = static_cast<float>((720.0 - 4.0 * longitude_[col0 + i] - eph.eqTime) / 60.0);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef SOLAR_GRID_H
+#define SOLAR_GRID_H
+
+#include <vector>
+#include "SolarCalculator.h"
+
+/**
+ * SolarGrid class
+ * 
+ * Separable decomposition of the hour-angle formula over a raster grid.
+ * With a north-up geotransform, latitude depends only on the row and
+ * longitude only on the column, so the latitude terms are tabulated
+ * once per row and the solar noon once per column and day.
+ * 
+ * Rotated geotransforms are not separable; callers must check
+ * isSeparable() and fall back to the per-pixel path.
+ */
+class SolarGrid {
+public:
+    /**
+     * Constructor
+     * @param geoTransform GDAL geotransform array
+     * @param width Raster width in pixels
+     * @param height Raster height in pixels
+     */
+    SolarGrid(const double* geoTransform, int width, int height);
+    
+    /**
+     * True if the geotransform has no rotation terms
+     */
+    bool isSeparable() const { return separable_; }
+    
+    int width() const { return width_; }
+    int height() const { return height_; }
+    
+    double latitude(int row) const { return latitude_[row]; }
+    double longitude(int col) const { return longitude_[col]; }
+    double cosLatitude(int row) const { return cosLat_[row]; }
+    double tanLatitude(int row) const { return tanLat_[row]; }
+    
+    /**
+     * Per-row, per-day terms of the hour-angle formula
+     * @param rowScale Output 1 / (cos(latitude) * cos(declination))
+     * @param rowOffset Output tan(latitude) * tan(declination)
+     */
+    void rowTerms(const DayEphemeris& eph, int row, double& rowScale, double& rowOffset) const {
+        rowScale = 1.0 / (cosLat_[row] * eph.cosDecl);
+        rowOffset = tanLat_[row] * eph.tanDecl;
+    }
+    
+    /**
+     * Fill the solar noon (UTC hours) for columns [col0, col0 + count)
+     */
+    void solarNoonTable(const DayEphemeris& eph, int col0, int count, double* noon) const;
+    void solarNoonTable(const DayEphemeris& eph, int col0, int count, float* noon) const;
+
+private:
+    int width_;
+    int height_;
+    bool separable_;
+    
+    std::vector<double> latitude_;   // Per row (degrees)
+    std::vector<double> cosLat_;     // Per row
+    std::vector<double> tanLat_;     // Per row
+    std::vector<double> longitude_;  // Per column (degrees)
+};
+
+#endif // SOLAR_GRID_H
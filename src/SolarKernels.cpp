@@ -0,0 +1,78 @@
+#include "SolarKernels.h"
+#include <cstdlib>
+#include <cstring>
+
+namespace SolarKernels {
+
+template <typename Real>
+void computeRowScalar(const RowArgs<Real>& args) {
+    for (int i = 0; i < args.n; ++i) {
+        pixelTimes(args.cosZenith[i], args.solarNoon[i], args.rowScale, args.rowOffset,
+                   args.timezoneOffset, args.unitsPerHour, args.sunrise[i], args.sunset[i]);
+    }
+}
+
+template void computeRowScalar<double>(const RowArgs<double>& args);
+template void computeRowScalar<float>(const RowArgs<float>& args);
+
+Isa detectIsa() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#ifdef SOLAR_HAVE_AVX512_KERNEL
+    if (__builtin_cpu_supports("avx512f")) {
+        return Isa::AVX512;
+    }
+#endif
+#ifdef SOLAR_HAVE_AVX2_KERNEL
+    if (__builtin_cpu_supports("avx2")) {
+        return Isa::AVX2;
+    }
+#endif
+#endif
+    return Isa::Scalar;
+}
+
+Isa activeIsa() {
+    static const Isa isa = [] {
+        Isa best = detectIsa();
+        const char* forced = std::getenv("SOLAR_KERNEL");
+        if (forced) {
+            if (std::strcmp(forced, "scalar") == 0) return Isa::Scalar;
+            if (std::strcmp(forced, "avx2") == 0 && best >= Isa::AVX2) return Isa::AVX2;
+            if (std::strcmp(forced, "avx512") == 0 && best >= Isa::AVX512) return Isa::AVX512;
+        }
+        return best;
+    }();
+    return isa;
+}
+
+template <typename Real>
+RowKernel<Real> rowKernel(Isa isa) {
+    switch (isa) {
+        case Isa::Scalar:
+            return computeRowScalar<Real>;
+#ifdef SOLAR_HAVE_AVX2_KERNEL
+        case Isa::AVX2:
+            return static_cast<RowKernel<Real>>(computeRowAVX2);
+#endif
+#ifdef SOLAR_HAVE_AVX512_KERNEL
+        case Isa::AVX512:
+            return static_cast<RowKernel<Real>>(computeRowAVX512);
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+template RowKernel<double> rowKernel<double>(Isa isa);
+template RowKernel<float> rowKernel<float>(Isa isa);
+
+const char* isaName(Isa isa) {
+    switch (isa) {
+        case Isa::Scalar: return "scalar";
+        case Isa::AVX2: return "avx2";
+        case Isa::AVX512: return "avx512";
+    }
+    return "unknown";
+}
+
+} // namespace SolarKernels
@@ -0,0 +1,173 @@
+#ifndef SOLAR_KERNELS_H
+#define SOLAR_KERNELS_H
+
+#include <cstdint>
+#include <cmath>
+
+/**
+ * Batch hour-angle kernels
+ * 
+ * Compute sunrise/sunset minutes for a run of pixels sharing one row,
+ * from the separable grid terms (see SolarGrid). Each instruction set
+ * variant lives in its own translation unit, compiled with the matching
+ * target flags, and is selected at runtime so one binary runs on any
+ * x86-64 node.
+ * 
+ * Kernels come in double and float precision. The float variants use
+ * twice the SIMD lanes; their results are validated against the double
+ * path (see DemProcessor::validatePrecision).
+ * 
+ * For a given precision, all variants evaluate the same operation sequence
+ * (no FMA contraction), including the polynomial acos below, so they
+ * return identical results. The CUDA kernel (GpuKernels.cu) runs the
+ * scalar pixelTimes() itself.
+ */
+
+// Functions shared with device code
+#ifdef __CUDACC__
+#define SOLAR_HOST_DEVICE __host__ __device__
+#else
+#define SOLAR_HOST_DEVICE
+#endif
+
+namespace SolarKernels {
+
+/**
+ * Instruction set of a kernel variant
+ */
+enum class Isa {
+    Scalar,
+    AVX2,
+    AVX512
+};
+
+/**
+ * Arguments for one row of pixels
+ * @tparam Real double or float
+ */
+template <typename Real>
+struct RowArgs {
+    const Real* cosZenith;      // Per-pixel zenith term, NaN for masked pixels
+    const Real* solarNoon;      // Per-pixel solar noon (UTC hours)
+    Real rowScale;              // 1 / (cos(latitude) * cos(declination))
+    Real rowOffset;             // tan(latitude) * tan(declination)
+    Real timezoneOffset;        // Hours added to convert to local time
+    Real unitsPerHour;          // Output time units per hour (60: minutes)
+    int16_t* sunrise;           // Output time units after midnight, -1 if masked or polar
+    int16_t* sunset;            // Output time units after midnight, -1 if masked or polar
+    int n;                      // Number of pixels
+};
+
+template <typename Real>
+using RowKernel = void (*)(const RowArgs<Real>& args);
+
+template <typename Real>
+void computeRowScalar(const RowArgs<Real>& args);
+#ifdef SOLAR_HAVE_AVX2_KERNEL
+void computeRowAVX2(const RowArgs<double>& args);
+void computeRowAVX2(const RowArgs<float>& args);
+#endif
+#ifdef SOLAR_HAVE_AVX512_KERNEL
+void computeRowAVX512(const RowArgs<double>& args);
+void computeRowAVX512(const RowArgs<float>& args);
+#endif
+
+/**
+ * Best instruction set supported by both this build and the running CPU
+ */
+Isa detectIsa();
+
+/**
+ * Instruction set used by SolarCalculator::computeRow
+ * 
+ * Defaults to detectIsa(); the SOLAR_KERNEL environment variable
+ * (scalar, avx2, avx512) forces a lower level for validation.
+ */
+Isa activeIsa();
+
+/**
+ * Kernel for an instruction set, or nullptr if not available
+ */
+template <typename Real>
+RowKernel<Real> rowKernel(Isa isa);
+
+const char* isaName(Isa isa);
+
+// Hours of half-day per radian of hour angle: (180 / pi) * 4 / 60
+constexpr double HOURS_PER_RADIAN = 3.81971863420548805845;
+constexpr double PI = 3.14159265358979323846;
+constexpr double PI_2 = 1.57079632679489661923;
+
+// Rational approximation of asin from fdlibm (e_asin.c)
+constexpr double ASIN_P0 = 1.66666666666666657415e-01;
+constexpr double ASIN_P1 = -3.25565818622400915405e-01;
+constexpr double ASIN_P2 = 2.01212532134862925881e-01;
+constexpr double ASIN_P3 = -4.00555345006794114027e-02;
+constexpr double ASIN_P4 = 7.91534994289814532176e-04;
+constexpr double ASIN_P5 = 3.47933107596021167570e-05;
+constexpr double ASIN_Q1 = -2.40339491173441421878e+00;
+constexpr double ASIN_Q2 = 2.02094576023350569471e+00;
+constexpr double ASIN_Q3 = -6.88283971605453293030e-01;
+constexpr double ASIN_Q4 = 7.70381505559019352791e-02;
+
+/**
+ * Polynomial acos, written with the same operation order as the
+ * vector variants. Input must be in [-1, 1].
+ */
+template <typename Real>
+SOLAR_HOST_DEVICE inline Real acosPoly(Real x) {
+    const Real half = Real(0.5);
+    const Real one = Real(1.0);
+    
+    Real ax = std::fabs(x);
+    bool big = ax >= half;
+    Real z = big ? (one - ax) * half : x * x;
+    Real s = big ? std::sqrt(z) : ax;
+    
+    Real p = z * (Real(ASIN_P0) + z * (Real(ASIN_P1) + z * (Real(ASIN_P2) +
+             z * (Real(ASIN_P3) + z * (Real(ASIN_P4) + z * Real(ASIN_P5))))));
+    Real q = one + z * (Real(ASIN_Q1) + z * (Real(ASIN_Q2) + z * (Real(ASIN_Q3) + z * Real(ASIN_Q4))));
+    Real r = s + s * (p / q);
+    
+    if (!big) {
+        return Real(PI_2) - std::copysign(r, x);
+    }
+    Real twoR = r + r;
+    return (x < Real(0.0)) ? Real(PI) - twoR : twoR;
+}
+
+/**
+ * Sunrise/sunset time units of one pixel from its zenith term and solar
+ * noon and the row terms (see RowArgs); the body of the scalar kernel
+ */
+template <typename Real>
+SOLAR_HOST_DEVICE inline void pixelTimes(Real cosZen, Real solarNoon, Real rowScale, Real rowOffset,
+                                         Real timezoneOffset, Real unitsPerHour,
+                                         int16_t& sunrise, int16_t& sunset) {
+    const Real hoursPerRadian = Real(HOURS_PER_RADIAN);
+    const Real day = Real(24.0);
+    const Real invDay = Real(1.0 / 24.0);
+    
+    Real cosHA = cosZen * rowScale - rowOffset;
+    
+    bool invalid = std::isnan(cosZen) || cosHA > Real(1.0) || cosHA < Real(-1.0);
+    Real clamped = invalid ? Real(0.0) : cosHA;
+    Real halfDay = acosPoly(clamped) * hoursPerRadian;
+    
+    Real rise = solarNoon - halfDay + timezoneOffset;
+    Real set = solarNoon + halfDay + timezoneOffset;
+    
+    // Wrap into [0, 24)
+    rise = rise - day * std::floor(rise * invDay);
+    set = set - day * std::floor(set * invDay);
+    
+    Real riseUnits = std::nearbyint(rise * unitsPerHour);
+    Real setUnits = std::nearbyint(set * unitsPerHour);
+    
+    sunrise = invalid ? -1 : static_cast<int16_t>(riseUnits);
+    sunset = invalid ? -1 : static_cast<int16_t>(setUnits);
+}
+
+} // namespace SolarKernels
+
+#endif // SOLAR_KERNELS_H
@@ -0,0 +1,198 @@
+// Compiled with -mavx2 (see CMakeLists.txt); only called after runtime detection.
+#include "SolarKernels.h"
+#include <immintrin.h>
+
+namespace SolarKernels {
+
+namespace {
+
+// Double precision, 4 lanes
+
+inline __m256d acosPoly(__m256d x) {
+    const __m256d signMask = _mm256_set1_pd(-0.0);
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d one = _mm256_set1_pd(1.0);
+    
+    __m256d ax = _mm256_andnot_pd(signMask, x);
+    __m256d big = _mm256_cmp_pd(ax, half, _CMP_GE_OQ);
+    __m256d z = _mm256_blendv_pd(_mm256_mul_pd(x, x),
+                                 _mm256_mul_pd(_mm256_sub_pd(one, ax), half), big);
+    __m256d s = _mm256_blendv_pd(ax, _mm256_sqrt_pd(z), big);
+    
+    __m256d p = _mm256_add_pd(_mm256_set1_pd(ASIN_P4), _mm256_mul_pd(z, _mm256_set1_pd(ASIN_P5)));
+    p = _mm256_add_pd(_mm256_set1_pd(ASIN_P3), _mm256_mul_pd(z, p));
+    p = _mm256_add_pd(_mm256_set1_pd(ASIN_P2), _mm256_mul_pd(z, p));
+    p = _mm256_add_pd(_mm256_set1_pd(ASIN_P1), _mm256_mul_pd(z, p));
+    p = _mm256_add_pd(_mm256_set1_pd(ASIN_P0), _mm256_mul_pd(z, p));
+    p = _mm256_mul_pd(z, p);
+    
+    __m256d q = _mm256_add_pd(_mm256_set1_pd(ASIN_Q3), _mm256_mul_pd(z, _mm256_set1_pd(ASIN_Q4)));
+    q = _mm256_add_pd(_mm256_set1_pd(ASIN_Q2), _mm256_mul_pd(z, q));
+    q = _mm256_add_pd(_mm256_set1_pd(ASIN_Q1), _mm256_mul_pd(z, q));
+    q = _mm256_add_pd(one, _mm256_mul_pd(z, q));
+    
+    __m256d r = _mm256_add_pd(s, _mm256_mul_pd(s, _mm256_div_pd(p, q)));
+    
+    // |x| < 0.5: pi/2 - copysign(r, x)
+    __m256d small = _mm256_sub_pd(_mm256_set1_pd(PI_2),
+                                  _mm256_or_pd(r, _mm256_and_pd(x, signMask)));
+    // |x| >= 0.5: 2r for x > 0, pi - 2r for x < 0
+    __m256d twoR = _mm256_add_pd(r, r);
+    __m256d negative = _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_LT_OQ);
+    __m256d large = _mm256_blendv_pd(twoR, _mm256_sub_pd(_mm256_set1_pd(PI), twoR), negative);
+    
+    return _mm256_blendv_pd(small, large, big);
+}
+
+inline __m256d wrapDay(__m256d hours) {
+    const __m256d day = _mm256_set1_pd(24.0);
+    __m256d turns = _mm256_floor_pd(_mm256_mul_pd(hours, _mm256_set1_pd(1.0 / 24.0)));
+    return _mm256_sub_pd(hours, _mm256_mul_pd(day, turns));
+}
+
+inline void storeMinutes(int16_t* out, __m256d minutes) {
+    __m128i i32 = _mm256_cvtpd_epi32(minutes);
+    __m128i i16 = _mm_packs_epi32(i32, i32);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), i16);
+}
+
+// Single precision, 8 lanes
+
+inline __m256 acosPoly(__m256 x) {
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    
+    __m256 ax = _mm256_andnot_ps(signMask, x);
+    __m256 big = _mm256_cmp_ps(ax, half, _CMP_GE_OQ);
+    __m256 z = _mm256_blendv_ps(_mm256_mul_ps(x, x),
+                                _mm256_mul_ps(_mm256_sub_ps(one, ax), half), big);
+    __m256 s = _mm256_blendv_ps(ax, _mm256_sqrt_ps(z), big);
+    
+    __m256 p = _mm256_add_ps(_mm256_set1_ps(float(ASIN_P4)), _mm256_mul_ps(z, _mm256_set1_ps(float(ASIN_P5))));
+    p = _mm256_add_ps(_mm256_set1_ps(float(ASIN_P3)), _mm256_mul_ps(z, p));
+    p = _mm256_add_ps(_mm256_set1_ps(float(ASIN_P2)), _mm256_mul_ps(z, p));
+    p = _mm256_add_ps(_mm256_set1_ps(float(ASIN_P1)), _mm256_mul_ps(z, p));
+    p = _mm256_add_ps(_mm256_set1_ps(float(ASIN_P0)), _mm256_mul_ps(z, p));
+    p = _mm256_mul_ps(z, p);
+    
+    __m256 q = _mm256_add_ps(_mm256_set1_ps(float(ASIN_Q3)), _mm256_mul_ps(z, _mm256_set1_ps(float(ASIN_Q4))));
+    q = _mm256_add_ps(_mm256_set1_ps(float(ASIN_Q2)), _mm256_mul_ps(z, q));
+    q = _mm256_add_ps(_mm256_set1_ps(float(ASIN_Q1)), _mm256_mul_ps(z, q));
+    q = _mm256_add_ps(one, _mm256_mul_ps(z, q));
+    
+    __m256 r = _mm256_add_ps(s, _mm256_mul_ps(s, _mm256_div_ps(p, q)));
+    
+    __m256 small = _mm256_sub_ps(_mm256_set1_ps(float(PI_2)),
+                                 _mm256_or_ps(r, _mm256_and_ps(x, signMask)));
+    __m256 twoR = _mm256_add_ps(r, r);
+    __m256 negative = _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ);
+    __m256 large = _mm256_blendv_ps(twoR, _mm256_sub_ps(_mm256_set1_ps(float(PI)), twoR), negative);
+    
+    return _mm256_blendv_ps(small, large, big);
+}
+
+inline __m256 wrapDay(__m256 hours) {
+    const __m256 day = _mm256_set1_ps(24.0f);
+    __m256 turns = _mm256_floor_ps(_mm256_mul_ps(hours, _mm256_set1_ps(float(1.0 / 24.0))));
+    return _mm256_sub_ps(hours, _mm256_mul_ps(day, turns));
+}
+
+inline void storeMinutes(int16_t* out, __m256 minutes) {
+    __m256i i32 = _mm256_cvtps_epi32(minutes);
+    __m128i i16 = _mm_packs_epi32(_mm256_castsi256_si128(i32), _mm256_extracti128_si256(i32, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), i16);
+}
+
+} // namespace
+
+void computeRowAVX2(const RowArgs<double>& args) {
+    const __m256d scale = _mm256_set1_pd(args.rowScale);
+    const __m256d offset = _mm256_set1_pd(args.rowOffset);
+    const __m256d tz = _mm256_set1_pd(args.timezoneOffset);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d minusOne = _mm256_set1_pd(-1.0);
+    const __m256d hoursPerRadian = _mm256_set1_pd(HOURS_PER_RADIAN);
+    const __m256d unitsPerHour = _mm256_set1_pd(args.unitsPerHour);
+    
+    int i = 0;
+    for (; i + 4 <= args.n; i += 4) {
+        __m256d cosZen = _mm256_loadu_pd(args.cosZenith + i);
+        __m256d noon = _mm256_loadu_pd(args.solarNoon + i);
+        __m256d cosHA = _mm256_sub_pd(_mm256_mul_pd(cosZen, scale), offset);
+        
+        // Masked (NaN) or polar lanes
+        __m256d invalid = _mm256_or_pd(_mm256_cmp_pd(cosZen, cosZen, _CMP_UNORD_Q),
+                                       _mm256_or_pd(_mm256_cmp_pd(cosHA, one, _CMP_GT_OQ),
+                                                    _mm256_cmp_pd(cosHA, minusOne, _CMP_LT_OQ)));
+        __m256d clamped = _mm256_blendv_pd(cosHA, _mm256_setzero_pd(), invalid);
+        __m256d halfDay = _mm256_mul_pd(acosPoly(clamped), hoursPerRadian);
+        
+        __m256d rise = wrapDay(_mm256_add_pd(_mm256_sub_pd(noon, halfDay), tz));
+        __m256d set = wrapDay(_mm256_add_pd(_mm256_add_pd(noon, halfDay), tz));
+        
+        __m256d riseMinutes = _mm256_round_pd(_mm256_mul_pd(rise, unitsPerHour),
+                                              _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256d setMinutes = _mm256_round_pd(_mm256_mul_pd(set, unitsPerHour),
+                                             _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        
+        storeMinutes(args.sunrise + i, _mm256_blendv_pd(riseMinutes, minusOne, invalid));
+        storeMinutes(args.sunset + i, _mm256_blendv_pd(setMinutes, minusOne, invalid));
+    }
+    
+    if (i < args.n) {
+        RowArgs<double> tail = args;
+        tail.cosZenith += i;
+        tail.solarNoon += i;
+        tail.sunrise += i;
+        tail.sunset += i;
+        tail.n -= i;
+        computeRowScalar(tail);
+    }
+}
+
+void computeRowAVX2(const RowArgs<float>& args) {
+    const __m256 scale = _mm256_set1_ps(args.rowScale);
+    const __m256 offset = _mm256_set1_ps(args.rowOffset);
+    const __m256 tz = _mm256_set1_ps(args.timezoneOffset);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 minusOne = _mm256_set1_ps(-1.0f);
+    const __m256 hoursPerRadian = _mm256_set1_ps(float(HOURS_PER_RADIAN));
+    const __m256 unitsPerHour = _mm256_set1_ps(args.unitsPerHour);
+    
+    int i = 0;
+    for (; i + 8 <= args.n; i += 8) {
+        __m256 cosZen = _mm256_loadu_ps(args.cosZenith + i);
+        __m256 noon = _mm256_loadu_ps(args.solarNoon + i);
+        __m256 cosHA = _mm256_sub_ps(_mm256_mul_ps(cosZen, scale), offset);
+        
+        __m256 invalid = _mm256_or_ps(_mm256_cmp_ps(cosZen, cosZen, _CMP_UNORD_Q),
+                                      _mm256_or_ps(_mm256_cmp_ps(cosHA, one, _CMP_GT_OQ),
+                                                   _mm256_cmp_ps(cosHA, minusOne, _CMP_LT_OQ)));
+        __m256 clamped = _mm256_blendv_ps(cosHA, _mm256_setzero_ps(), invalid);
+        __m256 halfDay = _mm256_mul_ps(acosPoly(clamped), hoursPerRadian);
+        
+        __m256 rise = wrapDay(_mm256_add_ps(_mm256_sub_ps(noon, halfDay), tz));
+        __m256 set = wrapDay(_mm256_add_ps(_mm256_add_ps(noon, halfDay), tz));
+        
+        __m256 riseMinutes = _mm256_round_ps(_mm256_mul_ps(rise, unitsPerHour),
+                                             _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256 setMinutes = _mm256_round_ps(_mm256_mul_ps(set, unitsPerHour),
+                                            _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        
+        storeMinutes(args.sunrise + i, _mm256_blendv_ps(riseMinutes, minusOne, invalid));
+        storeMinutes(args.sunset + i, _mm256_blendv_ps(setMinutes, minusOne, invalid));
+    }
+    
+    if (i < args.n) {
+        RowArgs<float> tail = args;
+        tail.cosZenith += i;
+        tail.solarNoon += i;
+        tail.sunrise += i;
+        tail.sunset += i;
+        tail.n -= i;
+        computeRowScalar(tail);
+    }
+}
+
+} // namespace SolarKernels
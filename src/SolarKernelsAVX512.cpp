@@ -0,0 +1,197 @@
+// Compiled with -mavx512f (see CMakeLists.txt); only called after runtime detection.
+#include "SolarKernels.h"
+#include <immintrin.h>
+
+namespace SolarKernels {
+
+namespace {
+
+// Double precision, 8 lanes
+
+inline __m512d acosPoly(__m512d x) {
+    const __m512d half = _mm512_set1_pd(0.5);
+    const __m512d one = _mm512_set1_pd(1.0);
+    
+    __m512d ax = _mm512_abs_pd(x);
+    __mmask8 big = _mm512_cmp_pd_mask(ax, half, _CMP_GE_OQ);
+    __m512d z = _mm512_mask_blend_pd(big, _mm512_mul_pd(x, x),
+                                     _mm512_mul_pd(_mm512_sub_pd(one, ax), half));
+    __m512d s = _mm512_mask_blend_pd(big, ax, _mm512_sqrt_pd(z));
+    
+    __m512d p = _mm512_add_pd(_mm512_set1_pd(ASIN_P4), _mm512_mul_pd(z, _mm512_set1_pd(ASIN_P5)));
+    p = _mm512_add_pd(_mm512_set1_pd(ASIN_P3), _mm512_mul_pd(z, p));
+    p = _mm512_add_pd(_mm512_set1_pd(ASIN_P2), _mm512_mul_pd(z, p));
+    p = _mm512_add_pd(_mm512_set1_pd(ASIN_P1), _mm512_mul_pd(z, p));
+    p = _mm512_add_pd(_mm512_set1_pd(ASIN_P0), _mm512_mul_pd(z, p));
+    p = _mm512_mul_pd(z, p);
+    
+    __m512d q = _mm512_add_pd(_mm512_set1_pd(ASIN_Q3), _mm512_mul_pd(z, _mm512_set1_pd(ASIN_Q4)));
+    q = _mm512_add_pd(_mm512_set1_pd(ASIN_Q2), _mm512_mul_pd(z, q));
+    q = _mm512_add_pd(_mm512_set1_pd(ASIN_Q1), _mm512_mul_pd(z, q));
+    q = _mm512_add_pd(one, _mm512_mul_pd(z, q));
+    
+    __m512d r = _mm512_add_pd(s, _mm512_mul_pd(s, _mm512_div_pd(p, q)));
+    
+    // |x| < 0.5: pi/2 - copysign(r, x)
+    __mmask8 negative = _mm512_cmp_pd_mask(x, _mm512_setzero_pd(), _CMP_LT_OQ);
+    __m512d signedR = _mm512_mask_blend_pd(negative, r, _mm512_sub_pd(_mm512_setzero_pd(), r));
+    __m512d small = _mm512_sub_pd(_mm512_set1_pd(PI_2), signedR);
+    // |x| >= 0.5: 2r for x > 0, pi - 2r for x < 0
+    __m512d twoR = _mm512_add_pd(r, r);
+    __m512d large = _mm512_mask_blend_pd(negative, twoR, _mm512_sub_pd(_mm512_set1_pd(PI), twoR));
+    
+    return _mm512_mask_blend_pd(big, small, large);
+}
+
+inline __m512d wrapDay(__m512d hours) {
+    const __m512d day = _mm512_set1_pd(24.0);
+    __m512d turns = _mm512_roundscale_pd(_mm512_mul_pd(hours, _mm512_set1_pd(1.0 / 24.0)),
+                                         _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+    return _mm512_sub_pd(hours, _mm512_mul_pd(day, turns));
+}
+
+inline void storeMinutes(int16_t* out, __m512d minutes) {
+    __m256i i32 = _mm512_cvtpd_epi32(minutes);
+    __m128i i16 = _mm_packs_epi32(_mm256_castsi256_si128(i32), _mm256_extracti128_si256(i32, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), i16);
+}
+
+// Single precision, 16 lanes
+
+inline __m512 acosPoly(__m512 x) {
+    const __m512 half = _mm512_set1_ps(0.5f);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    
+    __m512 ax = _mm512_abs_ps(x);
+    __mmask16 big = _mm512_cmp_ps_mask(ax, half, _CMP_GE_OQ);
+    __m512 z = _mm512_mask_blend_ps(big, _mm512_mul_ps(x, x),
+                                    _mm512_mul_ps(_mm512_sub_ps(one, ax), half));
+    __m512 s = _mm512_mask_blend_ps(big, ax, _mm512_sqrt_ps(z));
+    
+    __m512 p = _mm512_add_ps(_mm512_set1_ps(float(ASIN_P4)), _mm512_mul_ps(z, _mm512_set1_ps(float(ASIN_P5))));
+    p = _mm512_add_ps(_mm512_set1_ps(float(ASIN_P3)), _mm512_mul_ps(z, p));
+    p = _mm512_add_ps(_mm512_set1_ps(float(ASIN_P2)), _mm512_mul_ps(z, p));
+    p = _mm512_add_ps(_mm512_set1_ps(float(ASIN_P1)), _mm512_mul_ps(z, p));
+    p = _mm512_add_ps(_mm512_set1_ps(float(ASIN_P0)), _mm512_mul_ps(z, p));
+    p = _mm512_mul_ps(z, p);
+    
+    __m512 q = _mm512_add_ps(_mm512_set1_ps(float(ASIN_Q3)), _mm512_mul_ps(z, _mm512_set1_ps(float(ASIN_Q4))));
+    q = _mm512_add_ps(_mm512_set1_ps(float(ASIN_Q2)), _mm512_mul_ps(z, q));
+    q = _mm512_add_ps(_mm512_set1_ps(float(ASIN_Q1)), _mm512_mul_ps(z, q));
+    q = _mm512_add_ps(one, _mm512_mul_ps(z, q));
+    
+    __m512 r = _mm512_add_ps(s, _mm512_mul_ps(s, _mm512_div_ps(p, q)));
+    
+    __mmask16 negative = _mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_LT_OQ);
+    __m512 signedR = _mm512_mask_blend_ps(negative, r, _mm512_sub_ps(_mm512_setzero_ps(), r));
+    __m512 small = _mm512_sub_ps(_mm512_set1_ps(float(PI_2)), signedR);
+    __m512 twoR = _mm512_add_ps(r, r);
+    __m512 large = _mm512_mask_blend_ps(negative, twoR, _mm512_sub_ps(_mm512_set1_ps(float(PI)), twoR));
+    
+    return _mm512_mask_blend_ps(big, small, large);
+}
+
+inline __m512 wrapDay(__m512 hours) {
+    const __m512 day = _mm512_set1_ps(24.0f);
+    __m512 turns = _mm512_roundscale_ps(_mm512_mul_ps(hours, _mm512_set1_ps(float(1.0 / 24.0))),
+                                        _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+    return _mm512_sub_ps(hours, _mm512_mul_ps(day, turns));
+}
+
+inline void storeMinutes(int16_t* out, __m512 minutes) {
+    __m256i i16 = _mm512_cvtsepi32_epi16(_mm512_cvtps_epi32(minutes));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), i16);
+}
+
+} // namespace
+
+void computeRowAVX512(const RowArgs<double>& args) {
+    const __m512d scale = _mm512_set1_pd(args.rowScale);
+    const __m512d offset = _mm512_set1_pd(args.rowOffset);
+    const __m512d tz = _mm512_set1_pd(args.timezoneOffset);
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d minusOne = _mm512_set1_pd(-1.0);
+    const __m512d hoursPerRadian = _mm512_set1_pd(HOURS_PER_RADIAN);
+    const __m512d unitsPerHour = _mm512_set1_pd(args.unitsPerHour);
+    
+    int i = 0;
+    for (; i + 8 <= args.n; i += 8) {
+        __m512d cosZen = _mm512_loadu_pd(args.cosZenith + i);
+        __m512d noon = _mm512_loadu_pd(args.solarNoon + i);
+        __m512d cosHA = _mm512_sub_pd(_mm512_mul_pd(cosZen, scale), offset);
+        
+        // Masked (NaN) or polar lanes
+        __mmask8 invalid = _mm512_cmp_pd_mask(cosZen, cosZen, _CMP_UNORD_Q) |
+                           _mm512_cmp_pd_mask(cosHA, one, _CMP_GT_OQ) |
+                           _mm512_cmp_pd_mask(cosHA, minusOne, _CMP_LT_OQ);
+        __m512d clamped = _mm512_mask_blend_pd(invalid, cosHA, _mm512_setzero_pd());
+        __m512d halfDay = _mm512_mul_pd(acosPoly(clamped), hoursPerRadian);
+        
+        __m512d rise = wrapDay(_mm512_add_pd(_mm512_sub_pd(noon, halfDay), tz));
+        __m512d set = wrapDay(_mm512_add_pd(_mm512_add_pd(noon, halfDay), tz));
+        
+        __m512d riseMinutes = _mm512_roundscale_pd(_mm512_mul_pd(rise, unitsPerHour),
+                                                   _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m512d setMinutes = _mm512_roundscale_pd(_mm512_mul_pd(set, unitsPerHour),
+                                                  _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        
+        storeMinutes(args.sunrise + i, _mm512_mask_blend_pd(invalid, riseMinutes, minusOne));
+        storeMinutes(args.sunset + i, _mm512_mask_blend_pd(invalid, setMinutes, minusOne));
+    }
+    
+    if (i < args.n) {
+        RowArgs<double> tail = args;
+        tail.cosZenith += i;
+        tail.solarNoon += i;
+        tail.sunrise += i;
+        tail.sunset += i;
+        tail.n -= i;
+        computeRowScalar(tail);
+    }
+}
+
+void computeRowAVX512(const RowArgs<float>& args) {
+    const __m512 scale = _mm512_set1_ps(args.rowScale);
+    const __m512 offset = _mm512_set1_ps(args.rowOffset);
+    const __m512 tz = _mm512_set1_ps(args.timezoneOffset);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 minusOne = _mm512_set1_ps(-1.0f);
+    const __m512 hoursPerRadian = _mm512_set1_ps(float(HOURS_PER_RADIAN));
+    const __m512 unitsPerHour = _mm512_set1_ps(args.unitsPerHour);
+    
+    int i = 0;
+    for (; i + 16 <= args.n; i += 16) {
+        __m512 cosZen = _mm512_loadu_ps(args.cosZenith + i);
+        __m512 noon = _mm512_loadu_ps(args.solarNoon + i);
+        __m512 cosHA = _mm512_sub_ps(_mm512_mul_ps(cosZen, scale), offset);
+        
+        __mmask16 invalid = _mm512_cmp_ps_mask(cosZen, cosZen, _CMP_UNORD_Q) |
+                            _mm512_cmp_ps_mask(cosHA, one, _CMP_GT_OQ) |
+                            _mm512_cmp_ps_mask(cosHA, minusOne, _CMP_LT_OQ);
+        __m512 clamped = _mm512_mask_blend_ps(invalid, cosHA, _mm512_setzero_ps());
+        __m512 halfDay = _mm512_mul_ps(acosPoly(clamped), hoursPerRadian);
+        
+        __m512 rise = wrapDay(_mm512_add_ps(_mm512_sub_ps(noon, halfDay), tz));
+        __m512 set = wrapDay(_mm512_add_ps(_mm512_add_ps(noon, halfDay), tz));
+        
+        __m512 riseMinutes = _mm512_roundscale_ps(_mm512_mul_ps(rise, unitsPerHour),
+                                                  _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m512 setMinutes = _mm512_roundscale_ps(_mm512_mul_ps(set, unitsPerHour),
+                                                 _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        
+        storeMinutes(args.sunrise + i, _mm512_mask_blend_ps(invalid, riseMinutes, minusOne));
+        storeMinutes(args.sunset + i, _mm512_mask_blend_ps(invalid, setMinutes, minusOne));
+    }
+    
+    if (i < args.n) {
+        RowArgs<float> tail = args;
+        tail.cosZenith += i;
+        tail.solarNoon += i;
+        tail.sunrise += i;
+        tail.sunset += i;
+        tail.n -= i;
+        computeRowScalar(tail);
+    }
+}
+
+} // namespace SolarKernels
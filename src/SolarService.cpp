@@ -0,0 +1,304 @@
+#include "SolarService.h"
+#include "NumaPlacement.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// Same mask and minute conversion as the binary stream
+inline bool isMasked(float elevation, float nodata) {
+    return std::isnan(elevation) || elevation == nodata || elevation == 0.0f;
+}
+
+inline void toMinutes(const DayEvents& events, int16_t& sunrise, int16_t& sunset) {
+    if (events.status != DayStatus::Normal) {
+        sunrise = -1;
+        sunset = -1;
+    } else {
+        sunrise = static_cast<int16_t>(std::round(events.sunrise * 60.0));
+        sunset = static_cast<int16_t>(std::round(events.sunset * 60.0));
+    }
+}
+
+// Cache key: day id (YYYYDDD) and tile coordinates
+inline uint64_t tileKey(int tileX, int tileY, const DayEphemeris& eph) {
+    uint64_t day = static_cast<uint64_t>(eph.year) * 1000 + eph.dayOfYear;
+    return (day << 40) | (static_cast<uint64_t>(tileY) << 20) | static_cast<uint64_t>(tileX);
+}
+
+bool compareDates(const CalendarDate& a, const CalendarDate& b) {
+    return a.year * 10000 + a.month * 100 + a.day < b.year * 10000 + b.month * 100 + b.day;
+}
+
+} // namespace
+
+SolarService::SolarService(const float* dem, int width, int height, const double* geoTransform,
+                           float nodata, const HorizonMap* horizon, double timezoneOffset,
+                           size_t cacheBytes)
+    : dem_(dem), width_(width), height_(height), nodata_(nodata), horizon_(horizon),
+      calc_(timezoneOffset), grid_(geoTransform, width, height) {
+    std::memcpy(geoTransform_, geoTransform, sizeof(geoTransform_));
+    useTables_ = grid_.isSeparable() && !horizon_;
+    
+    // Zenith term of each pixel, shared by every day of every request
+    if (useTables_) {
+        size_t count = static_cast<size_t>(width) * height;
+        cosZenith_.resize(count);
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < count; ++i) {
+            cosZenith_[i] = isMasked(dem[i], nodata) ? std::nan("")
+                                                     : SolarCalculator::zenithCosine(dem[i]);
+        }
+    }
+    
+    size_t tileBytes = 2 * TILE_SIZE * TILE_SIZE * sizeof(int16_t);
+    cacheCapacity_ = std::max<size_t>(1, cacheBytes / tileBytes);
+}
+
+const SolarEphemeris& SolarService::yearEphemeris(int year) {
+    std::lock_guard<std::mutex> lock(ephemerisMutex_);
+    std::unique_ptr<SolarEphemeris>& table = ephemeris_[year];
+    if (!table) {
+        table.reset(new SolarEphemeris(year));
+    }
+    return *table;
+}
+
+std::shared_ptr<SolarService::Tile> SolarService::computeTile(int tileX, int tileY,
+                                                              const DayEphemeris& eph) const {
+    auto result = std::make_shared<Tile>();
+    result->sunrise.assign(TILE_SIZE * TILE_SIZE, -1);
+    result->sunset.assign(TILE_SIZE * TILE_SIZE, -1);
+    
+    int col0 = tileX * TILE_SIZE;
+    int row0 = tileY * TILE_SIZE;
+    int columns = std::min(TILE_SIZE, width_ - col0);
+    int rows = std::min(TILE_SIZE, height_ - row0);
+    
+    if (useTables_) {
+        double noon[TILE_SIZE];
+        grid_.solarNoonTable(eph, col0, columns, noon);
+        for (int r = 0; r < rows; ++r) {
+            double rowScale, rowOffset;
+            grid_.rowTerms(eph, row0 + r, rowScale, rowOffset);
+            calc_.computeRow(&cosZenith_[static_cast<size_t>(row0 + r) * width_ + col0], noon,
+                             rowScale, rowOffset, &result->sunrise[r * TILE_SIZE],
+                             &result->sunset[r * TILE_SIZE], columns);
+        }
+        return result;
+    }
+    
+    // Per-pixel solver: rotated geotransform or terrain horizon
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < columns; ++c) {
+            size_t index = static_cast<size_t>(row0 + r) * width_ + col0 + c;
+            float elevation = dem_[index];
+            if (isMasked(elevation, nodata_)) {
+                continue;
+            }
+            double lon = geoTransform_[0] + (col0 + c) * geoTransform_[1] + (row0 + r) * geoTransform_[2];
+            double lat = geoTransform_[3] + (col0 + c) * geoTransform_[4] + (row0 + r) * geoTransform_[5];
+            DayEvents events = horizon_
+                ? calc_.calculateDayEvents(eph, lat, lon, elevation, horizon_->pixel(index),
+                                           horizon_->numSectors())
+                : calc_.calculateDayEvents(eph, lat, lon, elevation);
+            toMinutes(events, result->sunrise[r * TILE_SIZE + c], result->sunset[r * TILE_SIZE + c]);
+        }
+    }
+    return result;
+}
+
+std::shared_ptr<const SolarService::Tile> SolarService::tile(int tileX, int tileY, const DayEphemeris& eph) {
+    uint64_t key = tileKey(tileX, tileY, eph);
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        auto found = tiles_.find(key);
+        if (found != tiles_.end()) {
+            lru_.splice(lru_.begin(), lru_, found->second.second);
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return found->second.first;
+        }
+    }
+    
+    // Computed outside the lock; two requests missing the same tile at once
+    // both compute it and the second insert is dropped
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    std::shared_ptr<const Tile> computed = computeTile(tileX, tileY, eph);
+    
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    if (tiles_.count(key)) {
+        return computed;
+    }
+    lru_.push_front(key);
+    tiles_.emplace(key, std::make_pair(computed, lru_.begin()));
+    while (tiles_.size() > cacheCapacity_) {
+        tiles_.erase(lru_.back());
+        lru_.pop_back();
+    }
+    return computed;
+}
+
+bool SolarService::query(double lon, double lat, const CalendarDate& start, const CalendarDate& end,
+                         std::vector<int16_t>& minutes, std::string& error) {
+    // Pixel of the point, inverse of the geotransform
+    const double* gt = geoTransform_;
+    double det = gt[1] * gt[5] - gt[2] * gt[4];
+    double dx = lon - gt[0];
+    double dy = lat - gt[3];
+    double x = det != 0.0 ? (gt[5] * dx - gt[2] * dy) / det : -1.0;
+    double y = det != 0.0 ? (gt[1] * dy - gt[4] * dx) / det : -1.0;
+    if (!(x >= 0.0 && y >= 0.0 && x < width_ && y < height_)) {
+        error = "point outside the DEM";
+        return false;
+    }
+    int column = static_cast<int>(x);
+    int row = static_cast<int>(y);
+    if (compareDates(end, start) || start.year < 1900 || end.year > 2100) {
+        error = "invalid date range";
+        return false;
+    }
+    
+    int tileX = column / TILE_SIZE;
+    int tileY = row / TILE_SIZE;
+    int offset = (row % TILE_SIZE) * TILE_SIZE + column % TILE_SIZE;
+    
+    minutes.clear();
+    for (int year = start.year; year <= end.year; ++year) {
+        const SolarEphemeris& table = yearEphemeris(year);
+        for (int i = 0; i < table.numDays(); ++i) {
+            const DayEphemeris& eph = table[i];
+            CalendarDate date = {eph.year, eph.month, eph.day};
+            if (compareDates(date, start) || compareDates(end, date)) {
+                continue;
+            }
+            std::shared_ptr<const Tile> cached = tile(tileX, tileY, eph);
+            minutes.push_back(cached->sunrise[offset]);
+            minutes.push_back(cached->sunset[offset]);
+        }
+    }
+    return true;
+}
+
+std::string SolarService::answer(const std::string& request) {
+    std::istringstream fields(request);
+    double lon, lat;
+    std::string startText, endText;
+    CalendarDate start, end;
+    if (!(fields >> lon >> lat >> startText) || !SolarEphemeris::parseDate(startText, start)) {
+        return "ERR expected LON LAT YYYY-MM-DD [YYYY-MM-DD]";
+    }
+    end = start;
+    if (fields >> endText && !SolarEphemeris::parseDate(endText, end)) {
+        return "ERR invalid end date";
+    }
+    
+    std::vector<int16_t> minutes;
+    std::string error;
+    if (!query(lon, lat, start, end, minutes, error)) {
+        return "ERR " + error;
+    }
+    std::string line = "OK " + std::to_string(minutes.size() / 2);
+    for (size_t i = 0; i < minutes.size(); i += 2) {
+        line += " " + std::to_string(minutes[i]) + "," + std::to_string(minutes[i + 1]);
+    }
+    return line;
+}
+
+bool SolarService::serve(FILE* in, FILE* out) {
+    char* buffer = nullptr;
+    size_t capacity = 0;
+    bool atEnd = false;
+    while (!atEnd) {
+        // Read one batch: lines up to an empty line or the end of input
+        std::vector<std::string> requests;
+        while (true) {
+            ssize_t length = getline(&buffer, &capacity, in);
+            if (length < 0) {
+                atEnd = true;
+                break;
+            }
+            std::string line(buffer, length);
+            while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.pop_back();
+            if (line.empty()) {
+                break;
+            }
+            requests.push_back(line);
+        }
+        if (requests.empty()) {
+            continue;
+        }
+        
+        std::vector<std::string> responses(requests.size());
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (size_t i = 0; i < requests.size(); ++i) {
+            responses[i] = answer(requests[i]);
+        }
+        
+        for (const std::string& response : responses) {
+            std::fputs(response.c_str(), out);
+            std::fputc('\n', out);
+        }
+        std::fputc('\n', out);
+        if (std::fflush(out) != 0) {
+            break;
+        }
+    }
+    std::free(buffer);
+    return true;
+}
+
+bool SolarService::serveSocket(const std::string& socketPath) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: Socket path too long: " << socketPath << std::endl;
+        return false;
+    }
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    
+    // A client leaving mid-batch must not stop the server
+    std::signal(SIGPIPE, SIG_IGN);
+    
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socketPath.c_str());
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listener, 16) != 0) {
+        std::cerr << "Error: Cannot listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+        if (listener >= 0) close(listener);
+        return false;
+    }
+    std::cerr << "Serving on " << socketPath << std::endl;
+    
+    while (true) {
+        int client = accept(listener, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Error: accept failed: " << std::strerror(errno) << std::endl;
+            close(listener);
+            return false;
+        }
+        
+        // One thread per client; the cache and tables are shared
+        NumaPlacement::ProcessMask processMask;
+        std::thread([this, client]() {
+            FILE* in = fdopen(dup(client), "r");
+            FILE* out = fdopen(client, "w");
+            if (in && out) {
+                serve(in, out);
+            }
+            if (in) std::fclose(in);
+            if (out) std::fclose(out);
+            else close(client);
+        }).detach();
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef SOLAR_SERVICE_H
+#define SOLAR_SERVICE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "SolarCalculator.h"
+#include "SolarEphemeris.h"
+#include "SolarGrid.h"
+#include "HorizonMap.h"
+
+/**
+ * SolarService class
+ * 
+ * Answers point/date requests on a DEM held in memory, computing only the
+ * days that are asked for. Results are computed one tile (TILE_SIZE^2
+ * pixels, one day) at a time and kept in an LRU cache, so neighbouring
+ * points and repeated dates cost a lookup.
+ * 
+ * The per-pixel zenith table (separable grids without horizon) and the
+ * ephemeris of each year are built once and stay resident.
+ * 
+ * Line protocol, one request per line, batches ended by an empty line:
+ * 
+ *   LON LAT YYYY-MM-DD [YYYY-MM-DD]
+ * 
+ * Each request gets one line, "OK N sunrise,sunset ..." with N days of
+ * minutes after local midnight (-1: no event or nodata), or "ERR message".
+ * A batch of responses also ends with an empty line; the requests of a
+ * batch are evaluated in parallel.
+ */
+class SolarService {
+public:
+    static constexpr int TILE_SIZE = 64;
+    
+    /**
+     * Constructor; the DEM and horizon must outlive the service
+     * @param dem Elevations, row-major
+     * @param horizon Terrain horizon of the DEM, or nullptr
+     * @param cacheBytes Memory of the tile cache
+     */
+    SolarService(const float* dem, int width, int height, const double* geoTransform, float nodata,
+                 const HorizonMap* horizon, double timezoneOffset, size_t cacheBytes);
+    
+    SolarService(const SolarService&) = delete;
+    SolarService& operator=(const SolarService&) = delete;
+    
+    /**
+     * Series of the pixel containing (lon, lat) for the days [start, end]
+     * @param minutes Output (sunrise, sunset) pairs, one per day
+     * @return false with error set if the point or dates are invalid
+     */
+    bool query(double lon, double lat, const CalendarDate& start, const CalendarDate& end,
+               std::vector<int16_t>& minutes, std::string& error);
+    
+    /**
+     * Answer batches read from in on out until end of input
+     */
+    bool serve(FILE* in, FILE* out);
+    
+    /**
+     * Listen on a Unix socket and serve each client from its own thread;
+     * returns only on error
+     */
+    bool serveSocket(const std::string& socketPath);
+    
+    uint64_t cacheHits() const { return hits_.load(std::memory_order_relaxed); }
+    uint64_t cacheMisses() const { return misses_.load(std::memory_order_relaxed); }
+
+private:
+    /**
+     * Sunrise and sunset minutes of one tile for one day
+     */
+    struct Tile {
+        std::vector<int16_t> sunrise;   // [row][column] of the tile
+        std::vector<int16_t> sunset;
+    };
+    
+    const float* dem_;
+    int width_;
+    int height_;
+    double geoTransform_[6];
+    float nodata_;
+    const HorizonMap* horizon_;
+    SolarCalculator calc_;
+    SolarGrid grid_;
+    bool useTables_;
+    std::vector<double> cosZenith_;   // NaN marks masked pixels
+    
+    // Ephemeris of each year asked for
+    std::mutex ephemerisMutex_;
+    std::map<int, std::unique_ptr<SolarEphemeris>> ephemeris_;
+    
+    // LRU tile cache, most recently used first
+    std::mutex cacheMutex_;
+    size_t cacheCapacity_;
+    std::list<uint64_t> lru_;
+    std::unordered_map<uint64_t, std::pair<std::shared_ptr<const Tile>, std::list<uint64_t>::iterator>> tiles_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    
+    const SolarEphemeris& yearEphemeris(int year);
+    std::shared_ptr<const Tile> tile(int tileX, int tileY, const DayEphemeris& eph);
+    std::shared_ptr<Tile> computeTile(int tileX, int tileY, const DayEphemeris& eph) const;
+    
+    /**
+     * Response line of one request line
+     */
+    std::string answer(const std::string& request);
+};
+
+#endif // SOLAR_SERVICE_H
@@ -0,0 +1,416 @@
+#include "StreamFormat.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef SOLAR_HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef SOLAR_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+const uint16_t STREAM_VERSION = 2;
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+const int16_t MISSING_VALUE = -1;
+
+// Header flags
+const uint16_t FLAG_ORDINAL_DAY_IDS = 1 << 0;
+const uint16_t FLAG_SPARSE = 1 << 1;
+
+enum ChunkContent : uint8_t {
+    CONTENT_BOTH = 0,
+    CONTENT_SUNRISE = 1,
+    CONTENT_SUNSET = 2
+};
+
+// Values per varint block; blocks are encoded in parallel, then joined
+const size_t VARINT_BLOCK_VALUES = 1 << 16;
+
+// 12-bit code of a value, 0xFFF for -1 (masked or polar)
+inline uint32_t twelveBits(int16_t value) {
+    return value < 0 ? 0xFFFu : static_cast<uint32_t>(value) & 0xFFFu;
+}
+
+inline void storeTwelveBits(unsigned char* out, uint32_t a, uint32_t b) {
+    out[0] = static_cast<unsigned char>(a);
+    out[1] = static_cast<unsigned char>((a >> 8) | (b << 4));
+    out[2] = static_cast<unsigned char>(b >> 4);
+}
+
+// Zigzag varints of values against previous (updated in place) into out;
+// returns the bytes written, at most 3 per value
+size_t varintRange(const int16_t* values, int16_t* previous, bool hasPrevious, size_t count,
+                   unsigned char* out) {
+    const size_t LANES = 16;
+    size_t pos = 0;
+    size_t i = 0;
+    for (; i < count; i += LANES) {
+        size_t lanes = std::min(LANES, count - i);
+        
+        // Branch-free over the lanes so that the compiler vectorizes it
+        uint16_t zigzag[LANES];
+        uint16_t any = 0;
+        for (size_t k = 0; k < lanes; ++k) {
+            uint16_t base = hasPrevious ? static_cast<uint16_t>(previous[i + k]) : 0;
+            int16_t delta = static_cast<int16_t>(static_cast<uint16_t>(values[i + k]) - base);
+            zigzag[k] = static_cast<uint16_t>((static_cast<uint16_t>(delta) << 1) ^
+                                              static_cast<uint16_t>(delta >> 15));
+            previous[i + k] = values[i + k];
+            any |= zigzag[k];
+        }
+        
+        // Typical day-to-day changes are a few units: one byte each
+        if (any < 0x80) {
+            for (size_t k = 0; k < lanes; ++k) {
+                out[pos + k] = static_cast<unsigned char>(zigzag[k]);
+            }
+            pos += lanes;
+            continue;
+        }
+        for (size_t k = 0; k < lanes; ++k) {
+            uint32_t value = zigzag[k];
+            while (value >= 0x80) {
+                out[pos++] = static_cast<unsigned char>(value | 0x80);
+                value >>= 7;
+            }
+            out[pos++] = static_cast<unsigned char>(value);
+        }
+    }
+    return pos;
+}
+
+// Appends native-endian fields to a byte buffer
+class ByteWriter {
+public:
+    explicit ByteWriter(std::vector<char>& out) : out_(out) { out_.clear(); }
+    
+    template <typename T>
+    void put(T value) {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        out_.insert(out_.end(), bytes, bytes + sizeof(T));
+    }
+    
+    void putBytes(const void* data, size_t bytes) {
+        const char* begin = static_cast<const char*>(data);
+        out_.insert(out_.end(), begin, begin + bytes);
+    }
+
+private:
+    std::vector<char>& out_;
+};
+
+// Slicing-by-8 tables for the reflected 0xEDB88320 polynomial
+struct Crc32Tables {
+    uint32_t table[8][256];
+    
+    Crc32Tables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int t = 1; t < 8; ++t) {
+                table[t][i] = (table[t - 1][i] >> 8) ^ table[0][table[t - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+const Crc32Tables& crcTables() {
+    static const Crc32Tables tables;
+    return tables;
+}
+
+} // namespace
+
+StreamEncoder::StreamEncoder(StreamCompression compression, int level, size_t segmentBytes)
+    : compression_(compression), level_(level),
+      segmentBytes_(std::max<size_t>(segmentBytes, 4096) & ~size_t(1)),
+      hasPrevious_(false) {}
+
+bool StreamEncoder::isAvailable(StreamCompression compression) {
+    switch (compression) {
+        case StreamCompression::None:
+            return true;
+        case StreamCompression::LZ4:
+#ifdef SOLAR_HAVE_LZ4
+            return true;
+#else
+            return false;
+#endif
+        case StreamCompression::Zstd:
+#ifdef SOLAR_HAVE_ZSTD
+            return true;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+const char* StreamEncoder::compressionName(StreamCompression compression) {
+    switch (compression) {
+        case StreamCompression::None: return "none";
+        case StreamCompression::LZ4: return "lz4";
+        case StreamCompression::Zstd: return "zstd";
+    }
+    return "unknown";
+}
+
+const char* StreamEncoder::encodingName(StreamEncoding encoding) {
+    switch (encoding) {
+        case StreamEncoding::Raw: return "raw";
+        case StreamEncoding::Delta: return "delta";
+        case StreamEncoding::Packed12: return "packed12";
+        case StreamEncoding::Varint: return "varint";
+    }
+    return "unknown";
+}
+
+size_t StreamEncoder::packTwelveBits(const int16_t* first, const int16_t* second, size_t pixelCount) {
+    // Both arrays: one pair per pixel; one array: pairs of consecutive pixels
+    size_t pairs = second ? pixelCount : pixelCount / 2;
+    size_t bytes = (second ? pixelCount : (pixelCount + 1) / 2) * 3;
+    packed_.resize(bytes);
+    unsigned char* out = packed_.data();
+    
+    if (second) {
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < pairs; ++i) {
+            storeTwelveBits(out + 3 * i, twelveBits(first[i]), twelveBits(second[i]));
+        }
+    } else {
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < pairs; ++i) {
+            storeTwelveBits(out + 3 * i, twelveBits(first[2 * i]), twelveBits(first[2 * i + 1]));
+        }
+        if (pixelCount % 2) {
+            storeTwelveBits(out + 3 * pairs, twelveBits(first[pixelCount - 1]), 0xFFFu);
+        }
+    }
+    return bytes;
+}
+
+size_t StreamEncoder::encodeVarints(const int16_t* first, const int16_t* second, size_t pixelCount) {
+    // Blocks of each array, encoded in parallel into worst-case slots
+    size_t blocksPerArray = (pixelCount + VARINT_BLOCK_VALUES - 1) / VARINT_BLOCK_VALUES;
+    size_t numBlocks = blocksPerArray * (second ? 2 : 1);
+    size_t slotBytes = VARINT_BLOCK_VALUES * 3;
+    packed_.resize(numBlocks * slotBytes);
+    std::vector<size_t> blockBytes(numBlocks);
+    
+    #pragma omp parallel for schedule(static)
+    for (size_t b = 0; b < numBlocks; ++b) {
+        size_t array = b / blocksPerArray;
+        size_t begin = (b % blocksPerArray) * VARINT_BLOCK_VALUES;
+        size_t count = std::min(VARINT_BLOCK_VALUES, pixelCount - begin);
+        const int16_t* values = (array == 0 ? first : second) + begin;
+        blockBytes[b] = varintRange(values, &previous_[array * pixelCount + begin], hasPrevious_,
+                                    count, packed_.data() + b * slotBytes);
+    }
+    
+    // Join the blocks; each moves towards the front, after the previous one
+    size_t bytes = 0;
+    for (size_t b = 0; b < numBlocks; ++b) {
+        std::memmove(packed_.data() + bytes, packed_.data() + b * slotBytes, blockBytes[b]);
+        bytes += blockBytes[b];
+    }
+    return bytes;
+}
+
+uint32_t StreamEncoder::crc32(const void* data, size_t bytes, uint32_t crc) {
+    const auto& t = crcTables().table;
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+    
+    while (bytes >= 8) {
+        uint32_t lo, hi;
+        std::memcpy(&lo, p, 4);
+        std::memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        p += 8;
+        bytes -= 8;
+    }
+    while (bytes-- > 0) {
+        crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void StreamEncoder::encodeHeader(const StreamHeaderInfo& info, StreamEncoding encoding,
+                                 StreamFrame& frame) const {
+    frame.parts.resize(1);
+    ByteWriter out(frame.parts[0]);
+    
+    out.putBytes("SUNCAST2", 8);
+    out.put<uint32_t>(BYTE_ORDER_MARK);
+    out.put<uint16_t>(STREAM_VERSION);
+    out.put<uint16_t>((info.ordinalDayIds ? FLAG_ORDINAL_DAY_IDS : 0) | (info.sparse ? FLAG_SPARSE : 0));
+    out.put<int32_t>(info.width);
+    out.put<int32_t>(info.height);
+    out.put<int32_t>(info.numDays);
+    out.put<int32_t>(info.year);
+    out.put<int32_t>(info.firstDayOfYear);
+    out.putBytes(info.geoTransform, 6 * sizeof(double));
+    out.put<double>(info.timezoneOffset);
+    out.put<double>(info.demNodata);
+    out.put<uint16_t>(info.timeResolutionSeconds);
+    out.put<int16_t>(MISSING_VALUE);
+    out.put<uint8_t>(static_cast<uint8_t>(compression_));
+    out.put<uint8_t>(static_cast<uint8_t>(encoding));
+    out.put<uint16_t>(0);  // reserved
+    out.put<uint32_t>(static_cast<uint32_t>(segmentBytes_));
+    out.put<uint32_t>(static_cast<uint32_t>(info.crsWkt.size()));
+    out.putBytes(info.crsWkt.data(), info.crsWkt.size());
+    
+    if (info.sparse) {
+        uint64_t validPixels = 0;
+        for (size_t r = 1; r < info.maskRuns.size(); r += 2) {
+            validPixels += info.maskRuns[r];
+        }
+        out.put<uint64_t>(validPixels);
+        out.put<uint32_t>(static_cast<uint32_t>(info.maskRuns.size()));
+        out.putBytes(info.maskRuns.data(), info.maskRuns.size() * sizeof(uint32_t));
+    }
+    
+    const std::vector<char>& header = frame.parts[0];
+    out.put<uint32_t>(crc32(header.data(), header.size()));
+}
+
+void StreamEncoder::encodeEnd(StreamFrame& frame) const {
+    frame.parts.resize(1);
+    ByteWriter out(frame.parts[0]);
+    out.putBytes("CHNK", 4);
+    out.put<int32_t>(0);
+    out.put<uint8_t>(CONTENT_BOTH);
+    out.put<uint8_t>(static_cast<uint8_t>(StreamEncoding::Raw));
+    out.put<uint8_t>(static_cast<uint8_t>(StreamCompression::None));
+    out.put<uint8_t>(0);
+    out.put<uint64_t>(0);
+    out.put<uint64_t>(0);
+    out.put<uint32_t>(0);
+}
+
+size_t StreamEncoder::storeSegment(const char* src, size_t bytes, std::vector<char>& dst) const {
+    switch (compression_) {
+#ifdef SOLAR_HAVE_LZ4
+        case StreamCompression::LZ4: {
+            dst.resize(LZ4_compressBound(static_cast<int>(bytes)));
+            int stored = LZ4_compress_default(src, dst.data(), static_cast<int>(bytes),
+                                              static_cast<int>(dst.size()));
+            if (stored > 0) {
+                dst.resize(stored);
+                return dst.size();
+            }
+            break;
+        }
+#endif
+#ifdef SOLAR_HAVE_ZSTD
+        case StreamCompression::Zstd: {
+            dst.resize(ZSTD_compressBound(bytes));
+            size_t stored = ZSTD_compress(dst.data(), dst.size(), src, bytes, level_);
+            if (!ZSTD_isError(stored)) {
+                dst.resize(stored);
+                return dst.size();
+            }
+            break;
+        }
+#endif
+        default:
+            break;
+    }
+    
+    dst.assign(src, src + bytes);
+    return dst.size();
+}
+
+void StreamEncoder::encodeChunk(int32_t dayOfYear, const int16_t* sunrise, const int16_t* sunset,
+                                uint64_t pixelOffset, uint64_t pixelCount, StreamEncoding encoding,
+                                StreamFrame& frame) {
+    uint8_t content = CONTENT_BOTH;
+    if (!sunset) content = CONTENT_SUNRISE;
+    else if (!sunrise) content = CONTENT_SUNSET;
+    
+    size_t arrays = (content == CONTENT_BOTH) ? 2 : 1;
+    size_t values = static_cast<size_t>(pixelCount) * arrays;
+    const int16_t* first = sunrise ? sunrise : sunset;
+    const int16_t* second = (content == CONTENT_BOTH) ? sunset : nullptr;
+    
+    if (usesPreviousDay(encoding) && previous_.size() != values) {
+        previous_.assign(values, 0);
+        hasPrevious_ = false;
+    }
+    
+    // Gather the payload in the chunk's encoding
+    const char* raw;
+    size_t rawBytes;
+    if (encoding == StreamEncoding::Delta) {
+        encoded_.resize(values);
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < values; ++i) {
+            int16_t value = (i < pixelCount) ? first[i] : second[i - pixelCount];
+            uint16_t base = hasPrevious_ ? static_cast<uint16_t>(previous_[i]) : 0;
+            encoded_[i] = static_cast<int16_t>(static_cast<uint16_t>(value) - base);
+            previous_[i] = value;
+        }
+        hasPrevious_ = true;
+        raw = reinterpret_cast<const char*>(encoded_.data());
+        rawBytes = values * sizeof(int16_t);
+    } else if (encoding == StreamEncoding::Packed12) {
+        rawBytes = packTwelveBits(first, second, pixelCount);
+        raw = reinterpret_cast<const char*>(packed_.data());
+    } else if (encoding == StreamEncoding::Varint) {
+        rawBytes = encodeVarints(first, second, pixelCount);
+        hasPrevious_ = true;
+        raw = reinterpret_cast<const char*>(packed_.data());
+    } else if (content == CONTENT_BOTH) {
+        // Sunrise and sunset arrays are separate; concatenate them
+        encoded_.resize(values);
+        std::memcpy(encoded_.data(), sunrise, pixelCount * sizeof(int16_t));
+        std::memcpy(encoded_.data() + pixelCount, sunset, pixelCount * sizeof(int16_t));
+        raw = reinterpret_cast<const char*>(encoded_.data());
+        rawBytes = values * sizeof(int16_t);
+    } else {
+        raw = reinterpret_cast<const char*>(first);
+        rawBytes = values * sizeof(int16_t);
+    }
+    
+    size_t numSegments = (rawBytes + segmentBytes_ - 1) / segmentBytes_;
+    
+    // Part 0 is the chunk header, parts 1..n the stored segments
+    frame.parts.resize(numSegments + 1);
+    std::vector<uint32_t> storedBytes(numSegments), crcs(numSegments);
+    
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t s = 0; s < numSegments; ++s) {
+        size_t offset = s * segmentBytes_;
+        size_t bytes = std::min(segmentBytes_, rawBytes - offset);
+        std::vector<char>& stored = frame.parts[s + 1];
+        storedBytes[s] = static_cast<uint32_t>(storeSegment(raw + offset, bytes, stored));
+        crcs[s] = crc32(stored.data(), stored.size());
+    }
+    
+    ByteWriter out(frame.parts[0]);
+    out.putBytes("CHNK", 4);
+    out.put<int32_t>(dayOfYear);
+    out.put<uint8_t>(content);
+    out.put<uint8_t>(static_cast<uint8_t>(encoding));
+    out.put<uint8_t>(static_cast<uint8_t>(compression_));
+    out.put<uint8_t>(0);
+    out.put<uint64_t>(pixelOffset);
+    out.put<uint64_t>(pixelCount);
+    out.put<uint32_t>(static_cast<uint32_t>(numSegments));
+    for (size_t s = 0; s < numSegments; ++s) {
+        size_t bytes = std::min(segmentBytes_, rawBytes - s * segmentBytes_);
+        out.put<uint32_t>(static_cast<uint32_t>(bytes));
+        out.put<uint32_t>(storedBytes[s]);
+        out.put<uint32_t>(crcs[s]);
+    }
+}
@@ -0,0 +1,187 @@
+#ifndef STREAM_FORMAT_H
+#define STREAM_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "StreamWriter.h"
+
+/**
+ * Binary stream format written by DemProcessor::streamBinaryOutput
+ */
+enum class StreamFormat {
+    V1,   // "SOLAR" header followed by raw Int16 day arrays
+    V2    // Versioned header and checksummed, optionally compressed chunks
+};
+
+/**
+ * Compression of v2 chunk segments (values are part of the format)
+ */
+enum class StreamCompression : uint8_t {
+    None = 0,
+    LZ4 = 1,
+    Zstd = 2
+};
+
+/**
+ * Value encoding of v2 chunks (values are part of the format)
+ */
+enum class StreamEncoding : uint8_t {
+    Raw = 0,        // Int16 values
+    Delta = 1,      // Int16 difference to the previous day, modulo 2^16
+    Packed12 = 2,   // Two 12-bit values in 3 bytes
+    Varint = 3      // Zigzag varint of the difference to the previous day
+};
+
+/**
+ * Raster and time metadata carried by the v2 header
+ */
+struct StreamHeaderInfo {
+    int32_t width = 0;
+    int32_t height = 0;
+    int32_t numDays = 0;
+    int32_t year = 0;
+    int32_t firstDayOfYear = 1;
+    bool ordinalDayIds = false;   // Day ids are YYYYDDD (date ranges)
+    bool sparse = false;          // Chunks carry only the valid pixels of maskRuns
+    std::vector<uint32_t> maskRuns;  // Alternating masked/valid run lengths (see ValidSpans)
+    double geoTransform[6] = {0, 1, 0, 0, 0, -1};
+    double timezoneOffset = 0.0;
+    double demNodata = 0.0;
+    uint16_t timeResolutionSeconds = 60;   // Unit of the values
+    std::string crsWkt;
+};
+
+/**
+ * StreamEncoder class
+ * 
+ * Serializes the v2 stream ("SUNCAST2"):
+ * 
+ *   Header: magic[8] "SUNCAST2", uint32 0x01020304 (byte order mark),
+ *           uint16 version, uint16 flags, int32 width, height, numDays,
+ *           year, firstDayOfYear, double geoTransform[6], timezoneOffset,
+ *           demNodata, uint16 timeResolutionSeconds, int16 missingValue,
+ *           uint8 compression, uint8 encoding, uint16 reserved,
+ *           uint32 segmentBytes, uint32 crsLength, char crs[crsLength],
+ *           sparse only: uint64 validPixels, uint32 numRuns, uint32 runs[numRuns],
+ *           uint32 crc32 of all preceding header bytes.
+ * 
+ *           Flags: bit 0 = day ids are year * 1000 + day of year (date ranges),
+ *                  bit 1 = sparse.
+ * 
+ *           Sparse streams omit masked pixels. runs is the raster-order RLE
+ *           of the mask: run lengths alternating masked and valid, starting
+ *           with a (possibly empty) masked run. Chunk pixel offsets and
+ *           counts then index the validPixels packed values.
+ * 
+ *   Chunk:  magic[4] "CHNK", int32 day id (0 = end of stream),
+ *           uint8 content (0 = sunrise then sunset, 1 = sunrise, 2 = sunset),
+ *           uint8 encoding (StreamEncoding),
+ *           uint8 compression, uint8 reserved, uint64 pixelOffset,
+ *           uint64 pixelCount, uint32 numSegments, then per segment
+ *           uint32 rawBytes, uint32 storedBytes, uint32 crc32 (of stored bytes),
+ *           followed by the stored segments.
+ * 
+ * Values are Int16 time units (timeResolutionSeconds, 60 = minutes)
+ * after local midnight, -1 when masked or polar. The payload of a chunk,
+ * before it is cut into segments, depends on its encoding:
+ * 
+ *   raw       native-endian Int16 values, the sunrise array then the sunset array;
+ *   delta     the same, holding (value - previous day value) modulo 2^16;
+ *   packed12  3 bytes per pair of 12-bit values a | b << 12 (little-endian),
+ *             with 0xFFF for -1: (sunrise, sunset) of each pixel, or two
+ *             consecutive pixels in single-content chunks (0xFFF pads the last);
+ *   varint    for each value of the raw order, d = (value - previous day value)
+ *             modulo 2^16 as int16, zigzag-coded (d << 1) ^ (d >> 15), in
+ *             little-endian base-128 groups of 7 bits, high bit set on all
+ *             but the last byte (1 to 3 bytes).
+ * 
+ * Delta and varint chunks count from 0 on the first day of a stream.
+ * Segments are compressed independently and in parallel.
+ */
+class StreamEncoder {
+public:
+    /**
+     * Constructor
+     * @param compression Segment compression
+     * @param level Compression level (zstd; ignored otherwise)
+     * @param segmentBytes Raw bytes per independently compressed segment
+     */
+    explicit StreamEncoder(StreamCompression compression = StreamCompression::None,
+                           int level = 3,
+                           size_t segmentBytes = 1 << 20);
+    
+    /**
+     * True if this build can write the given compression
+     */
+    static bool isAvailable(StreamCompression compression);
+    
+    static const char* compressionName(StreamCompression compression);
+    static const char* encodingName(StreamEncoding encoding);
+    
+    /**
+     * True for the encodings relative to the previous day, which need
+     * full-raster chunks
+     */
+    static bool usesPreviousDay(StreamEncoding encoding) {
+        return encoding == StreamEncoding::Delta || encoding == StreamEncoding::Varint;
+    }
+    
+    // Largest value packed12 can store (0xFFF marks -1)
+    static constexpr int PACKED12_MAX = 0xFFE;
+    
+    /**
+     * Fill a frame with the v2 header
+     * @param encoding Default chunk encoding advertised in the header
+     */
+    void encodeHeader(const StreamHeaderInfo& info, StreamEncoding encoding, StreamFrame& frame) const;
+    
+    /**
+     * Fill a frame with one chunk
+     * @param sunrise Sunrise values (nullptr for a sunset-only chunk)
+     * @param sunset Sunset values (nullptr for a sunrise-only chunk)
+     * @param pixelOffset Index of the first pixel in the raster (sparse: in the packed values)
+     * @param pixelCount Number of pixels
+     * @param encoding Value encoding; delta and varint encode against the
+     *                 values passed for the previous day and are only valid
+     *                 for full-raster chunks
+     */
+    void encodeChunk(int32_t dayOfYear, const int16_t* sunrise, const int16_t* sunset,
+                     uint64_t pixelOffset, uint64_t pixelCount, StreamEncoding encoding,
+                     StreamFrame& frame);
+    
+    /**
+     * Fill a frame with the end-of-stream marker
+     */
+    void encodeEnd(StreamFrame& frame) const;
+    
+    /**
+     * Standard CRC-32 (as zlib.crc32)
+     */
+    static uint32_t crc32(const void* data, size_t bytes, uint32_t crc = 0);
+
+private:
+    StreamCompression compression_;
+    int level_;
+    size_t segmentBytes_;
+    
+    // Previous day values for delta and varint chunks, and encoding scratch
+    std::vector<int16_t> previous_;
+    std::vector<int16_t> encoded_;
+    std::vector<unsigned char> packed_;
+    bool hasPrevious_;
+    
+    /**
+     * Encode one chunk's arrays (second may be null) into packed_; return its size
+     */
+    size_t packTwelveBits(const int16_t* first, const int16_t* second, size_t pixelCount);
+    size_t encodeVarints(const int16_t* first, const int16_t* second, size_t pixelCount);
+    
+    /**
+     * Compress (or copy) src into dst; returns stored size
+     */
+    size_t storeSegment(const char* src, size_t bytes, std::vector<char>& dst) const;
+};
+
+#endif // STREAM_FORMAT_H
@@ -0,0 +1,136 @@
+#include "StreamWriter.h"
+#include "NumaPlacement.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <climits>
+#include <iostream>
+#include <poll.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+StreamWriter::StreamWriter(int fd, int depth, RunMetrics* metrics)
+    : fd_(fd), frames_(std::max(depth, 1)), stopping_(false), failed_(false), metrics_(metrics) {
+    for (StreamFrame& frame : frames_) {
+        freeFrames_.push_back(&frame);
+    }
+    // Not pinned to the node of the OpenMP thread that creates it
+    NumaPlacement::ProcessMask processMask;
+    thread_ = std::thread(&StreamWriter::run, this);
+}
+
+StreamWriter::~StreamWriter() {
+    finish();
+}
+
+StreamFrame* StreamWriter::acquire() {
+    RunMetrics::Timer timer(metrics_, MetricPhase::FrameWait);
+    std::unique_lock<std::mutex> lock(mutex_);
+    frameFreed_.wait(lock, [this] { return !freeFrames_.empty() || failed_; });
+    if (failed_) {
+        return nullptr;
+    }
+    StreamFrame* frame = freeFrames_.front();
+    freeFrames_.pop_front();
+    return frame;
+}
+
+void StreamWriter::submit(StreamFrame* frame) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(frame);
+    }
+    frameQueued_.notify_one();
+}
+
+bool StreamWriter::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    frameQueued_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    return !failed_;
+}
+
+void StreamWriter::run() {
+    for (;;) {
+        StreamFrame* frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            frameQueued_.wait(lock, [this] { return !pending_.empty() || stopping_; });
+            if (pending_.empty()) {
+                return;
+            }
+            frame = pending_.front();
+            pending_.pop_front();
+        }
+        
+        bool ok = writeFrame(*frame);
+        
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!ok) {
+                failed_ = true;
+                pending_.clear();
+            }
+            freeFrames_.push_back(frame);
+        }
+        frameFreed_.notify_one();
+        
+        if (!ok) {
+            return;
+        }
+    }
+}
+
+bool StreamWriter::writeFrame(const StreamFrame& frame) {
+    std::vector<iovec> iov;
+    iov.reserve(frame.parts.size());
+    for (const std::vector<char>& part : frame.parts) {
+        if (!part.empty()) {
+            iov.push_back({const_cast<char*>(part.data()), part.size()});
+        }
+    }
+    
+    // writev may write partially (pipes) and accepts at most IOV_MAX entries
+    size_t first = 0;
+    while (first < iov.size()) {
+        // With metrics, waits for a reader draining a full pipe are timed apart
+        if (metrics_) {
+            pollfd ready = {fd_, POLLOUT, 0};
+            if (::poll(&ready, 1, 0) == 0) {
+                RunMetrics::Timer blocked(metrics_, MetricPhase::PipeBlocked);
+                ::poll(&ready, 1, -1);
+            }
+        }
+        
+        int count = static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX));
+        ssize_t written;
+        {
+            RunMetrics::Timer timer(metrics_, MetricPhase::Write);
+            written = ::writev(fd_, &iov[first], count);
+        }
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Error: stream write failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        
+        size_t remaining = static_cast<size_t>(written);
+        if (metrics_) {
+            metrics_->addBytes(remaining);
+        }
+        while (first < iov.size() && remaining >= iov[first].iov_len) {
+            remaining -= iov[first].iov_len;
+            first++;
+        }
+        if (remaining > 0) {
+            iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + remaining;
+            iov[first].iov_len -= remaining;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,95 @@
+#ifndef STREAM_WRITER_H
+#define STREAM_WRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "RunMetrics.h"
+
+/**
+ * Frame of stream output
+ * 
+ * Parts are written in order with a single writev call. Their
+ * capacity is kept when the frame is recycled.
+ */
+struct StreamFrame {
+    std::vector<std::vector<char>> parts;
+    
+    /**
+     * Resize part i to hold count elements of T and return its data
+     */
+    template <typename T>
+    T* part(size_t i, size_t count) {
+        if (parts.size() <= i) parts.resize(i + 1);
+        parts[i].resize(count * sizeof(T));
+        return reinterpret_cast<T*>(parts[i].data());
+    }
+};
+
+/**
+ * StreamWriter class
+ * 
+ * Writes frames to a file descriptor from a dedicated thread, using a
+ * fixed pool of rotating frames. The compute threads fill frame N+1
+ * while frame N is being written, so a slow reader on the other end
+ * of the pipe no longer stalls computation until the pool is full.
+ */
+class StreamWriter {
+public:
+    /**
+     * Constructor
+     * @param fd Output file descriptor (stdout by default)
+     * @param depth Number of frames in the pool (1 = no overlap)
+     * @param metrics Records frame waits, pipe stalls, write time and bytes, or nullptr
+     */
+    explicit StreamWriter(int fd = 1, int depth = 2, RunMetrics* metrics = nullptr);
+    
+    /**
+     * Destructor, waits for pending frames
+     */
+    ~StreamWriter();
+    
+    StreamWriter(const StreamWriter&) = delete;
+    StreamWriter& operator=(const StreamWriter&) = delete;
+    
+    /**
+     * Get a free frame, blocking while all frames are queued or being written
+     * @return Frame to fill, or nullptr after a write error
+     */
+    StreamFrame* acquire();
+    
+    /**
+     * Queue a filled frame for writing
+     */
+    void submit(StreamFrame* frame);
+    
+    /**
+     * Write all queued frames and stop the writer thread
+     * @return true if every frame was written completely
+     */
+    bool finish();
+    
+    int depth() const { return static_cast<int>(frames_.size()); }
+    
+private:
+    int fd_;
+    std::vector<StreamFrame> frames_;
+    std::deque<StreamFrame*> freeFrames_;
+    std::deque<StreamFrame*> pending_;
+    std::mutex mutex_;
+    std::condition_variable frameFreed_;
+    std::condition_variable frameQueued_;
+    bool stopping_;
+    bool failed_;
+    RunMetrics* metrics_;
+    std::thread thread_;
+    
+    void run();
+    bool writeFrame(const StreamFrame& frame);
+};
+
+#endif // STREAM_WRITER_H
@@ -0,0 +1,17 @@
+#include "ThreadBudget.h"
+#include <algorithm>
+
+ThreadBudget::ThreadBudget(int threads)
+    : total_(std::max(threads, 1)), available_(total_) {}
+
+int ThreadBudget::acquire(int wanted) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int granted = std::max(1, std::min(wanted, available_));
+    available_ -= granted;
+    return granted;
+}
+
+void ThreadBudget::release(int threads) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    available_ += threads;
+}
@@ -0,0 +1,46 @@
+#ifndef THREAD_BUDGET_H
+#define THREAD_BUDGET_H
+
+#include <mutex>
+
+/**
+ * ThreadBudget class
+ * 
+ * Count of threads shared by concurrent jobs. Each unit of work (a
+ * GeoTIFF block) takes threads when it starts and returns them when it
+ * ends, so threads freed by a finished job go to the next blocks of the
+ * jobs still running instead of sitting idle.
+ * 
+ * Thread-safe.
+ */
+class ThreadBudget {
+public:
+    /**
+     * Constructor
+     * @param threads Total number of threads to share
+     */
+    explicit ThreadBudget(int threads);
+    
+    /**
+     * Take up to wanted threads
+     * 
+     * Never blocks: returns at least one thread so that work always
+     * progresses, even if the budget is exhausted.
+     * @return Number of threads granted, to be passed back to release
+     */
+    int acquire(int wanted);
+    
+    /**
+     * Return threads obtained from acquire
+     */
+    void release(int threads);
+    
+    int total() const { return total_; }
+    
+private:
+    int total_;
+    int available_;   // Negative while more threads are in use than the total
+    std::mutex mutex_;
+};
+
+#endif // THREAD_BUDGET_H
@@ -0,0 +1,156 @@
+#ifndef VALID_SPANS_H
+#define VALID_SPANS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * ValidSpans class
+ * 
+ * Run-length index of the valid pixels of a band of raster rows. DEMs
+ * clipped to a department polygon are largely nodata (about 40% in the
+ * Alps), so static scheduling over flat pixel indices leaves threads
+ * with unequal work. Iterating the spans skips nodata entirely; dynamic
+ * scheduling, or partition() when the same thread must get the same
+ * pixels in every loop, balances the valid pixels between threads.
+ * 
+ * Long runs are cut at MAX_SPAN_PIXELS so that spans are comparable
+ * work units. The masked runs (gaps) are kept too, so that outputs are
+ * filled with the masked value without scanning the DEM again.
+ * 
+ * Packed (sparse) outputs store only the valid pixels, in raster order;
+ * Span::packed locates a span in such a buffer.
+ */
+class ValidSpans {
+public:
+    /**
+     * Run of consecutive pixels on one row
+     */
+    struct Span {
+        int row;      // Row relative to the first indexed row
+        int begin;    // First column
+        int length;   // Number of pixels
+        size_t packed; // Valid pixels before the span, in raster order
+        
+        size_t offset(int width) const { return static_cast<size_t>(row) * width + begin; }
+    };
+    
+    // Upper bound of a valid span (one dynamic scheduling unit)
+    static constexpr int MAX_SPAN_PIXELS = 2048;
+    
+    /**
+     * Index rows [0, numRows) of a row-major band; built serially, the
+     * scan is cheap next to one day of computation
+     * @param masked Predicate on the elevation, true for masked pixels
+     */
+    template <typename Masked>
+    void build(const float* dem, int width, int numRows, Masked masked) {
+        width_ = width;
+        numRows_ = numRows;
+        valid_.clear();
+        gaps_.clear();
+        validPixels_ = 0;
+        
+        for (int row = 0; row < numRows; ++row) {
+            const float* line = dem + static_cast<size_t>(row) * width;
+            int col = 0;
+            while (col < width) {
+                bool isMasked = masked(line[col]);
+                int end = col + 1;
+                while (end < width && masked(line[end]) == isMasked) ++end;
+                
+                if (isMasked) {
+                    gaps_.push_back({row, col, end - col, validPixels_});
+                } else {
+                    for (int begin = col; begin < end; begin += MAX_SPAN_PIXELS) {
+                        valid_.push_back({row, begin, std::min(MAX_SPAN_PIXELS, end - begin),
+                                          validPixels_ + (begin - col)});
+                    }
+                    validPixels_ += end - col;
+                }
+                col = end;
+            }
+        }
+    }
+    
+    /**
+     * Valid runs, in raster order
+     */
+    const std::vector<Span>& valid() const { return valid_; }
+    
+    /**
+     * Masked runs, in raster order
+     */
+    const std::vector<Span>& gaps() const { return gaps_; }
+    
+    size_t validPixels() const { return validPixels_; }
+    
+    /**
+     * Valid spans [first, last) of part of parts (thread part of a team),
+     * cut at equal counts of valid pixels. The partition depends only on
+     * the index, so loops over the same band give each thread the same
+     * pixels, hence the pages it touched first (NUMA locality).
+     */
+    void partition(int part, int parts, size_t& first, size_t& last) const {
+        auto bound = [this, parts](int p) {
+            size_t target = validPixels_ * p / parts;
+            return static_cast<size_t>(std::lower_bound(valid_.begin(), valid_.end(), target,
+                [](const Span& span, size_t value) { return span.packed < value; }) - valid_.begin());
+        };
+        first = bound(part);
+        last = part + 1 >= parts ? valid_.size() : bound(part + 1);
+    }
+    int width() const { return width_; }
+    int numRows() const { return numRows_; }
+    
+    /**
+     * Append the indexed rows to a raster-order mask RLE
+     * 
+     * runs alternates masked and valid run lengths and starts with a
+     * masked run (possibly empty); runs continue across rows and calls,
+     * so the strips of a raster can be appended in order.
+     */
+    void appendMaskRuns(std::vector<uint32_t>& runs) const {
+        size_t g = 0, v = 0;
+        while (g < gaps_.size() || v < valid_.size()) {
+            // Next span in raster order
+            bool takeGap = v >= valid_.size() ||
+                (g < gaps_.size() && gaps_[g].offset(width_) < valid_[v].offset(width_));
+            const Span& span = takeGap ? gaps_[g++] : valid_[v++];
+            
+            // Even entries are masked runs, odd entries valid runs
+            size_t type = takeGap ? 0 : 1;
+            if (runs.empty() && type == 1) {
+                runs.push_back(0);
+            }
+            if (!runs.empty() && (runs.size() - 1) % 2 == type) {
+                runs.back() += static_cast<uint32_t>(span.length);
+            } else {
+                runs.push_back(static_cast<uint32_t>(span.length));
+            }
+        }
+    }
+    
+    /**
+     * Set every masked pixel of a row-major buffer to value
+     */
+    template <typename T>
+    void fillMasked(T* out, T value) const {
+        #pragma omp parallel for schedule(static)
+        for (size_t g = 0; g < gaps_.size(); ++g) {
+            T* run = out + gaps_[g].offset(width_);
+            std::fill(run, run + gaps_[g].length, value);
+        }
+    }
+
+private:
+    int width_ = 0;
+    int numRows_ = 0;
+    size_t validPixels_ = 0;
+    std::vector<Span> valid_;
+    std::vector<Span> gaps_;
+};
+
+#endif // VALID_SPANS_H
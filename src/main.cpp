@@ -1,7 +1,51 @@
 #include <iostream>
 #include <string>
 #include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <vector>
 #include "ProcessDEM.h"
+#include "ParquetOutput.h"
+#include "GpuSolver.h"
+#include "ResultCube.h"
+#include "JobManifest.h"
+#include "RunMetrics.h"
+#include "NumaPlacement.h"
+
+// Parse a byte count with an optional K/M/G/T suffix (powers of 1024); returns 0 on error
+size_t parseMemorySize(const std::string& text) {
+    char* end = nullptr;
+    double value = std::strtod(text.c_str(), &end);
+    if (end == text.c_str() || value <= 0.0) {
+        return 0;
+    }
+    
+    std::string suffix(end);
+    double scale = 1.0;
+    if (suffix == "K" || suffix == "k") scale = 1024.0;
+    else if (suffix == "M" || suffix == "m") scale = 1024.0 * 1024.0;
+    else if (suffix == "G" || suffix == "g") scale = 1024.0 * 1024.0 * 1024.0;
+    else if (suffix == "T" || suffix == "t") scale = 1024.0 * 1024.0 * 1024.0 * 1024.0;
+    else if (!suffix.empty()) return 0;
+    
+    return static_cast<size_t>(value * scale);
+}
+
+// Output path of one period: replaces "{year}" with the period label, or
+// inserts "_<label>" before the extension
+std::string periodPath(const std::string& path, const std::string& label) {
+    size_t token = path.find("{year}");
+    if (token != std::string::npos) {
+        return path.substr(0, token) + label + path.substr(token + 6);
+    }
+    
+    size_t slash = path.find_last_of("/\\");
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return path + "_" + label;
+    }
+    return path.substr(0, dot) + "_" + label + path.substr(dot);
+}
 
 void printUsage(const char* programName) {
     std::cout << "Usage: " << programName << " [OPTIONS]" << std::endl;
@@ -9,21 +53,204 @@ void printUsage(const char* programName) {
     std::cout << "  --input PATH        Input DEM GeoTIFF file (required)" << std::endl;
     std::cout << "  --output PATH       Output solar times GeoTIFF file (required)" << std::endl;
     std::cout << "  --year YYYY         Year for calculation (default: 2025)" << std::endl;
+    std::cout << "  --years A-B         Every year from A to B in one run, one output per year" << std::endl;
+    std::cout << "                      (\"{year}\" in --output/--parquet is replaced, else _YYYY is appended)" << std::endl;
+    std::cout << "  --start-date DATE   First day (YYYY-MM-DD) of a continuous date range" << std::endl;
+    std::cout << "  --end-date DATE     Last day (YYYY-MM-DD) of the date range, inclusive" << std::endl;
     std::cout << "  --threads N         Number of threads (default: 96)" << std::endl;
+    std::cout << "  --bind B            Pin threads to NUMA nodes: spread, close or none; not with --output or --jobs (default: none)" << std::endl;
     std::cout << "  --timezone OFFSET   Timezone offset from UTC in hours (default: 1.0)" << std::endl;
+    std::cout << "  --stream            Stream binary results to stdout instead of writing a GeoTIFF" << std::endl;
+    std::cout << "  --precision P       Kernel precision for --stream: double or float (default: double)" << std::endl;
+    std::cout << "  --device D          Kernel device for --stream: cpu or gpu (CUDA build; default: cpu)" << std::endl;
+    std::cout << "  --validate-precision  Compare float and double kernels on the input DEM and exit" << std::endl;
+    std::cout << "  --max-memory SIZE   Memory budget, e.g. 16G; --stream then reads the DEM in strips" << std::endl;
+    std::cout << "  --pipeline-depth N  Day buffers overlapping compute and output in --stream (default: 2)" << std::endl;
+    std::cout << "  --hugepages H       Back large buffers with huge pages: off, thp or explicit (default: off)" << std::endl;
+    std::cout << "  --horizon N         Intersect the sun path with the terrain horizon over N azimuth sectors" << std::endl;
+    std::cout << "  --no-horizon-cache  Always recompute the horizon instead of using <dem>.horizonN.bin" << std::endl;
+    std::cout << "  --update            GeoTIFF: rewrite in place only the blocks of --output whose DEM changed" << std::endl;
+    std::cout << "  --horizon-halo KM   --update with --horizon: distance around changed blocks recomputed (default: 50)" << std::endl;
+    std::cout << "  --output-type T     GeoTIFF samples: float32 (hours) or int16 (minutes) (default: float32)" << std::endl;
+    std::cout << "  --interleave I      GeoTIFF interleave: pixel or band (default: pixel)" << std::endl;
+    std::cout << "  --blocks-in-flight N  GeoTIFF blocks computed concurrently (default: 4, or from --max-memory)" << std::endl;
+    std::cout << "  --stream-format F   Stream layout: v1 or v2 (versioned, checksummed chunks; default: v1)" << std::endl;
+    std::cout << "  --compression C     v2 chunk compression: none, lz4 or zstd (default: none)" << std::endl;
+    std::cout << "  --compression-level N  zstd compression level (default: 3)" << std::endl;
+    std::cout << "  --delta             v2: store each day as the difference to the previous day" << std::endl;
+    std::cout << "  --encoding E        v2 values: raw, delta, packed12 (2 x 12 bits in 3 bytes) or varint" << std::endl;
+    std::cout << "                      (zigzag varint of the change since the previous day; default: raw)" << std::endl;
+    std::cout << "  --time-resolution S v2 value unit in seconds: 60, 30 or 10 (default: 60)" << std::endl;
+    std::cout << "  --sparse            v2 / Parquet: write only valid pixels, with the nodata mask as runs" << std::endl;
+    std::cout << "  --parquet PATH      Write results to a Parquet file instead of a GeoTIFF" << std::endl;
+    std::cout << "  --parquet-layout L  wide (one row per day) or flat (pixel_id, day, sunrise, sunset)" << std::endl;
+    std::cout << "  --parquet-compression C  none, snappy, zstd or lz4 (default: snappy)" << std::endl;
+    std::cout << "  --row-group-size N  Days (wide) or rows (flat) per Parquet row group" << std::endl;
+    std::cout << "  --cube PATH         Write a memory-mapped result cube for '" << programName << " query'" << std::endl;
+    std::cout << "  --serve             Keep the DEM resident and answer \"LON LAT DATE [END]\" lines from stdin" << std::endl;
+    std::cout << "  --socket PATH       --serve: listen on a Unix socket instead of stdin/stdout" << std::endl;
+    std::cout << "  --cache-size SIZE   --serve: memory of the computed tile cache (default: 256M)" << std::endl;
+    std::cout << "  --jobs PATH         Process every DEM of a JSON manifest in this process (see JobManifest.h)" << std::endl;
+    std::cout << "  --jobs-in-flight N  Manifest DEMs processed concurrently, sharing --threads (default: 4)" << std::endl;
+    std::cout << "  --metrics PATH      Write phase timings, thread busy/idle and bytes written at the end" << std::endl;
+    std::cout << "                      (Prometheus text if PATH ends in .prom or .txt, JSON otherwise)" << std::endl;
+    std::cout << "  --metrics-interval S  Also rewrite --metrics every S seconds during the run" << std::endl;
     std::cout << "  --help              Show this help message" << std::endl;
     std::cout << "\nEXAMPLE:" << std::endl;
     std::cout << "  " << programName << " --input dem.tif --output solar.tif --year 2025 --threads 96" << std::endl;
+    std::cout << "  " << programName << " --input dem.tif --output solar_{year}.tif --years 2020-2030" << std::endl;
+    std::cout << "  " << programName << " --jobs departments.json --threads 96" << std::endl;
+    std::cout << "\nQUERY:" << std::endl;
+    std::cout << "  " << programName << " query CUBE (--lon X --lat Y | --bbox MINLON,MINLAT,MAXLON,MAXLAT)" << std::endl;
+    std::cout << "        [--start-date DATE] [--end-date DATE]" << std::endl;
+    std::cout << "  Prints CSV series of sunrise/sunset minutes (empty: no event or nodata)" << std::endl;
+}
+
+// "query" subcommand: series of a point or of every pixel of a box from a result cube
+int runQuery(int argc, char* argv[]) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    std::string cubePath = argv[2];
+    double lon = 0.0, lat = 0.0;
+    bool havePoint = false, haveLon = false, haveLat = false;
+    double box[4] = {0.0, 0.0, 0.0, 0.0};
+    bool haveBox = false;
+    std::string startDateText, endDateText;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--lon" && i + 1 < argc) {
+            lon = std::atof(argv[++i]);
+            haveLon = true;
+        }
+        else if (arg == "--lat" && i + 1 < argc) {
+            lat = std::atof(argv[++i]);
+            haveLat = true;
+        }
+        else if (arg == "--bbox" && i + 1 < argc) {
+            haveBox = std::sscanf(argv[++i], "%lf,%lf,%lf,%lf", &box[0], &box[1], &box[2], &box[3]) == 4;
+            if (!haveBox) {
+                std::cerr << "Error: --bbox takes MINLON,MINLAT,MAXLON,MAXLAT" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--start-date" && i + 1 < argc) {
+            startDateText = argv[++i];
+        }
+        else if (arg == "--end-date" && i + 1 < argc) {
+            endDateText = argv[++i];
+        }
+        else {
+            std::cerr << "Unknown query option: " << arg << std::endl;
+            return 1;
+        }
+    }
+    havePoint = haveLon && haveLat;
+    if (havePoint == haveBox) {
+        std::cerr << "Error: query needs either --lon and --lat, or --bbox" << std::endl;
+        return 1;
+    }
+    
+    ResultCube cube;
+    if (!cube.open(cubePath)) {
+        return 1;
+    }
+    
+    // Days of the cube to print, the whole period by default
+    int firstDay = 0;
+    int lastDay = cube.numDays() - 1;
+    CalendarDate date;
+    if (!startDateText.empty()) {
+        if (!SolarEphemeris::parseDate(startDateText, date) || (firstDay = cube.dayIndex(date)) < 0) {
+            std::cerr << "Error: --start-date is not a day of the cube" << std::endl;
+            return 1;
+        }
+    }
+    if (!endDateText.empty()) {
+        if (!SolarEphemeris::parseDate(endDateText, date) || (lastDay = cube.dayIndex(date)) < 0) {
+            std::cerr << "Error: --end-date is not a day of the cube" << std::endl;
+            return 1;
+        }
+    }
+    
+    // Pixel rectangle of the query
+    int row0, column0, row1, column1;
+    if (havePoint) {
+        if (!cube.pixelAt(lon, lat, row0, column0)) {
+            std::cerr << "Error: point is outside the cube" << std::endl;
+            return 1;
+        }
+        row1 = row0;
+        column1 = column0;
+    } else {
+        int rowA, columnA, rowB, columnB;
+        if (!cube.pixelAt(box[0], box[1], rowA, columnA) || !cube.pixelAt(box[2], box[3], rowB, columnB)) {
+            std::cerr << "Error: box is not inside the cube" << std::endl;
+            return 1;
+        }
+        row0 = std::min(rowA, rowB);
+        row1 = std::max(rowA, rowB);
+        column0 = std::min(columnA, columnB);
+        column1 = std::max(columnA, columnB);
+    }
+    
+    const double* gt = cube.geoTransform();
+    std::vector<CalendarDate> dates;
+    for (int day = firstDay; day <= lastDay; ++day) {
+        dates.push_back(cube.date(day));
+    }
+    
+    std::printf(havePoint ? "date,sunrise,sunset\n" : "row,column,lon,lat,date,sunrise,sunset\n");
+    for (int row = row0; row <= row1; ++row) {
+        for (int column = column0; column <= column1; ++column) {
+            const int16_t* series = cube.series(row, column);
+            double pixelLon = gt[0] + (column + 0.5) * gt[1] + (row + 0.5) * gt[2];
+            double pixelLat = gt[3] + (column + 0.5) * gt[4] + (row + 0.5) * gt[5];
+            for (int day = firstDay; day <= lastDay; ++day) {
+                const CalendarDate& d = dates[day - firstDay];
+                if (!havePoint) {
+                    std::printf("%d,%d,%.8f,%.8f,", row, column, pixelLon, pixelLat);
+                }
+                std::printf("%04d-%02d-%02d,", d.year, d.month, d.day);
+                for (int event = 0; event < 2; ++event) {
+                    int16_t minutes = series[day * 2 + event];
+                    if (minutes != ResultCube::NO_EVENT) {
+                        std::printf("%d", minutes);
+                    }
+                    std::printf(event == 0 ? "," : "\n");
+                }
+            }
+        }
+    }
+    return 0;
 }
 
 int main(int argc, char* argv[]) {
     // Default parameters
     std::string inputPath;
     std::string outputPath;
+    std::string parquetPath;
+    std::string jobsPath;
+    std::string metricsPath;
+    double metricsInterval = 0.0;
+    std::string threadBinding = "none";
     bool streamMode = false;
+    bool validatePrecisionMode = false;
+    ProcessingOptions options;
     int year = 2025;
+    int lastYear = 0;
+    std::string startDateText;
+    std::string endDateText;
     int numThreads = 96;
     double timezoneOffset = 1.0;
+    std::string cubePath;
+    bool serveMode = false;
+    std::string socketPath;
+    
+    if (argc > 1 && std::string(argv[1]) == "query") {
+        return runQuery(argc, argv);
+    }
     
     // Parse command-line arguments
     for (int i = 1; i < argc; ++i) {
@@ -42,6 +269,219 @@ int main(int argc, char* argv[]) {
         else if (arg == "--stream") {
             streamMode = true;
         }
+        else if (arg == "--validate-precision") {
+            validatePrecisionMode = true;
+        }
+        else if (arg == "--precision" && i + 1 < argc) {
+            std::string precision = argv[++i];
+            if (precision == "double") {
+                options.precision = Precision::Double;
+            } else if (precision == "float") {
+                options.precision = Precision::Float;
+            } else {
+                std::cerr << "Error: Precision must be 'double' or 'float'" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--device" && i + 1 < argc) {
+            std::string device = argv[++i];
+            if (device == "cpu") {
+                options.device = ComputeDevice::Cpu;
+            } else if (device == "gpu") {
+                options.device = ComputeDevice::Gpu;
+            } else {
+                std::cerr << "Error: Device must be 'cpu' or 'gpu'" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--max-memory" && i + 1 < argc) {
+            options.maxMemoryBytes = parseMemorySize(argv[++i]);
+            if (options.maxMemoryBytes == 0) {
+                std::cerr << "Error: Invalid memory size (expected e.g. 512M, 16G)" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--pipeline-depth" && i + 1 < argc) {
+            options.pipelineDepth = std::atoi(argv[++i]);
+            if (options.pipelineDepth < 1) {
+                std::cerr << "Error: Pipeline depth must be at least 1" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--hugepages" && i + 1 < argc) {
+            std::string hugePages = argv[++i];
+            if (hugePages == "off") {
+                options.hugePages = HugePages::Off;
+            } else if (hugePages == "thp") {
+                options.hugePages = HugePages::Transparent;
+            } else if (hugePages == "explicit") {
+                options.hugePages = HugePages::Explicit;
+            } else {
+                std::cerr << "Error: Huge pages must be off, thp or explicit" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--horizon" && i + 1 < argc) {
+            options.horizonSectors = std::atoi(argv[++i]);
+            if (options.horizonSectors < 4 || options.horizonSectors > 360) {
+                std::cerr << "Error: Horizon sectors must be between 4 and 360" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--no-horizon-cache") {
+            options.horizonCache = false;
+        }
+        else if (arg == "--update") {
+            options.incrementalUpdate = true;
+        }
+        else if (arg == "--horizon-halo" && i + 1 < argc) {
+            options.horizonHalo = std::atof(argv[++i]) * 1000.0;
+            if (options.horizonHalo <= 0.0) {
+                std::cerr << "Error: Horizon halo must be positive" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--output-type" && i + 1 < argc) {
+            std::string type = argv[++i];
+            if (type == "float32") {
+                options.outputType = OutputType::Float32;
+            } else if (type == "int16") {
+                options.outputType = OutputType::Int16;
+            } else {
+                std::cerr << "Error: Output type must be 'float32' or 'int16'" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--interleave" && i + 1 < argc) {
+            std::string interleave = argv[++i];
+            if (interleave == "pixel") {
+                options.interleave = Interleave::Pixel;
+            } else if (interleave == "band") {
+                options.interleave = Interleave::Band;
+            } else {
+                std::cerr << "Error: Interleave must be 'pixel' or 'band'" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--blocks-in-flight" && i + 1 < argc) {
+            options.blocksInFlight = std::atoi(argv[++i]);
+            if (options.blocksInFlight < 1) {
+                std::cerr << "Error: Blocks in flight must be at least 1" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--stream-format" && i + 1 < argc) {
+            std::string format = argv[++i];
+            if (format == "v1") {
+                options.streamFormat = StreamFormat::V1;
+            } else if (format == "v2") {
+                options.streamFormat = StreamFormat::V2;
+            } else {
+                std::cerr << "Error: Stream format must be 'v1' or 'v2'" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--compression" && i + 1 < argc) {
+            std::string compression = argv[++i];
+            if (compression == "none") {
+                options.compression = StreamCompression::None;
+            } else if (compression == "lz4") {
+                options.compression = StreamCompression::LZ4;
+            } else if (compression == "zstd") {
+                options.compression = StreamCompression::Zstd;
+            } else {
+                std::cerr << "Error: Compression must be 'none', 'lz4' or 'zstd'" << std::endl;
+                return 1;
+            }
+            if (!StreamEncoder::isAvailable(options.compression)) {
+                std::cerr << "Error: This build has no " << compression << " support" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--compression-level" && i + 1 < argc) {
+            options.compressionLevel = std::atoi(argv[++i]);
+        }
+        else if (arg == "--delta") {
+            options.streamEncoding = StreamEncoding::Delta;
+        }
+        else if (arg == "--encoding" && i + 1 < argc) {
+            std::string encoding = argv[++i];
+            if (encoding == "raw") {
+                options.streamEncoding = StreamEncoding::Raw;
+            } else if (encoding == "delta") {
+                options.streamEncoding = StreamEncoding::Delta;
+            } else if (encoding == "packed12") {
+                options.streamEncoding = StreamEncoding::Packed12;
+            } else if (encoding == "varint") {
+                options.streamEncoding = StreamEncoding::Varint;
+            } else {
+                std::cerr << "Error: Encoding must be raw, delta, packed12 or varint" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--time-resolution" && i + 1 < argc) {
+            options.timeResolutionSeconds = std::atoi(argv[++i]);
+            if (options.timeResolutionSeconds != 60 && options.timeResolutionSeconds != 30 &&
+                options.timeResolutionSeconds != 10) {
+                std::cerr << "Error: Time resolution must be 60, 30 or 10 seconds" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--sparse") {
+            options.sparseOutput = true;
+        }
+        else if (arg == "--parquet" && i + 1 < argc) {
+            parquetPath = argv[++i];
+        }
+        else if (arg == "--cube" && i + 1 < argc) {
+            cubePath = argv[++i];
+        }
+        else if (arg == "--serve") {
+            serveMode = true;
+        }
+        else if (arg == "--socket" && i + 1 < argc) {
+            socketPath = argv[++i];
+        }
+        else if (arg == "--cache-size" && i + 1 < argc) {
+            options.serviceCacheBytes = parseMemorySize(argv[++i]);
+            if (options.serviceCacheBytes == 0) {
+                std::cerr << "Error: Invalid cache size: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--parquet-layout" && i + 1 < argc) {
+            std::string layout = argv[++i];
+            if (layout == "wide") {
+                options.parquetLayout = ParquetLayout::Wide;
+            } else if (layout == "flat") {
+                options.parquetLayout = ParquetLayout::Flat;
+            } else {
+                std::cerr << "Error: Parquet layout must be 'wide' or 'flat'" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--parquet-compression" && i + 1 < argc) {
+            std::string compression = argv[++i];
+            if (compression == "none") {
+                options.parquetCompression = ParquetCompression::None;
+            } else if (compression == "snappy") {
+                options.parquetCompression = ParquetCompression::Snappy;
+            } else if (compression == "zstd") {
+                options.parquetCompression = ParquetCompression::Zstd;
+            } else if (compression == "lz4") {
+                options.parquetCompression = ParquetCompression::LZ4;
+            } else {
+                std::cerr << "Error: Parquet compression must be 'none', 'snappy', 'zstd' or 'lz4'" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--row-group-size" && i + 1 < argc) {
+            options.parquetRowGroupSize = std::atoll(argv[++i]);
+            if (options.parquetRowGroupSize < 1) {
+                std::cerr << "Error: Row group size must be at least 1" << std::endl;
+                return 1;
+            }
+        }
         else if (arg == "--year" && i + 1 < argc) {
             year = std::atoi(argv[++i]);
             if (year < 1900 || year > 2100) {
@@ -49,6 +489,49 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
         }
+        else if (arg == "--years" && i + 1 < argc) {
+            std::string range = argv[++i];
+            size_t dash = range.find('-');
+            year = std::atoi(range.substr(0, dash).c_str());
+            lastYear = dash == std::string::npos ? year : std::atoi(range.substr(dash + 1).c_str());
+            if (year < 1900 || lastYear > 2100 || lastYear < year) {
+                std::cerr << "Error: --years must be A-B with 1900 <= A <= B <= 2100" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--start-date" && i + 1 < argc) {
+            startDateText = argv[++i];
+        }
+        else if (arg == "--end-date" && i + 1 < argc) {
+            endDateText = argv[++i];
+        }
+        else if (arg == "--jobs" && i + 1 < argc) {
+            jobsPath = argv[++i];
+        }
+        else if (arg == "--jobs-in-flight" && i + 1 < argc) {
+            options.jobsInFlight = std::atoi(argv[++i]);
+            if (options.jobsInFlight < 1) {
+                std::cerr << "Error: Jobs in flight must be at least 1" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--metrics" && i + 1 < argc) {
+            metricsPath = argv[++i];
+        }
+        else if (arg == "--metrics-interval" && i + 1 < argc) {
+            metricsInterval = std::atof(argv[++i]);
+            if (metricsInterval <= 0.0) {
+                std::cerr << "Error: Metrics interval must be positive" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--bind" && i + 1 < argc) {
+            threadBinding = argv[++i];
+            if (threadBinding != "spread" && threadBinding != "close" && threadBinding != "none") {
+                std::cerr << "Error: Binding must be spread, close or none" << std::endl;
+                return 1;
+            }
+        }
         else if (arg == "--threads" && i + 1 < argc) {
             numThreads = std::atoi(argv[++i]);
             if (numThreads < 1) {
@@ -66,6 +549,81 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    if (metricsInterval > 0.0 && metricsPath.empty()) {
+        std::cerr << "Error: --metrics-interval requires --metrics" << std::endl;
+        return 1;
+    }
+    
+    // Instrumentation of the run; snapshots rewrite the same file meanwhile
+    RunMetrics metrics;
+    auto startMetrics = [&](DemProcessor& processor) {
+        if (metricsPath.empty()) return;
+        processor.setMetrics(&metrics);
+        if (metricsInterval > 0.0) {
+            metrics.startSnapshots(metricsPath, metricsInterval);
+        }
+    };
+    // Pin the team once the processor has set its size; the buffers are
+    // then first touched by the threads that compute them
+    auto bindThreads = [&]() {
+        return threadBinding == "none" || NumaPlacement::bindThreads(threadBinding == "spread");
+    };
+    auto writeMetrics = [&]() {
+        if (metricsPath.empty()) return;
+        metrics.stopSnapshots();
+        if (metrics.write(metricsPath)) {
+            std::cerr << "Metrics written to " << metricsPath << std::endl;
+        }
+    };
+    
+    // Terrain beyond this distance hardly changes a horizon; without a halo
+    // every block would be recomputed as soon as one block of the DEM changes
+    if (options.incrementalUpdate && options.horizonSectors > 0 && options.horizonHalo <= 0.0) {
+        options.horizonHalo = 50000.0;
+    }
+    
+    // Manifest mode: inputs, outputs and per-job years come from the file;
+    // --year and --timezone are the defaults of jobs that omit them
+    if (!jobsPath.empty()) {
+        if (!inputPath.empty() || streamMode || validatePrecisionMode || lastYear != 0 ||
+            !startDateText.empty() || !endDateText.empty()) {
+            std::cerr << "Error: --jobs cannot be combined with --input, --stream, --years or date ranges" << std::endl;
+            return 1;
+        }
+        // Job and block teams are created by bound threads and would inherit one node
+        if (threadBinding != "none") {
+            std::cerr << "Error: --bind cannot be combined with --jobs" << std::endl;
+            return 1;
+        }
+        
+        std::vector<DemJob> jobs;
+        if (!JobManifest::load(jobsPath, jobs, year, timezoneOffset)) {
+            return 1;
+        }
+        for (const DemJob& job : jobs) {
+            if (!job.parquetPath.empty() && !ParquetOutput::isAvailable()) {
+                std::cerr << "Error: Parquet jobs require a build with -DSOLAR_WITH_ARROW=ON" << std::endl;
+                return 1;
+            }
+        }
+        
+        DemProcessor processor(numThreads);
+        processor.setOptions(options);
+        if (!bindThreads()) {
+            return 1;
+        }
+        startMetrics(processor);
+        bool success = processor.processJobs(jobs);
+        processor.reportBuffers();
+        writeMetrics();
+        if (success) {
+            std::cout << "\n✓ All jobs completed successfully!" << std::endl;
+            return 0;
+        }
+        std::cerr << "\n✗ Processing failed!" << std::endl;
+        return 1;
+    }
+    
     // Validate required arguments
     if (inputPath.empty()) {
         std::cerr << "Error: Input file is required (--input)" << std::endl;
@@ -73,41 +631,171 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    if (!streamMode && outputPath.empty()) {
-        std::cerr << "Error: Output file is required (--output) unless in --stream mode" << std::endl;
+    bool parquetMode = !parquetPath.empty();
+    if (parquetMode && !ParquetOutput::isAvailable()) {
+        std::cerr << "Error: --parquet requires a build with -DSOLAR_WITH_ARROW=ON" << std::endl;
+        return 1;
+    }
+    
+    if (options.device == ComputeDevice::Gpu) {
+        if (!streamMode) {
+            std::cerr << "Error: --device gpu requires --stream" << std::endl;
+            return 1;
+        }
+        if (!GpuSolver::isAvailable()) {
+            std::cerr << "Error: --device gpu requires a build with -DSOLAR_WITH_CUDA=ON and a CUDA device" << std::endl;
+            return 1;
+        }
+    }
+    
+    bool cubeMode = !cubePath.empty();
+    if (cubeMode && (parquetMode || streamMode)) {
+        std::cerr << "Error: --cube cannot be combined with --parquet or --stream" << std::endl;
+        return 1;
+    }
+    
+    if (serveMode && (streamMode || parquetMode || cubeMode || validatePrecisionMode || !outputPath.empty())) {
+        std::cerr << "Error: --serve cannot be combined with an output mode" << std::endl;
+        return 1;
+    }
+    // GeoTIFF blocks run nested teams, which would inherit the node of their worker
+    if (threadBinding != "none" && !streamMode && !validatePrecisionMode && !parquetMode && !cubeMode &&
+        !serveMode) {
+        std::cerr << "Error: --bind does not apply to GeoTIFF output (--output)" << std::endl;
+        return 1;
+    }
+    if (!socketPath.empty() && !serveMode) {
+        std::cerr << "Error: --socket requires --serve" << std::endl;
+        return 1;
+    }
+    
+    if (!streamMode && !validatePrecisionMode && !parquetMode && !cubeMode && !serveMode && outputPath.empty()) {
+        std::cerr << "Error: Output file is required (--output) unless in --stream, --parquet or --cube mode" << std::endl;
         printUsage(argv[0]);
         return 1;
     }
     
+    if (options.streamFormat == StreamFormat::V1 &&
+        (options.compression != StreamCompression::None || options.streamEncoding != StreamEncoding::Raw ||
+         options.timeResolutionSeconds != 60)) {
+        std::cerr << "Error: --compression, --delta, --encoding and --time-resolution require --stream-format v2" << std::endl;
+        return 1;
+    }
+    
+    // A day holds 8640 units of 10 s, above the 12-bit range
+    if (options.streamEncoding == StreamEncoding::Packed12 &&
+        24 * 3600 / options.timeResolutionSeconds > StreamEncoder::PACKED12_MAX) {
+        std::cerr << "Error: --encoding packed12 needs a time resolution of 30 s or more" << std::endl;
+        return 1;
+    }
+    
+    if (options.sparseOutput && !parquetMode &&
+        !(streamMode && options.streamFormat == StreamFormat::V2)) {
+        std::cerr << "Error: --sparse requires --stream-format v2 or --parquet" << std::endl;
+        return 1;
+    }
+    
+    if (options.incrementalUpdate && (streamMode || parquetMode || cubeMode || validatePrecisionMode)) {
+        std::cerr << "Error: --update only applies to GeoTIFF output (--output)" << std::endl;
+        return 1;
+    }
+    
+    // Periods to compute: one year, each year of --years, or one date range
+    std::vector<SolarEphemeris> periods;
+    if (!startDateText.empty() || !endDateText.empty()) {
+        CalendarDate startDate, endDate;
+        if (!SolarEphemeris::parseDate(startDateText, startDate) ||
+            !SolarEphemeris::parseDate(endDateText, endDate)) {
+            std::cerr << "Error: --start-date and --end-date require valid YYYY-MM-DD dates" << std::endl;
+            return 1;
+        }
+        if (lastYear != 0) {
+            std::cerr << "Error: --years cannot be combined with --start-date/--end-date" << std::endl;
+            return 1;
+        }
+        if (endDate.year * 10000 + endDate.month * 100 + endDate.day <
+            startDate.year * 10000 + startDate.month * 100 + startDate.day) {
+            std::cerr << "Error: --end-date is before --start-date" << std::endl;
+            return 1;
+        }
+        if (startDate.year < 1900 || endDate.year > 2100) {
+            std::cerr << "Error: Dates must be between 1900 and 2100" << std::endl;
+            return 1;
+        }
+        periods.emplace_back(startDate, endDate);
+    } else {
+        for (int y = year; y <= std::max(year, lastYear); ++y) {
+            periods.emplace_back(y);
+        }
+    }
+    
+    // A single year keeps the given path; several years get one file each
+    bool batchMode = lastYear != 0;
+    std::vector<std::string> outputPaths;
+    std::vector<std::string> parquetPaths;
+    std::vector<std::string> cubePaths;
+    for (const SolarEphemeris& period : periods) {
+        outputPaths.push_back(batchMode ? periodPath(outputPath, period.label()) : outputPath);
+        parquetPaths.push_back(batchMode ? periodPath(parquetPath, period.label()) : parquetPath);
+        cubePaths.push_back(batchMode ? periodPath(cubePath, period.label()) : cubePath);
+    }
+    
+    if (validatePrecisionMode && (batchMode || periods[0].isRange())) {
+        std::cerr << "Error: --validate-precision takes a single --year" << std::endl;
+        return 1;
+    }
+    
     // Process DEM
     DemProcessor processor(numThreads);
+    processor.setOptions(options);
+    if (!bindThreads()) {
+        return 1;
+    }
+    startMetrics(processor);
     bool success;
     
-    if (streamMode) {
+    if (validatePrecisionMode) {
+        success = processor.validatePrecision(inputPath, year, timezoneOffset);
+    } else if (serveMode) {
+        // stdout carries the responses; logs go to stderr
+        success = processor.serve(inputPath, timezoneOffset, socketPath);
+    } else if (streamMode) {
         // In stream mode, we don't print configuration to stdout to avoid corrupting the stream
         // We can print to stderr
-        std::cerr << "Starting binary stream for " << inputPath << " (Year " << year << ")" << std::endl;
-        success = processor.streamBinaryOutput(inputPath, year, timezoneOffset);
+        std::cerr << "Starting binary stream for " << inputPath << " (" << periods.size() << " period(s) from "
+                  << periods.front().label() << ")" << std::endl;
+        success = processor.streamBinaryOutput(inputPath, periods, timezoneOffset);
+    } else if (parquetMode) {
+        std::cerr << "Writing Parquet " << parquetPaths.front() << " for " << inputPath << " ("
+                  << periods.size() << " period(s))" << std::endl;
+        success = processor.writeParquet(inputPath, parquetPaths, periods, timezoneOffset);
+    } else if (cubeMode) {
+        std::cerr << "Writing result cube " << cubePaths.front() << " for " << inputPath << " ("
+                  << periods.size() << " period(s))" << std::endl;
+        success = processor.writeCube(inputPath, cubePaths, periods, timezoneOffset);
     } else {
         std::cout << "========================================" << std::endl;
         std::cout << "Solar Time Calculation" << std::endl;
         std::cout << "High-performance sunrise/sunset computation" << std::endl;
         std::cout << "========================================\n" << std::endl;
-
+        
         // Display configuration
         std::cout << "Configuration:" << std::endl;
         std::cout << "  Input:    " << inputPath << std::endl;
-        std::cout << "  Output:   " << outputPath << std::endl;
-        std::cout << "  Year:     " << year << std::endl;
+        std::cout << "  Output:   " << outputPaths.front() << (periods.size() > 1 ? " ..." : "") << std::endl;
+        std::cout << "  Period:   " << periods.front().label()
+                  << (periods.size() > 1 ? " to " + periods.back().label() : std::string()) << std::endl;
         std::cout << "  Threads:  " << numThreads << std::endl;
         std::cout << "  Timezone: UTC" << (timezoneOffset >= 0 ? "+" : "") << timezoneOffset << std::endl;
         std::cout << std::endl;
         
-        success = processor.processDEM(inputPath, outputPath, year, timezoneOffset);
+        success = processor.processDEM(inputPath, outputPaths, periods, timezoneOffset);
     }
+    processor.reportBuffers();
+    writeMetrics();
     
     if (success) {
-        if (!streamMode) std::cout << "\n✓ Processing completed successfully!" << std::endl;
+        if (!streamMode && !validatePrecisionMode && !parquetMode && !cubeMode && !serveMode) std::cout << "\n✓ Processing completed successfully!" << std::endl;
         return 0;
     } else {
         std::cerr << "\n✗ Processing failed!" << std::endl;
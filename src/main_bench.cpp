@@ -0,0 +1,599 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <omp.h>
+#include "ProcessDEM.h"
+#include "SolarGrid.h"
+#include "SolarKernels.h"
+#include "cpl_json.h"
+#include "cpl_vsi.h"
+#include "ogr_spatialref.h"
+
+// Benchmarks of the solar kernels and of the end-to-end outputs, written as
+// JSON to track regressions between releases and to size --cpus-per-task.
+//
+// Kernels run on one thread and report pixels per second per core. The
+// end-to-end runs use a synthetic DEM: smooth terrain clipped to a wavy
+// outline so that a set fraction of each row is nodata, like a department
+// DEM. Strong scaling keeps the DEM fixed; weak scaling keeps the rows per
+// thread fixed, the configured DEM being the size at the largest count.
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchConfig {
+    int width = 2048;
+    int height = 2048;
+    double nodataFraction = 0.4;
+    int days = 32;
+    int year = 2025;
+    int repeat = 1;
+    double minSeconds = 0.5;
+    std::vector<int> threads;
+    std::string sweep = "both";    // strong, weak or both
+    bool kernels = true;
+    bool stream = true;
+    bool geotiff = true;
+    std::string scratchDir = "/tmp";
+    std::string jsonPath;          // stdout if empty
+};
+
+// Parallel efficiency above which adding threads is still worth it
+const double EFFICIENT_SCALING = 0.7;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void printUsage(const char* programName) {
+    std::cout << "Usage: " << programName << " [OPTIONS]" << std::endl;
+    std::cout << "\nOPTIONS:" << std::endl;
+    std::cout << "  --width N           Synthetic DEM width (default: 2048)" << std::endl;
+    std::cout << "  --height N          Synthetic DEM height; the size at the largest thread count for weak scaling (default: 2048)" << std::endl;
+    std::cout << "  --nodata F          Fraction of nodata pixels, 0 to 0.95 (default: 0.4)" << std::endl;
+    std::cout << "  --days N            Days computed per end-to-end run (default: 32)" << std::endl;
+    std::cout << "  --year YYYY         Year of the computed days (default: 2025)" << std::endl;
+    std::cout << "  --threads LIST      Thread counts, e.g. 1,2,4,8 (default: powers of two up to the CPU count)" << std::endl;
+    std::cout << "  --sweep S           strong, weak or both (default: both)" << std::endl;
+    std::cout << "  --only PART         Run only kernels, stream or geotiff" << std::endl;
+    std::cout << "  --repeat N          End-to-end runs per point, the fastest is kept (default: 1)" << std::endl;
+    std::cout << "  --min-time S        Minimum seconds per kernel measurement (default: 0.5)" << std::endl;
+    std::cout << "  --scratch DIR       Directory for the synthetic DEM and GeoTIFF output (default: /tmp)" << std::endl;
+    std::cout << "  --json PATH         Write the results to PATH (default: stdout)" << std::endl;
+    std::cout << "  --help              Show this help message" << std::endl;
+    std::cout << "\nEXAMPLE:" << std::endl;
+    std::cout << "  " << programName << " --width 4096 --height 4096 --threads 1,8,24,48,96 --json bench.json" << std::endl;
+}
+
+// Parse "1,2,4"; false on an invalid entry
+bool parseThreadList(const std::string& text, std::vector<int>& threads) {
+    threads.clear();
+    size_t begin = 0;
+    while (begin <= text.size()) {
+        size_t end = text.find(',', begin);
+        if (end == std::string::npos) end = text.size();
+        int count = std::atoi(text.substr(begin, end - begin).c_str());
+        if (count < 1) {
+            return false;
+        }
+        threads.push_back(count);
+        begin = end + 1;
+    }
+    std::sort(threads.begin(), threads.end());
+    threads.erase(std::unique(threads.begin(), threads.end()), threads.end());
+    return !threads.empty();
+}
+
+// Parse arguments; returns -1 to continue, otherwise the exit code
+int parseArguments(int argc, char* argv[], BenchConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        
+        if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        else if (arg == "--width" && i + 1 < argc) {
+            config.width = std::atoi(argv[++i]);
+        }
+        else if (arg == "--height" && i + 1 < argc) {
+            config.height = std::atoi(argv[++i]);
+        }
+        else if (arg == "--nodata" && i + 1 < argc) {
+            config.nodataFraction = std::atof(argv[++i]);
+            if (config.nodataFraction < 0.0 || config.nodataFraction > 0.95) {
+                std::cerr << "Error: Nodata fraction must be between 0 and 0.95" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--days" && i + 1 < argc) {
+            config.days = std::atoi(argv[++i]);
+        }
+        else if (arg == "--year" && i + 1 < argc) {
+            config.year = std::atoi(argv[++i]);
+            if (config.year < 1900 || config.year > 2100) {
+                std::cerr << "Error: Year must be between 1900 and 2100" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            if (!parseThreadList(argv[++i], config.threads)) {
+                std::cerr << "Error: --threads expects a list of positive counts, e.g. 1,2,4" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--sweep" && i + 1 < argc) {
+            config.sweep = argv[++i];
+            if (config.sweep != "strong" && config.sweep != "weak" && config.sweep != "both") {
+                std::cerr << "Error: Sweep must be 'strong', 'weak' or 'both'" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--only" && i + 1 < argc) {
+            std::string part = argv[++i];
+            if (part != "kernels" && part != "stream" && part != "geotiff") {
+                std::cerr << "Error: --only expects 'kernels', 'stream' or 'geotiff'" << std::endl;
+                return 1;
+            }
+            config.kernels = part == "kernels";
+            config.stream = part == "stream";
+            config.geotiff = part == "geotiff";
+        }
+        else if (arg == "--repeat" && i + 1 < argc) {
+            config.repeat = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--min-time" && i + 1 < argc) {
+            config.minSeconds = std::atof(argv[++i]);
+        }
+        else if (arg == "--scratch" && i + 1 < argc) {
+            config.scratchDir = argv[++i];
+        }
+        else if (arg == "--json" && i + 1 < argc) {
+            config.jsonPath = argv[++i];
+        }
+        else {
+            std::cerr << "Error: Unknown argument: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (config.width < 1 || config.height < 1 || config.days < 1 || config.days > 366) {
+        std::cerr << "Error: --width and --height must be positive and --days between 1 and 366" << std::endl;
+        return 1;
+    }
+    
+    if (config.threads.empty()) {
+        int cpus = omp_get_num_procs();
+        for (int count = 1; count < cpus; count *= 2) {
+            config.threads.push_back(count);
+        }
+        config.threads.push_back(cpus);
+    }
+    return -1;
+}
+
+// ---------------------------------------------------------------------------
+// Kernel microbenchmarks
+// ---------------------------------------------------------------------------
+
+// Call body (pixelsPerCall pixels each) for at least minSeconds; returns pixels per second
+template <typename Body>
+double measureRate(Body body, size_t pixelsPerCall, double minSeconds) {
+    body();  // Warm-up: caches, page faults, kernel dispatch
+    
+    size_t calls = 0;
+    double elapsed = 0.0;
+    Clock::time_point start = Clock::now();
+    do {
+        body();
+        ++calls;
+        elapsed = secondsSince(start);
+    } while (elapsed < minSeconds);
+    return static_cast<double>(calls * pixelsPerCall) / elapsed;
+}
+
+// One pixel row over the Alps at the June solstice, shared by all variants
+struct KernelInput {
+    static constexpr int PIXELS = 4096;
+    
+    DayEphemeris eph;
+    double latitude = 45.0;
+    std::vector<double> longitude, elevation;
+    std::vector<double> cosZenith, solarNoon;
+    std::vector<float> cosZenithFloat, solarNoonFloat;
+    double rowScale = 0.0, rowOffset = 0.0;
+    
+    explicit KernelInput(const SolarCalculator& calc) {
+        eph = calc.computeEphemeris(2025, 6, 21, 172);
+        
+        double geoTransform[6] = {5.0, 2.0 / PIXELS, 0.0, latitude, 0.0, -1.0};
+        SolarGrid grid(geoTransform, PIXELS, 1);
+        grid.rowTerms(eph, 0, rowScale, rowOffset);
+        
+        longitude.resize(PIXELS);
+        elevation.resize(PIXELS);
+        cosZenith.resize(PIXELS);
+        solarNoon.resize(PIXELS);
+        grid.solarNoonTable(eph, 0, PIXELS, solarNoon.data());
+        for (int i = 0; i < PIXELS; ++i) {
+            longitude[i] = grid.longitude(i);
+            elevation[i] = 1500.0 + 1200.0 * std::sin(i * 0.01);
+            cosZenith[i] = SolarCalculator::zenithCosine(elevation[i]);
+        }
+        cosZenithFloat.assign(cosZenith.begin(), cosZenith.end());
+        solarNoonFloat.assign(solarNoon.begin(), solarNoon.end());
+    }
+};
+
+// Every row kernel variant of one precision on the grid terms of input
+template <typename Real>
+void addRowKernels(const KernelInput& input, const Real* cosZenith, const Real* solarNoon,
+                   const char* precision, const BenchConfig& config, double timezoneOffset,
+                   std::vector<int16_t>& sunrise, std::vector<int16_t>& sunset,
+                   CPLJSONArray& results, double pixelRate) {
+    SolarKernels::RowArgs<Real> args;
+    args.cosZenith = cosZenith;
+    args.solarNoon = solarNoon;
+    args.rowScale = static_cast<Real>(input.rowScale);
+    args.rowOffset = static_cast<Real>(input.rowOffset);
+    args.timezoneOffset = static_cast<Real>(timezoneOffset);
+    args.unitsPerHour = Real(60.0);
+    args.sunrise = sunrise.data();
+    args.sunset = sunset.data();
+    args.n = KernelInput::PIXELS;
+    
+    // Only the instruction sets of this build that the CPU supports
+    const SolarKernels::Isa isas[] = {SolarKernels::Isa::Scalar, SolarKernels::Isa::AVX2,
+                                      SolarKernels::Isa::AVX512};
+    for (SolarKernels::Isa isa : isas) {
+        SolarKernels::RowKernel<Real> kernel = SolarKernels::rowKernel<Real>(isa);
+        if (!kernel || isa > SolarKernels::detectIsa()) {
+            continue;
+        }
+        double rate = measureRate([&]() { kernel(args); }, KernelInput::PIXELS, config.minSeconds);
+        
+        CPLJSONObject result;
+        result.Add("name", std::string("row_") + SolarKernels::isaName(isa) + "_" + precision);
+        result.Add("isa", SolarKernels::isaName(isa));
+        result.Add("precision", precision);
+        result.Add("pixels_per_second", rate);
+        result.Add("speedup_vs_pixel", rate / pixelRate);
+        results.Add(result);
+        std::cerr << "  row kernel " << SolarKernels::isaName(isa) << " " << precision << ": "
+                  << rate / 1e6 << " Mpixel/s" << std::endl;
+    }
+}
+
+// Single-thread throughput of each solver level
+CPLJSONArray benchmarkKernels(const BenchConfig& config) {
+    const double timezoneOffset = 1.0;
+    SolarCalculator calc(timezoneOffset);
+    KernelInput input(calc);
+    std::vector<int16_t> sunrise(KernelInput::PIXELS), sunset(KernelInput::PIXELS);
+    CPLJSONArray results;
+    volatile double sink = 0.0;  // Keeps the scalar loops from being optimised away
+    
+    std::cerr << "Kernel microbenchmarks (1 thread, " << KernelInput::PIXELS << " pixels per call)" << std::endl;
+    
+    // Per-pixel NOAA evaluation from the day ephemeris
+    double pixelRate = measureRate([&]() {
+        double sum = 0.0;
+        for (int i = 0; i < KernelInput::PIXELS; ++i) {
+            DayEvents events = calc.calculateDayEvents(input.eph, input.latitude, input.longitude[i],
+                                                       input.elevation[i]);
+            sum += events.sunrise + events.sunset;
+        }
+        sink = sink + sum;
+    }, KernelInput::PIXELS, config.minSeconds);
+    
+    // Separable grid terms, one scalar call per pixel
+    double gridRate = measureRate([&]() {
+        double sum = 0.0;
+        for (int i = 0; i < KernelInput::PIXELS; ++i) {
+            DayEvents events = calc.calculateDayEvents(input.cosZenith[i], input.rowScale, input.rowOffset,
+                                                       input.solarNoon[i]);
+            sum += events.sunrise + events.sunset;
+        }
+        sink = sink + sum;
+    }, KernelInput::PIXELS, config.minSeconds);
+    
+    const char* names[] = {"pixel_scalar", "grid_scalar"};
+    const double rates[] = {pixelRate, gridRate};
+    for (int k = 0; k < 2; ++k) {
+        CPLJSONObject result;
+        result.Add("name", names[k]);
+        result.Add("isa", "scalar");
+        result.Add("precision", "double");
+        result.Add("pixels_per_second", rates[k]);
+        result.Add("speedup_vs_pixel", rates[k] / pixelRate);
+        results.Add(result);
+        std::cerr << "  " << names[k] << ": " << rates[k] / 1e6 << " Mpixel/s" << std::endl;
+    }
+    
+    // Batch row kernels writing Int16 minutes
+    addRowKernels<double>(input, input.cosZenith.data(), input.solarNoon.data(), "double",
+                          config, timezoneOffset, sunrise, sunset, results, pixelRate);
+    addRowKernels<float>(input, input.cosZenithFloat.data(), input.solarNoonFloat.data(), "float",
+                         config, timezoneOffset, sunrise, sunset, results, pixelRate);
+    return results;
+}
+
+// ---------------------------------------------------------------------------
+// End-to-end benchmarks
+// ---------------------------------------------------------------------------
+
+// Write a north-up WGS84 DEM of smooth terrain clipped to a wavy outline
+// (nodataFraction of each row); returns the number of valid pixels, 0 on error
+size_t createSyntheticDem(const std::string& path, int width, int height, double nodataFraction) {
+    GDALDriver* driver = GetGDALDriverManager()->GetDriverByName("GTiff");
+    if (!driver) {
+        std::cerr << "Error: GTiff driver not available" << std::endl;
+        return 0;
+    }
+    
+    char** createOptions = nullptr;
+    createOptions = CSLSetNameValue(createOptions, "TILED", "YES");
+    createOptions = CSLSetNameValue(createOptions, "BLOCKXSIZE", "512");
+    createOptions = CSLSetNameValue(createOptions, "BLOCKYSIZE", "512");
+    GDALDataset* dataset = driver->Create(path.c_str(), width, height, 1, GDT_Float32, createOptions);
+    CSLDestroy(createOptions);
+    if (!dataset) {
+        std::cerr << "Error: Failed to create synthetic DEM: " << path << std::endl;
+        return 0;
+    }
+    
+    // 1 arc-second pixels from 5E 46N (French Alps)
+    double geoTransform[6] = {5.0, 1.0 / 3600.0, 0.0, 46.0, 0.0, -1.0 / 3600.0};
+    dataset->SetGeoTransform(geoTransform);
+    OGRSpatialReference srs;
+    srs.SetWellKnownGeogCS("WGS84");
+    char* wkt = nullptr;
+    srs.exportToWkt(&wkt);
+    dataset->SetProjection(wkt);
+    CPLFree(wkt);
+    
+    const float nodata = -9999.0f;
+    GDALRasterBand* band = dataset->GetRasterBand(1);
+    band->SetNoDataValue(nodata);
+    
+    int validWidth = static_cast<int>(std::lround((1.0 - nodataFraction) * width));
+    int margin = width - validWidth;
+    size_t validPixels = 0;
+    std::vector<float> row(width);
+    for (int y = 0; y < height; ++y) {
+        int x0 = static_cast<int>(margin * (0.5 + 0.5 * std::sin(y * 0.01)));
+        for (int x = 0; x < width; ++x) {
+            bool valid = x >= x0 && x < x0 + validWidth;
+            row[x] = valid ? static_cast<float>(1500.0 + 1200.0 * std::sin(x * 0.004) * std::cos(y * 0.003))
+                           : nodata;
+        }
+        validPixels += validWidth;
+        if (band->RasterIO(GF_Write, 0, y, width, 1, row.data(), width, 1, GDT_Float32, 0, 0) != CE_None) {
+            std::cerr << "Error: Failed to write synthetic DEM" << std::endl;
+            GDALClose(dataset);
+            return 0;
+        }
+    }
+    GDALClose(dataset);
+    return validPixels;
+}
+
+// The first config.days days of the year
+SolarEphemeris benchPeriod(const BenchConfig& config) {
+    if (config.days >= SolarEphemeris::daysInYear(config.year)) {
+        return SolarEphemeris(config.year);
+    }
+    CalendarDate end = {config.year, 1, config.days};
+    while (end.day > SolarEphemeris::daysInMonth(end.year, end.month)) {
+        end.day -= SolarEphemeris::daysInMonth(end.year, end.month);
+        ++end.month;
+    }
+    return SolarEphemeris(CalendarDate{config.year, 1, 1}, end);
+}
+
+// Run one output path on a DEM with stdout silenced; returns seconds, < 0 on failure
+double timeRun(const std::string& target, const std::string& demPath, const BenchConfig& config,
+               int threads) {
+    std::vector<SolarEphemeris> periods = {benchPeriod(config)};
+    std::string outputPath = config.scratchDir + "/solar_bench_" + std::to_string(getpid()) + "_out.tif";
+    
+    // The stream goes to /dev/null; so do the progress messages of processDEM
+    std::fflush(stdout);
+    std::cout.flush();
+    int savedStdout = dup(STDOUT_FILENO);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDOUT_FILENO);
+    close(devNull);
+    
+    Clock::time_point start = Clock::now();
+    bool ok;
+    {
+        DemProcessor processor(threads);
+        ProcessingOptions options;
+        options.streamFormat = StreamFormat::V2;
+        processor.setOptions(options);
+        
+        if (target == "stream") {
+            ok = processor.streamBinaryOutput(demPath, periods, 1.0);
+        } else {
+            ok = processor.processDEM(demPath, std::vector<std::string>{outputPath}, periods, 1.0);
+        }
+    }
+    double seconds = secondsSince(start);
+    
+    std::cout.flush();
+    std::fflush(stdout);
+    dup2(savedStdout, STDOUT_FILENO);
+    close(savedStdout);
+    
+    if (target != "stream") {
+        VSIUnlink(outputPath.c_str());
+    }
+    return ok ? seconds : -1.0;
+}
+
+// Strong or weak scaling sweep of one target; appends points and returns the
+// largest thread count whose efficiency stays above EFFICIENT_SCALING
+int sweepThreads(const std::string& target, const std::string& sweep, const BenchConfig& config,
+                 CPLJSONArray& results, bool& success) {
+    std::string demPath = config.scratchDir + "/solar_bench_" + std::to_string(getpid()) + "_dem.tif";
+    int maxThreads = config.threads.back();
+    int suggested = config.threads.front();
+    double baseSeconds = 0.0;
+    int baseThreads = 0;
+    size_t validPixels = 0;
+    
+    std::cerr << "End-to-end " << target << ", " << sweep << " scaling" << std::endl;
+    for (size_t k = 0; k < config.threads.size(); ++k) {
+        int threads = config.threads[k];
+        
+        // Weak scaling: rows proportional to the thread count
+        int height = config.height;
+        if (sweep == "weak") {
+            height = std::max(1, static_cast<int>(static_cast<long long>(config.height) * threads / maxThreads));
+        }
+        if (k == 0 || sweep == "weak") {
+            validPixels = createSyntheticDem(demPath, config.width, height, config.nodataFraction);
+            if (validPixels == 0) {
+                success = false;
+                return suggested;
+            }
+        }
+        
+        double seconds = -1.0;
+        for (int r = 0; r < config.repeat; ++r) {
+            double run = timeRun(target, demPath, config, threads);
+            if (run < 0.0) {
+                seconds = -1.0;
+                break;
+            }
+            seconds = (seconds < 0.0) ? run : std::min(seconds, run);
+        }
+        if (seconds < 0.0) {
+            std::cerr << "Error: " << target << " run failed with " << threads << " threads" << std::endl;
+            success = false;
+            break;
+        }
+        
+        if (k == 0) {
+            baseSeconds = seconds;
+            baseThreads = threads;
+        }
+        // Strong: speedup over the first count relative to the thread ratio.
+        // Weak: the work per thread is constant, so time should be too.
+        double efficiency = (sweep == "strong")
+            ? (baseSeconds / seconds) * baseThreads / threads
+            : baseSeconds / seconds;
+        if (efficiency >= EFFICIENT_SCALING) {
+            suggested = threads;
+        }
+        
+        double pixelDays = static_cast<double>(config.width) * height * config.days;
+        CPLJSONObject point;
+        point.Add("target", target);
+        point.Add("sweep", sweep);
+        point.Add("threads", threads);
+        point.Add("width", config.width);
+        point.Add("height", height);
+        point.Add("valid_pixels", static_cast<GIntBig>(validPixels));
+        point.Add("days", config.days);
+        point.Add("seconds", seconds);
+        point.Add("pixel_days_per_second", pixelDays / seconds);
+        point.Add("pixel_days_per_second_per_thread", pixelDays / seconds / threads);
+        point.Add("efficiency", efficiency);
+        results.Add(point);
+        
+        std::cerr << "  " << threads << " threads: " << seconds << " s, "
+                  << pixelDays / seconds / 1e6 << " Mpixel-days/s, efficiency " << efficiency << std::endl;
+    }
+    
+    VSIUnlink(demPath.c_str());
+    return suggested;
+}
+
+std::string utcTimestamp() {
+    char text[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    return text;
+}
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+    int exitCode = parseArguments(argc, argv, config);
+    if (exitCode >= 0) {
+        return exitCode;
+    }
+    
+    GDALAllRegister();
+    
+    char host[256] = "";
+    gethostname(host, sizeof(host) - 1);
+    
+    CPLJSONObject root;
+    root.Add("benchmark", "solar_bench");
+    root.Add("timestamp", utcTimestamp());
+    root.Add("host", std::string(host));
+    root.Add("cpus", omp_get_num_procs());
+    root.Add("isa", SolarKernels::isaName(SolarKernels::detectIsa()));
+    
+    CPLJSONObject settings;
+    settings.Add("width", config.width);
+    settings.Add("height", config.height);
+    settings.Add("nodata_fraction", config.nodataFraction);
+    settings.Add("days", config.days);
+    settings.Add("year", config.year);
+    settings.Add("repeat", config.repeat);
+    CPLJSONArray threadList;
+    for (int threads : config.threads) threadList.Add(threads);
+    settings.Add("threads", threadList);
+    root.Add("config", settings);
+    
+    if (config.kernels) {
+        root.Add("kernels", benchmarkKernels(config));
+    }
+    
+    bool success = true;
+    CPLJSONArray endToEnd;
+    CPLJSONObject suggested;
+    std::vector<std::string> targets;
+    if (config.stream) targets.push_back("stream");
+    if (config.geotiff) targets.push_back("geotiff");
+    for (const std::string& target : targets) {
+        if (config.sweep != "weak") {
+            int threads = sweepThreads(target, "strong", config, endToEnd, success);
+            suggested.Add(target, threads);
+            std::cerr << "Suggested --cpus-per-task for " << target << ": " << threads << std::endl;
+        }
+        if (config.sweep != "strong") {
+            sweepThreads(target, "weak", config, endToEnd, success);
+        }
+    }
+    if (!targets.empty()) {
+        root.Add("end_to_end", endToEnd);
+    }
+    if (!targets.empty() && config.sweep != "weak") {
+        root.Add("suggested_cpus_per_task", suggested);
+    }
+    
+    CPLJSONDocument document;
+    document.SetRoot(root);
+    if (config.jsonPath.empty()) {
+        std::cout << document.SaveAsString() << std::endl;
+    } else if (document.Save(config.jsonPath)) {
+        std::cerr << "✓ Results saved to: " << config.jsonPath << std::endl;
+    } else {
+        std::cerr << "Error: Failed to write " << config.jsonPath << std::endl;
+        return 1;
+    }
+    
+    return success ? 0 : 1;
+}
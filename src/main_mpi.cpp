@@ -0,0 +1,245 @@
+#include <mpi.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include "ProcessDEM.h"
+#include "gdal_utils.h"
+
+// Distributed GeoTIFF mode: the DEM is split into row strips, one per rank.
+// Each rank writes its strip to <stem>.partNNNN.tif (disjoint files, so no
+// parallel writes to one GeoTIFF), then rank 0 mosaics the parts into
+// <stem>.vrt. Ranks read their horizon halo rows directly from the shared
+// DEM instead of exchanging them.
+
+// Output stem: solar_france.tif -> solar_france
+std::string outputStem(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return path;
+    }
+    return path.substr(0, dot);
+}
+
+std::string partPath(const std::string& stem, int rank) {
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".part%04d.tif", rank);
+    return stem + suffix;
+}
+
+void printUsage(const char* programName) {
+    std::cout << "Usage: mpirun -np RANKS " << programName << " [OPTIONS]" << std::endl;
+    std::cout << "\nOPTIONS:" << std::endl;
+    std::cout << "  --input PATH        Input DEM GeoTIFF file, readable by every rank (required)" << std::endl;
+    std::cout << "  --output PATH       Output stem: writes <stem>.partNNNN.tif and the <stem>.vrt mosaic (required)" << std::endl;
+    std::cout << "  --year YYYY         Year for calculation (default: 2025)" << std::endl;
+    std::cout << "  --threads N         OpenMP threads per rank (default: 96)" << std::endl;
+    std::cout << "  --timezone OFFSET   Timezone offset from UTC in hours (default: 1.0)" << std::endl;
+    std::cout << "  --horizon N         Intersect the sun path with the terrain horizon over N azimuth sectors" << std::endl;
+    std::cout << "  --horizon-radius KM Terrain beyond each strip taken into its horizon (default: 50)" << std::endl;
+    std::cout << "  --no-horizon-cache  Always recompute the horizon of each strip" << std::endl;
+    std::cout << "  --output-type T     GeoTIFF samples: float32 (hours) or int16 (minutes) (default: float32)" << std::endl;
+    std::cout << "  --interleave I      GeoTIFF interleave: pixel or band (default: pixel)" << std::endl;
+    std::cout << "  --blocks-in-flight N  GeoTIFF blocks computed concurrently per rank (default: 4)" << std::endl;
+    std::cout << "  --help              Show this help message" << std::endl;
+    std::cout << "\nEXAMPLE:" << std::endl;
+    std::cout << "  mpirun -np 16 " << programName << " --input dem_france.tif --output solar_france --threads 96" << std::endl;
+}
+
+// Parse arguments; returns -1 to continue, otherwise the exit code
+int parseArguments(int argc, char* argv[], std::string& inputPath, std::string& outputPath,
+                   int& year, int& numThreads, double& timezoneOffset, ProcessingOptions& options,
+                   bool verbose) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        
+        if (arg == "--help" || arg == "-h") {
+            if (verbose) printUsage(argv[0]);
+            return 0;
+        }
+        else if (arg == "--input" && i + 1 < argc) {
+            inputPath = argv[++i];
+        }
+        else if (arg == "--output" && i + 1 < argc) {
+            outputPath = argv[++i];
+        }
+        else if (arg == "--year" && i + 1 < argc) {
+            year = std::atoi(argv[++i]);
+            if (year < 1900 || year > 2100) {
+                if (verbose) std::cerr << "Error: Year must be between 1900 and 2100" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            numThreads = std::atoi(argv[++i]);
+            if (numThreads < 1) {
+                if (verbose) std::cerr << "Error: Number of threads must be at least 1" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--timezone" && i + 1 < argc) {
+            timezoneOffset = std::atof(argv[++i]);
+        }
+        else if (arg == "--horizon" && i + 1 < argc) {
+            options.horizonSectors = std::atoi(argv[++i]);
+            if (options.horizonSectors < 4 || options.horizonSectors > 360) {
+                if (verbose) std::cerr << "Error: Horizon sectors must be between 4 and 360" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--horizon-radius" && i + 1 < argc) {
+            options.horizonHalo = std::atof(argv[++i]) * 1000.0;
+            if (options.horizonHalo <= 0.0) {
+                if (verbose) std::cerr << "Error: Horizon radius must be positive" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--no-horizon-cache") {
+            options.horizonCache = false;
+        }
+        else if (arg == "--output-type" && i + 1 < argc) {
+            std::string type = argv[++i];
+            if (type == "float32") {
+                options.outputType = OutputType::Float32;
+            } else if (type == "int16") {
+                options.outputType = OutputType::Int16;
+            } else {
+                if (verbose) std::cerr << "Error: Output type must be 'float32' or 'int16'" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--interleave" && i + 1 < argc) {
+            std::string interleave = argv[++i];
+            if (interleave == "pixel") {
+                options.interleave = Interleave::Pixel;
+            } else if (interleave == "band") {
+                options.interleave = Interleave::Band;
+            } else {
+                if (verbose) std::cerr << "Error: Interleave must be 'pixel' or 'band'" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--blocks-in-flight" && i + 1 < argc) {
+            options.blocksInFlight = std::atoi(argv[++i]);
+            if (options.blocksInFlight < 1) {
+                if (verbose) std::cerr << "Error: Blocks in flight must be at least 1" << std::endl;
+                return 1;
+            }
+        }
+        else {
+            if (verbose) {
+                std::cerr << "Error: Unknown argument: " << arg << std::endl;
+                printUsage(argv[0]);
+            }
+            return 1;
+        }
+    }
+    
+    if (inputPath.empty() || outputPath.empty()) {
+        if (verbose) {
+            std::cerr << "Error: --input and --output are required" << std::endl;
+            printUsage(argv[0]);
+        }
+        return 1;
+    }
+    return -1;
+}
+
+int main(int argc, char* argv[]) {
+    // Only the main thread of each rank calls MPI
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    
+    int rank, numRanks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &numRanks);
+    
+    std::string inputPath;
+    std::string outputPath;
+    ProcessingOptions options;
+    options.horizonHalo = 50000.0;
+    int year = 2025;
+    int numThreads = 96;
+    double timezoneOffset = 1.0;
+    
+    int exitCode = parseArguments(argc, argv, inputPath, outputPath, year, numThreads,
+                                  timezoneOffset, options, rank == 0);
+    if (exitCode >= 0) {
+        MPI_Finalize();
+        return exitCode;
+    }
+    
+    DemProcessor processor(numThreads);
+    
+    // Rank 0 reads the DEM size and shares it
+    int height = 0;
+    if (rank == 0) {
+        GDALDataset* dataset = (GDALDataset*)GDALOpen(inputPath.c_str(), GA_ReadOnly);
+        if (dataset) {
+            height = dataset->GetRasterYSize();
+            GDALClose(dataset);
+        } else {
+            std::cerr << "Error: Failed to open input file: " << inputPath << std::endl;
+        }
+    }
+    MPI_Bcast(&height, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (height <= 0) {
+        MPI_Finalize();
+        return 1;
+    }
+    
+    // Contiguous strips of whole 512-row GeoTIFF blocks; trailing ranks may be idle
+    const int stripUnit = 512;
+    int units = (height + stripUnit - 1) / stripUnit;
+    int unitsPerRank = (units + numRanks - 1) / numRanks;
+    int rowBegin = std::min(rank * unitsPerRank * stripUnit, height);
+    int rowCount = std::min(unitsPerRank * stripUnit, height - rowBegin);
+    
+    std::string stem = outputStem(outputPath);
+    double start = MPI_Wtime();
+    
+    int ok = 1;
+    if (rowCount > 0) {
+        options.rowBegin = rowBegin;
+        options.rowCount = rowCount;
+        processor.setOptions(options);
+        std::cerr << "Rank " << rank << "/" << numRanks << ": rows " << rowBegin << " - "
+                  << rowBegin + rowCount << " -> " << partPath(stem, rank) << std::endl;
+        ok = processor.processDEM(inputPath, partPath(stem, rank), year, timezoneOffset) ? 1 : 0;
+    }
+    
+    int allOk = 0;
+    MPI_Allreduce(&ok, &allOk, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    
+    // Mosaic of the non-empty parts
+    if (rank == 0 && allOk) {
+        std::vector<std::string> parts;
+        for (int r = 0; r < numRanks && r * unitsPerRank < units; ++r) {
+            parts.push_back(partPath(stem, r));
+        }
+        std::vector<const char*> names;
+        for (const std::string& part : parts) names.push_back(part.c_str());
+        
+        std::string mosaicPath = stem + ".vrt";
+        int usageError = 0;
+        GDALDatasetH mosaic = GDALBuildVRT(mosaicPath.c_str(), static_cast<int>(names.size()), nullptr,
+                                           names.data(), nullptr, &usageError);
+        if (mosaic) {
+            GDALClose(mosaic);
+            std::cout << "✓ Mosaic of " << parts.size() << " strips saved to: " << mosaicPath
+                      << " (" << MPI_Wtime() - start << " s)" << std::endl;
+        } else {
+            std::cerr << "Error: Failed to build mosaic " << mosaicPath << std::endl;
+            allOk = 0;
+        }
+    } else if (rank == 0) {
+        std::cerr << "\n✗ Processing failed on at least one rank!" << std::endl;
+    }
+    
+    MPI_Bcast(&allOk, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Finalize();
+    return allOk ? 0 : 1;
+}
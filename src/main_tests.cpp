@@ -0,0 +1,121 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include "gdal_priv.h"
+#include "GpuSolver.h"
+#include "KernelValidator.h"
+#include "SolarKernels.h"
+
+// Accuracy tests of the optimized paths, run by ctest (solar_tests) and
+// before deploying a binary on a new partition, GPU or compiler.
+//
+// Without arguments the checks need no data: NOAA reference sites, the
+// ephemeris table and every kernel variant on a synthetic tile. --input
+// adds a centered crop of a DEM. The exit status is nonzero on failure.
+
+// Side of the kernel tiles; a full year of every variant takes seconds
+const int TILE_SIZE = 256;
+
+const float SYNTHETIC_NODATA = -9999.0f;
+
+void printUsage(const char* programName) {
+    std::cout << "Usage: " << programName << " [OPTIONS]" << std::endl;
+    std::cout << "\nOPTIONS:" << std::endl;
+    std::cout << "  --year YYYY         Year of the ephemeris and kernel checks (default: 2025)" << std::endl;
+    std::cout << "  --timezone OFFSET   Timezone offset of the kernel checks in hours (default: 1.0)" << std::endl;
+    std::cout << "  --input FILE        Also check the kernels on a centered crop of at most 256x256 pixels of a DEM" << std::endl;
+    std::cout << "  --help              Show this help message" << std::endl;
+    std::cout << "\nEXAMPLE:" << std::endl;
+    std::cout << "  " << programName << " --year 2025 --input data/processed/dem_dept_38.tif" << std::endl;
+}
+
+// Read the centered crop of the first band; false on a GDAL error
+bool readCrop(const std::string& inputPath, std::vector<float>& dem, int& width, int& height,
+              double* geoTransform, float& nodata) {
+    GDALDataset* dataset = (GDALDataset*)GDALOpen(inputPath.c_str(), GA_ReadOnly);
+    if (!dataset) {
+        std::cerr << "Error: Failed to open input file: " << inputPath << std::endl;
+        return false;
+    }
+    
+    width = std::min(dataset->GetRasterXSize(), TILE_SIZE);
+    height = std::min(dataset->GetRasterYSize(), TILE_SIZE);
+    int col0 = (dataset->GetRasterXSize() - width) / 2;
+    int row0 = (dataset->GetRasterYSize() - height) / 2;
+    dataset->GetGeoTransform(geoTransform);
+    geoTransform[0] += col0 * geoTransform[1] + row0 * geoTransform[2];
+    geoTransform[3] += col0 * geoTransform[4] + row0 * geoTransform[5];
+    
+    GDALRasterBand* band = dataset->GetRasterBand(1);
+    dem.resize(static_cast<size_t>(width) * height);
+    CPLErr err = band->RasterIO(GF_Read, col0, row0, width, height,
+                                dem.data(), width, height, GDT_Float32, 0, 0);
+    nodata = static_cast<float>(band->GetNoDataValue());
+    GDALClose(dataset);
+    
+    if (err != CE_None) {
+        std::cerr << "Error: Failed to read DEM data" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    int year = 2025;
+    double timezoneOffset = 1.0;
+    std::string inputPath;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        
+        if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        else if (arg == "--year" && i + 1 < argc) {
+            year = std::atoi(argv[++i]);
+            if (year < 1900 || year > 2100) {
+                std::cerr << "Error: Year must be between 1900 and 2100" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--timezone" && i + 1 < argc) {
+            timezoneOffset = std::atof(argv[++i]);
+        }
+        else if (arg == "--input" && i + 1 < argc) {
+            inputPath = argv[++i];
+        }
+        else {
+            std::cerr << "Error: Unknown argument: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    
+    std::cout << "Kernel validation (Year " << year << ", " << SolarKernels::isaName(SolarKernels::detectIsa())
+              << " CPU" << (GpuSolver::isAvailable() ? ", GPU" : "") << ")" << std::endl;
+    KernelValidator validator(year, timezoneOffset);
+    bool ok = validator.checkReferenceSites();
+    ok = validator.checkEphemeris() && ok;
+    
+    std::vector<float> dem;
+    double geoTransform[6];
+    KernelValidator::syntheticTile(TILE_SIZE, TILE_SIZE, dem, geoTransform);
+    ok = validator.checkTile("synthetic tile", dem.data(), TILE_SIZE, TILE_SIZE, geoTransform,
+                             SYNTHETIC_NODATA) && ok;
+    
+    if (!inputPath.empty()) {
+        GDALAllRegister();
+        int width = 0, height = 0;
+        float nodata = 0.0f;
+        if (!readCrop(inputPath, dem, width, height, geoTransform, nodata)) {
+            return 1;
+        }
+        ok = validator.checkTile(inputPath, dem.data(), width, height, geoTransform, nodata) && ok;
+    }
+    
+    std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -9,6 +9,7 @@ import sys
 import logging
 import time
 import json
+import zlib
 import numpy as np
 import pyarrow as pa
 import pyarrow.parquet as pq
@@ -40,7 +41,200 @@ def read_exact(proc, size):
         raise EOFError(f"Expected {size} bytes, got {len(data)}")
     return data
 
-def process_department(dept_code, year=2025, threads=96):
+def read_header_v1(proc):
+    """Read the v1 header after the "SOLAR" magic"""
+    # [Magic: 5][Width: 4][Height: 4][Days: 4][GeoTransform: 48]
+    width, height, days = struct.unpack('3i', read_exact(proc, 12))
+    geo_transform = struct.unpack('6d', read_exact(proc, 48))
+    return {
+        "version": 1,
+        "width": width,
+        "height": height,
+        "days": days,
+        "transform": geo_transform,
+        "crs": "EPSG:4326",
+        "nodata": None,
+        "delta": False,
+    }
+
+def iter_days_v1(proc, header):
+    """Yield (day, sunrise, sunset) from a v1 stream"""
+    array_bytes = header["width"] * header["height"] * 2  # int16 = 2 bytes
+    for _ in range(header["days"]):
+        day_id = struct.unpack('i', read_exact(proc, 4))[0]
+        sunrise = np.frombuffer(read_exact(proc, array_bytes), dtype=np.int16)
+        sunset = np.frombuffer(read_exact(proc, array_bytes), dtype=np.int16)
+        yield day_id, sunrise, sunset
+
+# v2 layout, see src/StreamFormat.h
+V2_HEADER = struct.Struct('=IHH5i6ddd HhBBHII'.replace(' ', ''))
+V2_CHUNK = struct.Struct('=4siBBBBQQI')
+V2_SEGMENT = struct.Struct('=III')
+
+def read_header_v2(proc):
+    """Read the v2 header after the 8-byte "SUNCAST2" magic and verify its CRC"""
+    raw = read_exact(proc, V2_HEADER.size)
+    fields = V2_HEADER.unpack(raw)
+    if fields[0] != 0x01020304:
+        raise ValueError("Stream byte order differs from this machine")
+    (_, version, flags, width, height, days, year, first_day) = fields[:8]
+    geo_transform = fields[8:14]
+    (tz, nodata, resolution, missing, compression, encoding,
+     _reserved, segment_bytes, crs_len) = fields[14:]
+    crs = read_exact(proc, crs_len)
+    
+    # Sparse streams carry the mask runs and only the valid pixels
+    sparse = bool(flags & 2)
+    sparse_raw = b""
+    valid_pixels = width * height
+    mask_runs = None
+    if sparse:
+        sparse_raw = read_exact(proc, 12)
+        valid_pixels, num_runs = struct.unpack('=QI', sparse_raw)
+        runs_raw = read_exact(proc, 4 * num_runs)
+        sparse_raw += runs_raw
+        mask_runs = np.frombuffer(runs_raw, dtype=np.uint32)
+    
+    crc = struct.unpack('=I', read_exact(proc, 4))[0]
+    if zlib.crc32(b"SUNCAST2" + raw + crs + sparse_raw) != crc:
+        raise ValueError("Stream header checksum mismatch")
+    return {
+        "version": version,
+        "width": width,
+        "height": height,
+        "days": days,
+        "year": year,
+        "first_day": first_day,
+        "transform": geo_transform,
+        "timezone": tz,
+        "crs": crs.decode() or "EPSG:4326",
+        "nodata": nodata,
+        "time_resolution_s": resolution,
+        "missing": missing,
+        "compression": compression,
+        "delta": encoding == 1,
+        "encoding": encoding,
+        "sparse": sparse,
+        "valid_pixels": valid_pixels,
+        "mask_runs": mask_runs,
+    }
+
+def unpack_twelve_bits(payload, pixel_count, content):
+    """Decode a packed12 payload: 3 bytes per pair of 12-bit values, 0xFFF = -1"""
+    triples = np.frombuffer(payload, dtype=np.uint8).reshape(-1, 3).astype(np.uint16)
+    pairs = np.empty((len(triples), 2), dtype=np.uint16)
+    pairs[:, 0] = triples[:, 0] | ((triples[:, 1] & 0xF) << 8)
+    pairs[:, 1] = (triples[:, 1] >> 4) | (triples[:, 2] << 4)
+    values = pairs.view(np.int16)
+    values[pairs == 0xFFF] = -1
+    if content == 0:
+        # (sunrise, sunset) of each pixel, returned in the raw order
+        return np.concatenate([values[:, 0], values[:, 1]])
+    return values.reshape(-1)[:pixel_count]
+
+def decode_varints(payload):
+    """Decode zigzag LEB128 varints (1 to 3 bytes each) to uint16 differences"""
+    data = np.frombuffer(payload, dtype=np.uint8)
+    last = (data & 0x80) == 0
+    index = np.concatenate(([0], np.cumsum(last)[:-1]))
+    starts = np.flatnonzero(np.concatenate(([True], last[:-1])))
+    shift = 7 * (np.arange(len(data)) - starts[index])
+    groups = (data & 0x7F).astype(np.int64) << shift
+    zigzag = np.bincount(index, weights=groups, minlength=int(last.sum())).astype(np.uint32)
+    return ((zigzag >> 1) ^ (0 - (zigzag & 1))).astype(np.uint16)
+
+def decompress_segment(compression, stored, raw_bytes):
+    """Decode one v2 segment (0 = none, 1 = LZ4 block, 2 = zstd frame)"""
+    if compression == 0:
+        return stored
+    if compression == 1:
+        import lz4.block
+        return lz4.block.decompress(stored, uncompressed_size=raw_bytes)
+    if compression == 2:
+        import zstandard
+        return zstandard.ZstdDecompressor().decompress(stored, max_output_size=raw_bytes)
+    raise ValueError(f"Unknown compression {compression}")
+
+def iter_days_v2(proc, header):
+    """Yield (day, sunrise, sunset) from a v2 stream, assembling strip chunks
+    
+    Sparse streams yield the valid pixels only (see expand_sparse).
+    """
+    total_pixels = header["valid_pixels"]
+    previous = None
+    day_id = None
+    sunrise = sunset = None
+    
+    while True:
+        (tag, chunk_day, content, encoding, compression, _reserved,
+         pixel_offset, pixel_count, num_segments) = V2_CHUNK.unpack(read_exact(proc, V2_CHUNK.size))
+        if tag != b"CHNK":
+            raise ValueError(f"Invalid chunk tag: {tag}")
+        
+        if chunk_day != day_id and day_id is not None:
+            yield day_id, sunrise, sunset
+        if chunk_day == 0:
+            return
+        if chunk_day != day_id:
+            day_id = chunk_day
+            sunrise = np.empty(total_pixels, dtype=np.int16)
+            sunset = np.empty(total_pixels, dtype=np.int16)
+        
+        segments = [V2_SEGMENT.unpack(read_exact(proc, V2_SEGMENT.size)) for _ in range(num_segments)]
+        payload = bytearray()
+        for raw_bytes, stored_bytes, crc in segments:
+            stored = read_exact(proc, stored_bytes)
+            if zlib.crc32(stored) != crc:
+                raise ValueError(f"Checksum mismatch in day {chunk_day}")
+            payload += decompress_segment(compression, stored, raw_bytes)
+        
+        if encoding == 2:
+            values = unpack_twelve_bits(bytes(payload), pixel_count, content)
+        elif encoding == 3:
+            # Differences modulo 2^16 against the previous full day, as delta
+            values = decode_varints(bytes(payload))
+            if previous is not None and len(previous) == len(values):
+                values = values + previous.view(np.uint16)
+            values = values.view(np.int16)
+            previous = values
+        else:
+            values = np.frombuffer(bytes(payload), dtype=np.int16)
+        
+        if encoding == 1:
+            # Deltas are modulo 2^16 against the previous full day
+            if previous is not None:
+                values = (values.view(np.uint16) + previous.view(np.uint16)).view(np.int16)
+            previous = values
+        
+        span = slice(pixel_offset, pixel_offset + pixel_count)
+        if content == 0:
+            sunrise[span] = values[:pixel_count]
+            sunset[span] = values[pixel_count:]
+        elif content == 1:
+            sunrise[span] = values
+        else:
+            sunset[span] = values
+
+def run_native(cmd, parquet_file, metadata_file):
+    """Let the calculator write Parquet itself, then export the schema metadata"""
+    result = subprocess.run(cmd, stderr=sys.stderr)
+    if result.returncode != 0:
+        raise RuntimeError(f"solar_calculator exited with status {result.returncode}")
+    
+    meta = {k.decode(): v.decode() for k, v in pq.read_schema(parquet_file).metadata.items()}
+    with open(metadata_file, 'w') as f:
+        json.dump({
+            "width": int(meta["width"]),
+            "height": int(meta["height"]),
+            "transform": [float(v) for v in meta["geotransform"].split(",")],
+            "crs": meta["crs"] or "EPSG:4326",
+            "layout": meta["layout"],
+            "sparse": "mask_runs" in meta,
+            "mask_runs": [int(v) for v in meta["mask_runs"].split(",")] if "mask_runs" in meta else None
+        }, f, indent=2)
+
+def process_department(dept_code, year=2025, threads=96, stream_format="v2", compression="none",
+                       native=False, sparse=False, encoding="delta", time_resolution=60):
     """Process a single department using streaming"""
     dept_name = DEPT_NAMES.get(dept_code, dept_code)
     input_file = OUTPUT_DIR / f"dem_dept_{dept_code}.tif"
@@ -60,10 +254,31 @@ def process_department(dept_code, year=2025, threads=96):
     cmd = [
         str(SOLAR_CALCULATOR_BIN),
         "--input", str(input_file),
-        "--stream",
         "--year", str(year),
         "--threads", str(threads)
     ]
+    if native:
+        # The binary writes the wide layout directly, without the stdout hop
+        cmd = [str(SOLAR_CALCULATOR_BIN), "--input", str(input_file), "--parquet", str(parquet_file),
+               "--year", str(year), "--threads", str(threads)]
+        if sparse:
+            cmd.append("--sparse")
+        logger.info(f"Launching C++ process: {' '.join(cmd)}")
+        start_time = time.time()
+        try:
+            run_native(cmd, parquet_file, metadata_file)
+        except Exception as e:
+            logger.error(f"Error processing {dept_code}: {e}")
+            return False
+        logger.info(f"✓ Completed {dept_code} in {time.time() - start_time:.2f}s")
+        return True
+    
+    cmd += ["--stream", "--stream-format", stream_format]
+    if stream_format == "v2":
+        cmd += ["--compression", compression, "--encoding", encoding,
+                "--time-resolution", str(time_resolution)]
+        if sparse:
+            cmd.append("--sparse")
     
     logger.info(f"Launching C++ process: {' '.join(cmd)}")
     
@@ -75,26 +290,32 @@ def process_department(dept_code, year=2025, threads=96):
     )
     
     try:
-        # Read Header
-        # [Magic: 5][Width: 4][Height: 4][Days: 4][GeoTransform: 48]
+        # Read Header; the magic identifies the stream version
         magic = read_exact(proc, 5)
-        if magic != b"SOLAR":
+        if magic == b"SOLAR":
+            header = read_header_v1(proc)
+            days = iter_days_v1(proc, header)
+        elif magic + read_exact(proc, 3) == b"SUNCAST2":
+            header = read_header_v2(proc)
+            days = iter_days_v2(proc, header)
+        else:
             raise ValueError(f"Invalid magic bytes: {magic}")
-            
-        width = struct.unpack('i', read_exact(proc, 4))[0]
-        height = struct.unpack('i', read_exact(proc, 4))[0]
-        days_in_year = struct.unpack('i', read_exact(proc, 4))[0]
-        geo_transform = struct.unpack('6d', read_exact(proc, 48))
         
-        logger.info(f"Metadata received: {width}x{height}, {days_in_year} days")
+        width, height = header["width"], header["height"]
+        logger.info(f"Metadata received: {width}x{height}, {header['days']} days "
+                    f"(stream v{header['version']})")
         
         # Save metadata
         with open(metadata_file, 'w') as f:
             json.dump({
                 "width": width,
                 "height": height,
-                "transform": geo_transform,
-                "crs": "EPSG:4326"
+                "transform": header["transform"],
+                "crs": header["crs"],
+                "nodata": header["nodata"],
+                "time_resolution_s": header.get("time_resolution_s", 60),
+                "sparse": header.get("sparse", False),
+                "mask_runs": header["mask_runs"].tolist() if header.get("sparse") else None
             }, f, indent=2)
             
         # Define Parquet Schema
@@ -107,24 +328,10 @@ def process_department(dept_code, year=2025, threads=96):
         # Open Parquet Writer
         writer = pq.ParquetWriter(parquet_file, schema, compression='snappy')
         
-        total_pixels = width * height
-        array_bytes = total_pixels * 2  # int16 = 2 bytes
-        
         start_time = time.time()
         
         # Read loop
-        for _ in range(days_in_year):
-            # Read Day ID
-            day_id = struct.unpack('i', read_exact(proc, 4))[0]
-            
-            # Read Sunrise Array
-            sunrise_bytes = read_exact(proc, array_bytes)
-            sunrise_array = np.frombuffer(sunrise_bytes, dtype=np.int16)
-            
-            # Read Sunset Array
-            sunset_bytes = read_exact(proc, array_bytes)
-            sunset_array = np.frombuffer(sunset_bytes, dtype=np.int16)
-            
+        for day_id, sunrise_array, sunset_array in days:
             # Create Table
             batch = pa.RecordBatch.from_arrays(
                 [
@@ -155,6 +362,18 @@ def main():
     parser = argparse.ArgumentParser(description="Run solar calculation for departments")
     parser.add_argument("--dept", type=str, help="Specific department code to process")
     parser.add_argument("--index", type=int, help="Index of department in configuration list")
+    parser.add_argument("--stream-format", choices=["v1", "v2"], default="v2",
+                        help="Binary stream format requested from the calculator")
+    parser.add_argument("--compression", choices=["none", "lz4", "zstd"], default="none",
+                        help="v2 chunk compression (lz4/zstd need the matching Python package)")
+    parser.add_argument("--encoding", choices=["raw", "delta", "packed12", "varint"], default="delta",
+                        help="v2 value encoding (delta and varint compress best)")
+    parser.add_argument("--time-resolution", type=int, choices=[60, 30, 10], default=60,
+                        help="v2 value unit in seconds (packed12 needs 30 or 60)")
+    parser.add_argument("--native", action="store_true",
+                        help="Let the calculator write Parquet itself (build with SOLAR_WITH_ARROW)")
+    parser.add_argument("--sparse", action="store_true",
+                        help="Store only valid pixels (v2 or --native); metadata.json keeps the mask runs")
     args = parser.parse_args()
 
     logger.info("=" * 60)
@@ -183,7 +402,9 @@ def main():
     total_start = time.time()
     
     for dept in departments_to_process:
-        if process_department(dept):
+        if process_department(dept, stream_format=args.stream_format, compression=args.compression,
+                              native=args.native, sparse=args.sparse, encoding=args.encoding,
+                              time_resolution=args.time_resolution):
             success_count += 1
             
     total_duration = time.time() - total_start
@@ -30,6 +30,20 @@ from ..config import PROJECT_ROOT, DEPT_SHAPEFILE
 PARQUET_DIR = PROJECT_ROOT / "data" / "parquet"
 
 
+def expand_sparse(values: np.ndarray, mask_runs, fill: int = -1) -> np.ndarray:
+    """
+    Expand the valid-pixel values of a sparse output to the full raster.
+
+    ``mask_runs`` alternates masked and valid run lengths in raster order,
+    starting with a (possibly empty) masked run; masked pixels get ``fill``.
+    """
+    runs = np.asarray(mask_runs, dtype=np.int64)
+    valid = np.repeat(np.arange(runs.size) % 2 == 1, runs)
+    out = np.full(valid.size, fill, dtype=values.dtype)
+    out[valid] = values
+    return out
+
+
 def guess_dept_code_column(gdf: gpd.GeoDataFrame, target_code: str) -> str:
     """
     Try to infer the column that contains the department code.
@@ -115,6 +129,8 @@ def load_sunset_grid(
     # There should be exactly one row for this day
     row = df.iloc[0]
     sunset = np.asarray(row["sunset"], dtype=np.int16)
+    if metadata.get("sparse"):
+        sunset = expand_sparse(sunset, metadata["mask_runs"])
 
     if sunset.size != width * height:
         raise ValueError(